@@ -0,0 +1,459 @@
+#include "assets.h"
+#include "ldtk.h"
+#include "pack.h"
+#include "replay.h"
+#include "sys.h"
+
+// cute_aseprite inflates cels and composes frames through this, on one thread per processor.
+// Each cel or frame writes its own output, so the pixels don't depend on how they were spread.
+#define CUTE_ASEPRITE_PARALLEL_FOR(count, job, udata) ParallelFor((count), (job), (udata), 0)
+
+#define RAYLIB_ASEPRITE_IMPLEMENTATION
+#include "raylib-aseprite.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// tilesets are drawn with straight alpha and point filtering, so neither is needed
+#define kAssetBakeFlags 0
+
+typedef struct AssetCache
+{
+	Asset** assets;
+	int count;
+	int capacity;
+
+	size_t budget;
+	size_t size;
+	unsigned long long tick;		// counts acquires, orders assets by last use
+	AssetCacheStats stats;			// hits, misses, reloads and evictions
+
+	SysMutex* lock;
+} AssetCache;
+
+static AssetCache gAssetCache = { 0 };
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Aseprite
+
+static Image LoadAsepriteImageFromMemory(const unsigned char* fileData, unsigned int size)
+{
+	Image image = { 0 };
+
+	ase_t* ase = cute_aseprite_load_from_memory(fileData, (int)size, 0);
+	if (!ase) return image;
+
+	image = GenImageColor(ase->w * ase->frame_count, ase->h, BLANK);
+	for (int i = 0; i < ase->frame_count; ++i)
+	{
+		Image frameImage = {
+			.data = ase->frames[i].pixels,
+			.width = ase->w,
+			.height = ase->h,
+			.mipmaps = 1,
+			.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+		};
+		Rectangle src = { 0, 0, (float)ase->w, (float)ase->h };
+		Rectangle dst = { (float)(i * ase->w), 0, (float)ase->w, (float)ase->h };
+		ImageDraw(&image, frameImage, src, dst, WHITE);
+	}
+
+	int transparency = ase->transparent_palette_entry_index;
+	if (transparency >= 0 && transparency < ase->palette.entry_count)
+	{
+		ase_color_t c = ase->palette.entries[transparency].color;
+		ImageColorReplace(&image, (Color) { c.r, c.g, c.b, c.a }, BLANK);
+	}
+
+	cute_aseprite_free(ase);
+	return image;
+}
+
+
+Image LoadAsepriteImage(const char* fileName)
+{
+	Image image = { 0 };
+
+	unsigned int bytesRead = 0;
+	unsigned char* fileData = LoadFileData(fileName, &bytesRead);
+	if (!fileData) return image;
+
+	image = LoadAsepriteImageFromMemory(fileData, bytesRead);
+	UnloadFileData(fileData);
+	return image;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Loading
+
+static Image LoadAnyImage(const char* fileName, const unsigned char* fileData, unsigned int size)
+{
+	Image image = IsFileExtension(fileName, ".aseprite") ? LoadAsepriteImageFromMemory(fileData, size) :
+		LoadImageFromMemory(GetFileExtension(fileName), fileData, (int)size);
+	if (image.data) ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+	return image;
+}
+
+
+// Map the baked pixels of an image, or decode and bake them. Baked images are read only.
+static Image LoadBakeableImage(const char* fileName, const unsigned char* fileData, unsigned int size,
+	unsigned long long hash, BakedImage* baked)
+{
+	if (LoadBakedImage(hash, kAssetBakeFlags, baked)) return baked->image;
+
+	Image image = LoadAnyImage(fileName, fileData, size);
+	SaveBakedImage(hash, kAssetBakeFlags, &image);
+	return image;
+}
+
+
+// Hash the file and load the asset from it, sets everything but the cache bookkeeping. Files
+// in the mounted pack are read in place, and music keeps streaming from there.
+static bool LoadAssetData(Asset* asset)
+{
+	PackSlice slice;
+	const unsigned char* fileData = NULL;
+	unsigned int fileSize = 0;
+	bool packed = LoadPackFile(asset->fileName, &slice);
+	if (packed)
+	{
+		fileData = slice.data;
+		fileSize = slice.size;
+	}
+	else
+	{
+		fileData = LoadFileData(asset->fileName, &fileSize);
+		if (!fileData) return false;
+	}
+	asset->hash = HashReplayData(fileData, fileSize);
+	asset->modTime = GetFileModTime(asset->fileName);
+
+	bool loaded = false;
+	switch (asset->type)
+	{
+	case AssetType_World:
+	{
+		// parsed from the bytes just hashed, which have to be zero terminated. Pack files
+		// always are, loose ones get room for it.
+		if (!packed)
+		{
+			unsigned char* text = MemRealloc((unsigned char*)fileData, fileSize + 1);
+			if (!text) break;
+			text[fileSize] = 0;
+			fileData = text;
+		}
+		// the parsed world takes about as much memory as its json
+		asset->world = ldtk_parse_world((const char*)fileData, fileSize);
+		asset->size = fileSize;
+		loaded = asset->world != NULL;
+		break;
+	}
+
+	case AssetType_Image:
+		asset->image = LoadBakeableImage(asset->fileName, fileData, fileSize, asset->hash, &asset->baked);
+		asset->size = (size_t)asset->image.width * asset->image.height * 4;
+		loaded = asset->image.data != NULL;
+		break;
+
+	case AssetType_Texture:
+	{
+		BakedImage baked;
+		Image image = LoadBakeableImage(asset->fileName, fileData, fileSize, asset->hash, &baked);
+		if (!image.data) break;
+		asset->texture = LoadTextureFromImage(image);
+		asset->size = (size_t)image.width * image.height * 4;
+		if (baked.map.data) UnloadBakedImage(&baked);
+		else UnloadImage(image);
+		loaded = asset->texture.id != 0;
+		break;
+	}
+
+	case AssetType_Aseprite:
+		// frames are kept on the CPU besides the texture
+		asset->aseprite = malloc(sizeof(Aseprite));
+		if (!asset->aseprite) break;
+		*asset->aseprite = LoadAsepriteFromMemory((unsigned char*)fileData, fileSize);
+		if (!asset->aseprite->ase) break;
+		asset->size = (size_t)asset->aseprite->ase->w * asset->aseprite->ase->h * asset->aseprite->ase->frame_count * 4 * 2;
+		loaded = true;
+		break;
+
+	case AssetType_Sound:
+	{
+		Wave wave = LoadWaveFromMemory(GetFileExtension(asset->fileName), fileData, (int)fileSize);
+		asset->sound = LoadSoundFromWave(wave);
+		UnloadWave(wave);
+		asset->size = (size_t)asset->sound.frameCount * asset->sound.stream.channels * asset->sound.stream.sampleSize / 8;
+		loaded = asset->sound.frameCount > 0;
+		break;
+	}
+
+	case AssetType_Music:
+		// streamed, the file is what stays in memory. raylib opens loose files itself.
+		if (packed)
+		{
+			asset->music = LoadMusicStreamFromMemory(GetFileExtension(asset->fileName), slice.data, (int)slice.size);
+			asset->packed = slice;
+		}
+		else
+		{
+			asset->music = LoadMusicStream(asset->fileName);
+		}
+		asset->size = fileSize;
+		loaded = asset->music.frameCount > 0;
+		break;
+
+	default:
+		break;
+	}
+
+	if (!packed) UnloadFileData((unsigned char*)fileData);
+	else if (!asset->packed.data) UnloadPackFile(&slice);
+	return loaded;
+}
+
+
+static void UnloadAssetData(Asset* asset)
+{
+	if (asset->freeAttachment) asset->freeAttachment(asset->attachment);
+	asset->attachment = NULL;
+	asset->freeAttachment = NULL;
+
+	switch (asset->type)
+	{
+	case AssetType_World:		ldtk_destroy_world(asset->world);		break;
+	case AssetType_Image:
+		if (asset->baked.map.data) UnloadBakedImage(&asset->baked);
+		else UnloadImage(asset->image);
+		break;
+	case AssetType_Texture:		UnloadTexture(asset->texture);			break;
+	case AssetType_Aseprite:
+		if (asset->aseprite && asset->aseprite->ase) UnloadAseprite(*asset->aseprite);
+		free(asset->aseprite);
+		break;
+	case AssetType_Sound:		UnloadSound(asset->sound);				break;
+	case AssetType_Music:		UnloadMusicStream(asset->music);		break;
+	default: break;
+	}
+
+	UnloadPackFile(&asset->packed);
+}
+
+
+static void FreeAsset(Asset* asset)
+{
+	UnloadAssetData(asset);
+	free(asset->fileName);
+	free(asset);
+}
+
+
+static char* CopyString(const char* string)
+{
+	size_t length = strlen(string) + 1;
+	char* copy = malloc(length);
+	if (copy) memcpy(copy, string, length);
+	return copy;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Cache
+
+bool InitAssetCache(size_t budget)
+{
+	memset(&gAssetCache, 0, sizeof(gAssetCache));
+	gAssetCache.budget = budget;
+	gAssetCache.lock = CreateSysMutex();
+	return gAssetCache.lock != NULL;
+}
+
+
+void FreeAssetCache(void)
+{
+	for (int i = 0; i < gAssetCache.count; ++i)
+	{
+		FreeAsset(gAssetCache.assets[i]);
+	}
+	free(gAssetCache.assets);
+	DestroySysMutex(gAssetCache.lock);
+	memset(&gAssetCache, 0, sizeof(gAssetCache));
+}
+
+
+void SetAssetCacheBudget(size_t budget)
+{
+	LockSysMutex(gAssetCache.lock);
+	gAssetCache.budget = budget;
+	UnlockSysMutex(gAssetCache.lock);
+
+	TrimAssetCache();
+}
+
+
+// Cached asset of a file, hashing it again if it changed on disk. Called with the lock held.
+static Asset* FindAsset(AssetType type, const char* fileName)
+{
+	for (int i = 0; i < gAssetCache.count; ++i)
+	{
+		Asset* asset = gAssetCache.assets[i];
+		if (asset->type != type || asset->stale || strcmp(asset->fileName, fileName) != 0) continue;
+
+		// saving a file changes its time, but not necessarily its contents
+		long modTime = GetFileModTime(fileName);
+		if (modTime == asset->modTime) return asset;
+
+		unsigned int fileSize = 0;
+		unsigned char* fileData = LoadFileData(fileName, &fileSize);
+		unsigned long long hash = fileData ? HashReplayData(fileData, fileSize) : 0;
+		UnloadFileData(fileData);
+
+		if (fileData && hash == asset->hash)
+		{
+			asset->modTime = modTime;
+			return asset;
+		}
+
+		// freed by the next trim once unreferenced, on the main thread
+		asset->stale = true;
+		gAssetCache.stats.reloads++;
+		return NULL;
+	}
+	return NULL;
+}
+
+
+Asset* AcquireAsset(AssetType type, const char* fileName)
+{
+	LockSysMutex(gAssetCache.lock);
+	Asset* asset = FindAsset(type, fileName);
+	if (asset)
+	{
+		asset->refCount++;
+		asset->lastUse = ++gAssetCache.tick;
+		gAssetCache.stats.hits++;
+		UnlockSysMutex(gAssetCache.lock);
+		return asset;
+	}
+	gAssetCache.stats.misses++;
+	UnlockSysMutex(gAssetCache.lock);
+
+	// loaded without the lock, so loading a world on a thread doesn't stall the main thread.
+	// Two threads missing on the same file both load it, the second copy only costs memory.
+	asset = calloc(1, sizeof(Asset));
+	if (!asset) return NULL;
+	asset->type = type;
+	asset->fileName = CopyString(fileName);
+	if (!asset->fileName || !LoadAssetData(asset))
+	{
+		TraceLog(LOG_WARNING, "ASSETS: [%s] Failed to load", fileName);
+		FreeAsset(asset);
+		return NULL;
+	}
+
+	LockSysMutex(gAssetCache.lock);
+	if (gAssetCache.count == gAssetCache.capacity)
+	{
+		int capacity = gAssetCache.capacity ? gAssetCache.capacity * 2 : 32;
+		Asset** assets = realloc(gAssetCache.assets, capacity * sizeof(Asset*));
+		if (!assets)
+		{
+			UnlockSysMutex(gAssetCache.lock);
+			FreeAsset(asset);
+			return NULL;
+		}
+		gAssetCache.assets = assets;
+		gAssetCache.capacity = capacity;
+	}
+
+	asset->refCount = 1;
+	asset->lastUse = ++gAssetCache.tick;
+	gAssetCache.assets[gAssetCache.count++] = asset;
+	gAssetCache.size += asset->size;
+	UnlockSysMutex(gAssetCache.lock);
+
+	TraceLog(LOG_INFO, "ASSETS: [%s] Loaded, %.1f KB", fileName, asset->size / 1024.0f);
+	return asset;
+}
+
+
+void ReleaseAsset(Asset* asset)
+{
+	if (!asset) return;
+
+	LockSysMutex(gAssetCache.lock);
+	asset->refCount--;
+	UnlockSysMutex(gAssetCache.lock);
+}
+
+
+void AttachAssetData(Asset* asset, void* data, size_t size, void (*freeAttachment)(void* data))
+{
+	LockSysMutex(gAssetCache.lock);
+	asset->attachment = data;
+	asset->freeAttachment = freeAttachment;
+	asset->size += size;
+	gAssetCache.size += size;
+	UnlockSysMutex(gAssetCache.lock);
+}
+
+
+static void EvictAsset(int index)
+{
+	Asset* asset = gAssetCache.assets[index];
+	gAssetCache.assets[index] = gAssetCache.assets[--gAssetCache.count];
+	gAssetCache.size -= asset->size;
+	if (!asset->stale) gAssetCache.stats.evictions++;
+
+	TraceLog(LOG_INFO, "ASSETS: [%s] Unloaded%s, %.1f KB", asset->fileName, asset->stale ? " (changed on disk)" : "", asset->size / 1024.0f);
+	FreeAsset(asset);
+}
+
+
+void TrimAssetCache(void)
+{
+	LockSysMutex(gAssetCache.lock);
+
+	for (int i = gAssetCache.count - 1; i >= 0; --i)
+	{
+		if (gAssetCache.assets[i]->stale && gAssetCache.assets[i]->refCount == 0) EvictAsset(i);
+	}
+
+	while (gAssetCache.size > gAssetCache.budget)
+	{
+		int oldest = -1;
+		for (int i = 0; i < gAssetCache.count; ++i)
+		{
+			const Asset* asset = gAssetCache.assets[i];
+			if (asset->refCount > 0) continue;
+			if (oldest < 0 || asset->lastUse < gAssetCache.assets[oldest]->lastUse) oldest = i;
+		}
+
+		// everything left is in use
+		if (oldest < 0) break;
+		EvictAsset(oldest);
+	}
+
+	UnlockSysMutex(gAssetCache.lock);
+}
+
+
+AssetCacheStats GetAssetCacheStats(void)
+{
+	LockSysMutex(gAssetCache.lock);
+	AssetCacheStats stats = gAssetCache.stats;
+	stats.assets = gAssetCache.count;
+	stats.referenced = 0;
+	for (int i = 0; i < gAssetCache.count; ++i)
+	{
+		if (gAssetCache.assets[i]->refCount > 0) stats.referenced++;
+	}
+	stats.size = gAssetCache.size;
+	stats.budget = gAssetCache.budget;
+	UnlockSysMutex(gAssetCache.lock);
+	return stats;
+}
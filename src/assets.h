@@ -0,0 +1,121 @@
+// Cache of loaded assets, shared by all screens.
+//
+// Assets are keyed by type and file name, and remember the hash of the file contents they
+// were loaded from. When the file's modification time changes it is hashed again, and an
+// asset whose contents changed is reloaded; the old one goes away once its last reference
+// is released.
+//
+// Acquiring an asset counts a reference. Released assets stay loaded, so acquiring them
+// again is a hit that costs a lookup, until TrimAssetCache finds the cache over its memory
+// budget: then the least recently used unreferenced assets are evicted.
+//
+// Images and textures decoded from PNG or .aseprite files are baked, see bake.h, so later
+// runs map their pixels instead of decoding the file again. Files in the mounted resource
+// pack, see pack.h, are loaded from it in place.
+//
+// Worlds and images are only CPU data and may be acquired and released on any thread.
+// Textures, aseprites, sounds and music need the GPU or audio device and are acquired on the
+// main thread. Trimming may unload any of them, so it runs on the main thread too.
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include "raylib.h"
+#include "raylib-aseprite.h"
+#include "bake.h"
+#include "pack.h"
+
+#include <stddef.h>
+
+#define kAssetCacheBudget (256 * 1024 * 1024)
+
+struct ldtk_world;
+
+typedef enum AssetType
+{
+	AssetType_World,		// world
+	AssetType_Image,		// image, RGBA8. All frames side by side for .aseprite files
+	AssetType_Texture,		// texture, .aseprite files the same layout as images
+	AssetType_Aseprite,		// aseprite
+	AssetType_Sound,		// sound
+	AssetType_Music,		// music, streamed from the file
+	AssetType_Count
+} AssetType;
+
+typedef struct Asset
+{
+	AssetType type;
+	char* fileName;
+	unsigned long long hash;		// of the file contents, HashReplayData
+	long modTime;					// of the file when hashed
+
+	int refCount;
+	unsigned long long lastUse;		// cache tick of the last acquire
+	bool stale;						// the file changed since, freed once released
+	size_t size;					// estimated memory, including attached data
+
+	// the loaded asset, the field matching type
+	struct ldtk_world* world;
+	Image image;					// read only when mapped from the bake directory
+	Texture texture;
+	Aseprite* aseprite;				// incomplete outside raylib-aseprite's implementation
+	Sound sound;
+	Music music;
+	BakedImage baked;				// what image points into, if it was baked before
+	PackSlice packed;				// what music streams from, if it was in the pack
+
+	// data derived from the asset, see AttachAssetData
+	void* attachment;
+	void (*freeAttachment)(void* attachment);
+} Asset;
+
+typedef struct AssetCacheStats
+{
+	int hits;
+	int misses;
+	int reloads;			// misses because the file changed
+	int evictions;
+	int assets;				// currently loaded
+	int referenced;
+	size_t size;			// estimated memory of the loaded assets
+	size_t budget;
+} AssetCacheStats;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+bool InitAssetCache(size_t budget);
+
+// Unload every asset, referenced or not
+void FreeAssetCache(void);
+
+void SetAssetCacheBudget(size_t budget);
+
+// Get an asset, loading it unless it's cached. Returns NULL if it fails to load.
+Asset* AcquireAsset(AssetType type, const char* fileName);
+
+// Drop a reference, the asset stays cached until trimmed. NULL is ignored.
+void ReleaseAsset(Asset* asset);
+
+// Keep data derived from an asset with it, e.g. the render data prepared for a world.
+// freeAttachment is called with data before the asset is unloaded, by TrimAssetCache or
+// FreeAssetCache.
+void AttachAssetData(Asset* asset, void* data, size_t size, void (*freeAttachment)(void* data));
+
+// Evict unreferenced assets, least recently used first, until the cache fits its budget.
+// Assets whose file changed are evicted as soon as they are unreferenced.
+void TrimAssetCache(void);
+
+AssetCacheStats GetAssetCacheStats(void);
+
+// Load all frames of an .aseprite file side by side into a CPU image, the same layout
+// LoadAseprite() uploads, but without requiring a window
+Image LoadAsepriteImage(const char* fileName);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // ASSETS_H
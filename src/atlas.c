@@ -0,0 +1,266 @@
+#include "atlas.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+// A skyline is the list of horizontal segments forming the top edge of everything placed so far.
+typedef struct SkylineNode
+{
+	int x;
+	int y;
+	int width;
+} SkylineNode;
+
+typedef struct SkylinePage
+{
+	SkylineNode* nodes;
+	int nodeCount;
+	int size;
+	int usedWidth;
+	int usedHeight;
+} SkylinePage;
+
+
+// lowest y at which a rect of the given width fits when its left edge starts at node index,
+// or -1 if it runs off the page
+static int SkylineFitY(const SkylinePage* page, int index, int width, int height)
+{
+	int x = page->nodes[index].x;
+	if (x + width > page->size) return -1;
+
+	int y = 0;
+	int remaining = width;
+	for (int i = index; remaining > 0; ++i)
+	{
+		if (page->nodes[i].y > y) y = page->nodes[i].y;
+		if (y + height > page->size) return -1;
+		remaining -= page->nodes[i].width;
+	}
+	return y;
+}
+
+
+// find the bottom-left position for a rect, returns false if it doesn't fit on the page
+static bool SkylineFind(const SkylinePage* page, int width, int height, int* outIndex, int* outX, int* outY)
+{
+	int bestTop = page->size + 1;
+	int bestX = page->size + 1;
+	bool found = false;
+
+	for (int i = 0; i < page->nodeCount; ++i)
+	{
+		int y = SkylineFitY(page, i, width, height);
+		if (y < 0) continue;
+
+		int top = y + height;
+		if (top < bestTop || (top == bestTop && page->nodes[i].x < bestX))
+		{
+			bestTop = top;
+			bestX = page->nodes[i].x;
+			*outIndex = i;
+			*outX = page->nodes[i].x;
+			*outY = y;
+			found = true;
+		}
+	}
+	return found;
+}
+
+
+static void SkylineInsert(SkylinePage* page, int index, int x, int y, int width, int height)
+{
+	// the new segment covers the rect top, nodes below it get clipped or removed
+	memmove(&page->nodes[index + 1], &page->nodes[index], (page->nodeCount - index) * sizeof(SkylineNode));
+	page->nodes[index] = (SkylineNode) { x, y + height, width };
+	page->nodeCount++;
+
+	for (int i = index + 1; i < page->nodeCount; ++i)
+	{
+		SkylineNode* prev = &page->nodes[i - 1];
+		SkylineNode* node = &page->nodes[i];
+		int overlap = (prev->x + prev->width) - node->x;
+		if (overlap <= 0) break;
+
+		node->x += overlap;
+		node->width -= overlap;
+		if (node->width > 0) break;
+
+		memmove(node, node + 1, (page->nodeCount - i - 1) * sizeof(SkylineNode));
+		page->nodeCount--;
+		--i;
+	}
+
+	// merge neighbours at the same height
+	for (int i = 0; i + 1 < page->nodeCount; ++i)
+	{
+		if (page->nodes[i].y == page->nodes[i + 1].y)
+		{
+			page->nodes[i].width += page->nodes[i + 1].width;
+			memmove(&page->nodes[i + 1], &page->nodes[i + 2], (page->nodeCount - i - 2) * sizeof(SkylineNode));
+			page->nodeCount--;
+			--i;
+		}
+	}
+
+	if (x + width > page->usedWidth) page->usedWidth = x + width;
+	if (y + height > page->usedHeight) page->usedHeight = y + height;
+}
+
+
+static bool SkylineInitPage(SkylinePage* page, int size, int maxNodes)
+{
+	page->nodes = malloc((maxNodes + 1) * sizeof(SkylineNode));
+	if (!page->nodes) return false;
+	page->nodes[0] = (SkylineNode) { 0, 0, size };
+	page->nodeCount = 1;
+	page->size = size;
+	page->usedWidth = 0;
+	page->usedHeight = 0;
+	return true;
+}
+
+
+static const int* gSortWidths = NULL;
+static const int* gSortHeights = NULL;
+
+// tallest first, then widest, keeps the skyline flat
+static int CompareRectOrder(const void* a, const void* b)
+{
+	int ia = *(const int*)a;
+	int ib = *(const int*)b;
+	if (gSortHeights[ia] != gSortHeights[ib]) return gSortHeights[ib] - gSortHeights[ia];
+	if (gSortWidths[ia] != gSortWidths[ib]) return gSortWidths[ib] - gSortWidths[ia];
+	return ia - ib;
+}
+
+
+int PackAtlasRects(const int* widths, const int* heights, int count, int pageSize, int padding,
+	AtlasPlacement* placements, int* pageWidths, int* pageHeights)
+{
+	if (count <= 0) return 0;
+
+	int* order = malloc(count * sizeof(int));
+	SkylinePage* pages = calloc(count, sizeof(SkylinePage));
+	if (!order || !pages)
+	{
+		free(order);
+		free(pages);
+		return 0;
+	}
+
+	for (int i = 0; i < count; ++i) order[i] = i;
+	gSortWidths = widths;
+	gSortHeights = heights;
+	qsort(order, count, sizeof(int), CompareRectOrder);
+	gSortWidths = NULL;
+	gSortHeights = NULL;
+
+	int pageCount = 0;
+	for (int n = 0; n < count; ++n)
+	{
+		int i = order[n];
+		placements[i] = (AtlasPlacement) { -1, 0, 0 };
+		if (widths[i] <= 0 || heights[i] <= 0) continue;
+
+		int w = widths[i] + padding;
+		int h = heights[i] + padding;
+
+		// first page with room wins
+		bool placed = false;
+		for (int p = 0; p < pageCount && !placed; ++p)
+		{
+			int index, x, y;
+			if (pages[p].size >= w && SkylineFind(&pages[p], w, h, &index, &x, &y))
+			{
+				SkylineInsert(&pages[p], index, x, y, w, h);
+				placements[i] = (AtlasPlacement) { p, x, y };
+				placed = true;
+			}
+		}
+		if (placed) continue;
+
+		// open a new page, oversized rects get one just big enough for themselves
+		int size = pageSize;
+		if (w > size) size = w;
+		if (h > size) size = h;
+		if (!SkylineInitPage(&pages[pageCount], size, count)) break;
+
+		int index, x, y;
+		SkylineFind(&pages[pageCount], w, h, &index, &x, &y);
+		SkylineInsert(&pages[pageCount], index, x, y, w, h);
+		placements[i] = (AtlasPlacement) { pageCount, x, y };
+		pageCount++;
+	}
+
+	for (int p = 0; p < pageCount; ++p)
+	{
+		if (pageWidths) pageWidths[p] = pages[p].usedWidth;
+		if (pageHeights) pageHeights[p] = pages[p].usedHeight;
+		free(pages[p].nodes);
+	}
+
+	free(pages);
+	free(order);
+	return pageCount;
+}
+
+
+int PackImageAtlas(const Image* images, int count, int pageSize, int padding,
+	AtlasPlacement* placements, Image** pages)
+{
+	*pages = NULL;
+	if (count <= 0) return 0;
+
+	int* widths = calloc(count, sizeof(int));
+	int* heights = calloc(count, sizeof(int));
+	int* pageWidths = calloc(count, sizeof(int));
+	int* pageHeights = calloc(count, sizeof(int));
+	int pageCount = 0;
+
+	if (widths && heights && pageWidths && pageHeights)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			if (!images[i].data) continue;
+			widths[i] = images[i].width;
+			heights[i] = images[i].height;
+		}
+
+		pageCount = PackAtlasRects(widths, heights, count, pageSize, padding, placements, pageWidths, pageHeights);
+		*pages = calloc(pageCount ? pageCount : 1, sizeof(Image));
+
+		for (int p = 0; p < pageCount && *pages; ++p)
+		{
+			Image* page = &(*pages)[p];
+			page->data = calloc((size_t)pageWidths[p] * pageHeights[p], 4);
+			page->width = pageWidths[p];
+			page->height = pageHeights[p];
+			page->mipmaps = 1;
+			page->format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+		}
+
+		// straight copies, the pages start out transparent
+		for (int i = 0; i < count && *pages; ++i)
+		{
+			const AtlasPlacement* at = &placements[i];
+			if (at->page < 0) continue;
+
+			Image* page = &(*pages)[at->page];
+			if (!page->data) continue;
+
+			for (int y = 0; y < images[i].height; ++y)
+			{
+				memcpy((unsigned char*)page->data + ((size_t)(at->y + y) * page->width + at->x) * 4,
+					(const unsigned char*)images[i].data + (size_t)y * images[i].width * 4,
+					(size_t)images[i].width * 4);
+			}
+		}
+	}
+
+	free(widths);
+	free(heights);
+	free(pageWidths);
+	free(pageHeights);
+	return pageCount;
+}
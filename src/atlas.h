@@ -0,0 +1,41 @@
+// Texture atlas packing.
+//
+// Packs a set of images into as few pages as possible using a skyline bottom-left packer.
+// Everything works on CPU-side RGBA8 Images, uploading the pages is left to the caller.
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include "raylib.h"
+
+// where an input image ended up in the atlas
+typedef struct AtlasPlacement
+{
+	int page;
+	int x;
+	int y;
+} AtlasPlacement;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Compute placements for count rects of the given sizes on pages of at most pageSize x pageSize,
+// keeping padding pixels between rects. Rects larger than a page get a page of their own.
+// Returns the number of pages used, and their used extents in pageWidths/pageHeights when
+// not NULL (arrays of at least count entries).
+int PackAtlasRects(const int* widths, const int* heights, int count, int pageSize, int padding,
+	AtlasPlacement* placements, int* pageWidths, int* pageHeights);
+
+// Pack RGBA8 images into atlas pages. Returns the number of pages and a malloc'd array of
+// new page images in *pages (free each with UnloadImage and the array with free).
+// Images with no data are skipped and get page -1.
+int PackImageAtlas(const Image* images, int count, int pageSize, int padding,
+	AtlasPlacement* placements, Image** pages);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // ATLAS_H
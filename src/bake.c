@@ -0,0 +1,125 @@
+#include "bake.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define kBakeMagic 0x454B4142	// "BAKE"
+#define kBakeVersion 1
+
+// Written in native byte order, baked files stay on the machine which baked them
+typedef struct BakedImageHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned long long sourceHash;
+	int flags;
+	int width;
+	int height;
+	int format;
+	int mipmaps;
+	int dataSize;
+	int reserved[6];			// pixels start 64 bytes in
+} BakedImageHeader;
+
+static volatile int gBakeCounter = 0;
+
+
+static void GetBakedImageFileName(unsigned long long sourceHash, int flags, char* fileName, size_t size)
+{
+	snprintf(fileName, size, "%s/%016llx-%x.img", kBakeDirectory, sourceHash, (unsigned int)flags);
+}
+
+
+// The size raylib gives an image with its mip chain
+static int GetImageDataSize(int width, int height, int format, int mipmaps)
+{
+	int size = 0;
+	for (int i = 0; i < mipmaps; ++i)
+	{
+		size += GetPixelDataSize(width, height, format);
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+	return size;
+}
+
+
+bool LoadBakedImage(unsigned long long sourceHash, int flags, BakedImage* baked)
+{
+	memset(baked, 0, sizeof(*baked));
+
+	char fileName[64];
+	GetBakedImageFileName(sourceHash, flags, fileName, sizeof(fileName));
+	if (!MapFile(fileName, &baked->map)) return false;
+
+	const BakedImageHeader* header = (const BakedImageHeader*)baked->map.data;
+	bool valid = baked->map.size >= sizeof(BakedImageHeader) &&
+		header->magic == kBakeMagic && header->version == kBakeVersion &&
+		header->sourceHash == sourceHash && header->flags == flags &&
+		header->width > 0 && header->height > 0 && header->mipmaps > 0 &&
+		header->dataSize == GetImageDataSize(header->width, header->height, header->format, header->mipmaps) &&
+		baked->map.size == sizeof(BakedImageHeader) + (size_t)header->dataSize;
+	if (!valid)
+	{
+		TraceLog(LOG_WARNING, "BAKE: [%s] Invalid baked image, baking it again", fileName);
+		UnmapFile(&baked->map);
+		return false;
+	}
+
+	baked->image.data = (void*)(baked->map.data + sizeof(BakedImageHeader));
+	baked->image.width = header->width;
+	baked->image.height = header->height;
+	baked->image.mipmaps = header->mipmaps;
+	baked->image.format = header->format;
+	return true;
+}
+
+
+void UnloadBakedImage(BakedImage* baked)
+{
+	UnmapFile(&baked->map);
+	memset(baked, 0, sizeof(*baked));
+}
+
+
+bool SaveBakedImage(unsigned long long sourceHash, int flags, Image* image)
+{
+	if (!image->data) return false;
+	if (flags & BakeFlag_Premultiplied) ImageAlphaPremultiply(image);
+	if ((flags & BakeFlag_Mipmaps) && image->mipmaps == 1) ImageMipmaps(image);
+	if (!CreateSysDirectory(kBakeDirectory)) return false;
+
+	BakedImageHeader header = { 0 };
+	header.magic = kBakeMagic;
+	header.version = kBakeVersion;
+	header.sourceHash = sourceHash;
+	header.flags = flags;
+	header.width = image->width;
+	header.height = image->height;
+	header.format = image->format;
+	header.mipmaps = image->mipmaps;
+	header.dataSize = GetImageDataSize(image->width, image->height, image->format, image->mipmaps);
+
+	// written next to its final name, then moved over it. Each bake has its own temporary
+	// file, so two threads baking the same image don't write into each other's.
+	char fileName[64];
+	char temporaryName[80];
+	GetBakedImageFileName(sourceHash, flags, fileName, sizeof(fileName));
+	snprintf(temporaryName, sizeof(temporaryName), "%s.%d.tmp", fileName, AtomicFetchAdd(&gBakeCounter, 1));
+
+	FILE* file = fopen(temporaryName, "wb");
+	if (!file) return false;
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(image->data, (size_t)header.dataSize, 1, file) == 1;
+	written = (fclose(file) == 0) && written;
+
+	if (!written || !ReplaceSysFile(temporaryName, fileName))
+	{
+		remove(temporaryName);
+		TraceLog(LOG_WARNING, "BAKE: [%s] Failed to write baked image", fileName);
+		return false;
+	}
+
+	TraceLog(LOG_INFO, "BAKE: [%s] Baked %dx%d, %.1f KB", fileName, image->width, image->height, header.dataSize / 1024.0f);
+	return true;
+}
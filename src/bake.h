@@ -0,0 +1,50 @@
+// Decoded images kept on disk between runs.
+//
+// Decoding a PNG or .aseprite file costs far more than reading its pixels back. The first
+// time an image is loaded its decoded pixels are written to the bake directory, under the
+// hash of the source file's contents; later loads map that file, and the image data points
+// straight into the mapping. An edited source hashes differently and is simply baked again;
+// the old file is never read and the directory can be deleted at any time.
+
+#ifndef BAKE_H
+#define BAKE_H
+
+#include "raylib.h"
+#include "sys.h"
+
+#define kBakeDirectory "bake"
+
+// Conversions applied before baking, part of the key of the baked image
+typedef enum BakeFlags
+{
+	BakeFlag_Premultiplied = 1 << 0,	// color multiplied by alpha
+	BakeFlag_Mipmaps = 1 << 1,			// full mip chain
+} BakeFlags;
+
+typedef struct BakedImage
+{
+	Image image;				// read only, points into map
+	SysFileMap map;
+} BakedImage;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Map the image baked from a source file with this content hash. Returns false if it hasn't
+// been baked with these flags, or the baked file is damaged.
+bool LoadBakedImage(unsigned long long sourceHash, int flags, BakedImage* baked);
+
+// Unmap the pixels, rather than UnloadImage()
+void UnloadBakedImage(BakedImage* baked);
+
+// Convert image as flags ask, in place, and write it to the bake directory. The file appears
+// whole or not at all, so a concurrent load never maps half of it.
+bool SaveBakedImage(unsigned long long sourceHash, int flags, Image* image);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // BAKE_H
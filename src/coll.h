@@ -1,5 +1,7 @@
 // A simple C API for 2d collision
 
+#ifndef COLL_H
+#define COLL_H
 
 typedef struct coll_grid_t
 {
@@ -57,3 +59,5 @@ int coll_sweep_aabb_grid(coll_grid_t grid, coll_aabb_t aabb, float ray_x, float
 #if defined(__cplusplus)
 }
 #endif
+
+#endif // COLL_H
@@ -0,0 +1,154 @@
+#include "draw_list.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+
+void InitDrawList(DrawList* list)
+{
+	memset(list, 0, sizeof(*list));
+}
+
+
+void FreeDrawList(DrawList* list)
+{
+	free(list->commands);
+	memset(list, 0, sizeof(*list));
+}
+
+
+void ResetDrawList(DrawList* list, Rectangle view)
+{
+	list->count = 0;
+	list->view = view;
+}
+
+
+static DrawCommand* PushDrawCommand(DrawList* list, DrawCommandType type, int layer)
+{
+	if (list->count == list->capacity)
+	{
+		int capacity = list->capacity ? list->capacity * 2 : 1024;
+		DrawCommand* commands = realloc(list->commands, capacity * sizeof(DrawCommand));
+		if (!commands) return NULL;
+		list->commands = commands;
+		list->capacity = capacity;
+	}
+
+	DrawCommand* cmd = &list->commands[list->count];
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->type = type;
+	cmd->layer = layer;
+	cmd->order = list->count++;
+	return cmd;
+}
+
+
+void DrawListTexture(DrawList* list, int layer, Texture texture, Rectangle src, Rectangle dst, Color tint)
+{
+	DrawCommand* cmd = PushDrawCommand(list, DrawCommand_Texture, layer);
+	if (!cmd) return;
+	cmd->texture = texture;
+	cmd->src = src;
+	cmd->dst = dst;
+	cmd->color = tint;
+}
+
+
+void DrawListRectangle(DrawList* list, int layer, Rectangle rec, Color color)
+{
+	DrawCommand* cmd = PushDrawCommand(list, DrawCommand_Rectangle, layer);
+	if (!cmd) return;
+	cmd->dst = rec;
+	cmd->color = color;
+}
+
+
+void DrawListRectangleLines(DrawList* list, int layer, Rectangle rec, float thick, Color color)
+{
+	DrawCommand* cmd = PushDrawCommand(list, DrawCommand_RectangleLines, layer);
+	if (!cmd) return;
+	cmd->dst = rec;
+	cmd->thick = thick;
+	cmd->color = color;
+}
+
+
+void DrawListLine(DrawList* list, int layer, Vector2 start, Vector2 end, Color color)
+{
+	DrawCommand* cmd = PushDrawCommand(list, DrawCommand_Line, layer);
+	if (!cmd) return;
+	cmd->dst = (Rectangle) { start.x, start.y, end.x, end.y };
+	cmd->color = color;
+}
+
+
+static int CompareDrawCommands(const void* a, const void* b)
+{
+	const DrawCommand* ca = a;
+	const DrawCommand* cb = b;
+	if (ca->layer != cb->layer) return (ca->layer < cb->layer) ? -1 : 1;
+	if (ca->texture.id != cb->texture.id) return (ca->texture.id < cb->texture.id) ? -1 : 1;
+	if (ca->type != cb->type) return (ca->type < cb->type) ? -1 : 1;
+	return ca->order - cb->order;
+}
+
+
+static float VisibleArea(Rectangle rec, Rectangle view)
+{
+	// flipped sources don't matter here, only the destination
+	float x0 = (rec.x > view.x) ? rec.x : view.x;
+	float y0 = (rec.y > view.y) ? rec.y : view.y;
+	float x1 = (rec.x + rec.width < view.x + view.width) ? rec.x + rec.width : view.x + view.width;
+	float y1 = (rec.y + rec.height < view.y + view.height) ? rec.y + rec.height : view.y + view.height;
+	if (x1 <= x0 || y1 <= y0) return 0.0f;
+	return (x1 - x0) * (y1 - y0);
+}
+
+
+void FlushDrawList(DrawList* list, const DrawBackend* backend)
+{
+	DrawListStats stats = { 0 };
+	stats.commands = list->count;
+
+	qsort(list->commands, list->count, sizeof(DrawCommand), CompareDrawCommands);
+
+	float covered = 0.0f;
+	unsigned int lastTexture = 0;
+	int start = 0;
+
+	for (int i = 0; i < list->count; ++i)
+	{
+		const DrawCommand* cmd = &list->commands[i];
+
+		if (cmd->type == DrawCommand_Texture || cmd->type == DrawCommand_Rectangle)
+		{
+			covered += VisibleArea(cmd->dst, list->view);
+		}
+
+		// close the batch when the next command can't join it
+		const DrawCommand* next = (i + 1 < list->count) ? &list->commands[i + 1] : NULL;
+		if (next && next->layer == cmd->layer && next->type == cmd->type && next->texture.id == cmd->texture.id)
+		{
+			continue;
+		}
+
+		if (stats.batches > 0 && cmd->texture.id != lastTexture)
+		{
+			stats.textureSwitches++;
+		}
+		lastTexture = cmd->texture.id;
+		stats.batches++;
+
+		if (backend && backend->submit)
+		{
+			backend->submit(backend->context, &list->commands[start], i + 1 - start);
+		}
+		start = i + 1;
+	}
+
+	float viewArea = list->view.width * list->view.height;
+	stats.overdraw = (viewArea > 0.0f) ? covered / viewArea : 0.0f;
+
+	list->stats = stats;
+}
@@ -0,0 +1,88 @@
+// A recordable list of 2d draw commands.
+//
+// World rendering appends commands instead of calling raylib directly. On flush the list is
+// sorted by layer then texture and handed to a backend in batches of commands sharing the
+// same texture. A list flushed without a backend only records, which allows counting draw
+// calls, texture switches and overdraw without a GPU.
+
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include "raylib.h"
+
+// Sort layers. Quads in the same layer must not overlap unless they share a texture, as
+// commands are reordered by texture within a layer.
+#define DRAW_LAYER_WORLD	0		// + layer index counted from the back
+#define DRAW_LAYER_ENTITIES	900
+#define DRAW_LAYER_PLAYER	1000
+#define DRAW_LAYER_DEBUG	2000
+
+typedef enum DrawCommandType
+{
+	DrawCommand_Texture,		// texture src rect drawn into dst rect
+	DrawCommand_Rectangle,		// filled dst rect
+	DrawCommand_RectangleLines,	// outline of dst rect, thick wide
+	DrawCommand_Line,			// line from (dst.x, dst.y) to (dst.width, dst.height)
+} DrawCommandType;
+
+typedef struct DrawCommand
+{
+	DrawCommandType type;
+	int layer;
+	int order;				// submission index, keeps the sort stable
+	Texture texture;		// id 0 for untextured shapes
+	Rectangle src;
+	Rectangle dst;
+	float thick;
+	Color color;
+} DrawCommand;
+
+// Receives the sorted commands of a flush in batches sharing layer, type and texture.
+typedef struct DrawBackend
+{
+	void (*submit)(void* context, const DrawCommand* commands, int count);
+	void* context;
+} DrawBackend;
+
+typedef struct DrawListStats
+{
+	int commands;
+	int batches;
+	int textureSwitches;
+	float overdraw;			// covered pixels of all quads / pixels of the view rect
+} DrawListStats;
+
+typedef struct DrawList
+{
+	DrawCommand* commands;
+	int count;
+	int capacity;
+	Rectangle view;			// world space rect being rendered, used for overdraw stats
+	DrawListStats stats;	// filled in by the last flush
+} DrawList;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+void InitDrawList(DrawList* list);
+void FreeDrawList(DrawList* list);
+
+// Start recording a new frame, keeps the allocated storage
+void ResetDrawList(DrawList* list, Rectangle view);
+
+void DrawListTexture(DrawList* list, int layer, Texture texture, Rectangle src, Rectangle dst, Color tint);
+void DrawListRectangle(DrawList* list, int layer, Rectangle rec, Color color);
+void DrawListRectangleLines(DrawList* list, int layer, Rectangle rec, float thick, Color color);
+void DrawListLine(DrawList* list, int layer, Vector2 start, Vector2 end, Color color);
+
+// Sort the recorded commands, compute stats and submit them in batches. backend may be NULL
+// to only record. Commands stay in the list, in sorted order, until the next reset.
+void FlushDrawList(DrawList* list, const DrawBackend* backend);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // DRAW_LIST_H
@@ -0,0 +1,198 @@
+#include "entities.h"
+#include "ldtk.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+	#define ENTITY_RESTRICT __restrict
+#else
+	#define ENTITY_RESTRICT restrict
+#endif
+
+
+void InitEntityStore(EntityStore* store)
+{
+	memset(store, 0, sizeof(*store));
+}
+
+
+// the component arrays with their element sizes, so they can be grown together
+#define ENTITY_COMPONENTS(store) \
+	{ (void**)&(store)->originX, sizeof(float) }, \
+	{ (void**)&(store)->originY, sizeof(float) }, \
+	{ (void**)&(store)->patrolX, sizeof(float) }, \
+	{ (void**)&(store)->patrolY, sizeof(float) }, \
+	{ (void**)&(store)->patrolRate, sizeof(float) }, \
+	{ (void**)&(store)->x, sizeof(float) }, \
+	{ (void**)&(store)->y, sizeof(float) }, \
+	{ (void**)&(store)->width, sizeof(float) }, \
+	{ (void**)&(store)->height, sizeof(float) }, \
+	{ (void**)&(store)->kind, sizeof(short) }, \
+	{ (void**)&(store)->depth, sizeof(int) }, \
+	{ (void**)&(store)->color, sizeof(Color) }
+
+typedef struct EntityComponent
+{
+	void** array;
+	size_t size;
+} EntityComponent;
+
+
+void FreeEntityStore(EntityStore* store)
+{
+	EntityComponent components[] = { ENTITY_COMPONENTS(store) };
+	for (int i = 0; i < (int)(sizeof(components) / sizeof(components[0])); ++i)
+	{
+		free(*components[i].array);
+	}
+	memset(store, 0, sizeof(*store));
+}
+
+
+static bool GrowEntityStore(EntityStore* store)
+{
+	int capacity = store->capacity ? store->capacity * 2 : 256;
+
+	// grown one by one, a failure leaves the arrays already grown bigger than needed
+	EntityComponent components[] = { ENTITY_COMPONENTS(store) };
+	for (int i = 0; i < (int)(sizeof(components) / sizeof(components[0])); ++i)
+	{
+		void* array = realloc(*components[i].array, capacity * components[i].size);
+		if (!array) return false;
+		*components[i].array = array;
+	}
+
+	store->capacity = capacity;
+	return true;
+}
+
+
+int GetEntityKind(EntityStore* store, const char* identifier)
+{
+	for (int i = 0; i < store->kindCount; ++i)
+	{
+		if (strcmp(store->kinds[i], identifier) == 0) return i;
+	}
+	if (store->kindCount == kMaxEntityKinds) return -1;
+
+	store->kinds[store->kindCount] = identifier;
+	return store->kindCount++;
+}
+
+
+int SpawnEntity(EntityStore* store, int kind, Rectangle rect, Vector2 patrol, float speed, int depth, Color color)
+{
+	if (store->count == store->capacity && !GrowEntityStore(store)) return -1;
+
+	int i = store->count++;
+	float length = sqrtf(patrol.x * patrol.x + patrol.y * patrol.y);
+
+	store->originX[i] = rect.x;
+	store->originY[i] = rect.y;
+	store->patrolX[i] = patrol.x;
+	store->patrolY[i] = patrol.y;
+	store->patrolRate[i] = (length > 0.0f) ? speed / (2.0f * length) : 0.0f;
+	store->x[i] = rect.x;
+	store->y[i] = rect.y;
+	store->width[i] = rect.width;
+	store->height[i] = rect.height;
+	store->kind[i] = (short)kind;
+	store->depth[i] = depth;
+	store->color[i] = color;
+	return i;
+}
+
+
+int SpawnWorldEntities(EntityStore* store, struct ldtk_world* world)
+{
+	int spawned = 0;
+	int levelCount = ldtk_get_level_count(world);
+	for (int l = 0; l < levelCount; ++l)
+	{
+		ldtk_level* level = ldtk_get_level(world, l);
+		for (int j = 0; j < level->layer_instances_count; ++j)
+		{
+			ldtk_layer_instance* inst = &level->layer_instances[j];
+			for (int e = 0; e < inst->entity_count; ++e)
+			{
+				const ldtk_entity* entity = &inst->entities[e];
+				if (strcmp(entity->identifier, "Player") == 0 || strcmp(entity->identifier, "PlayerStart") == 0) continue;
+
+				// px is the pivot, rects are stored by their top left corner
+				Rectangle rect = {
+					(float)(level->worldX + inst->px_offset_x + entity->px_x) - entity->pivot_x * entity->width,
+					(float)(level->worldY + inst->px_offset_y + entity->px_y) - entity->pivot_y * entity->height,
+					(float)entity->width,
+					(float)entity->height
+				};
+
+				// patrol to the cell of the last point, with the pivot in the same spot
+				Vector2 patrol = { 0 };
+				const ldtk_field* field = ldtk_find_field(entity, "patrol");
+				if (field && field->value_count > 0 && strstr(field->type, "Point"))
+				{
+					const ldtk_field_value* target = &field->values[field->value_count - 1];
+					patrol.x = (target->cx + entity->pivot_x) * inst->grid_size - entity->px_x;
+					patrol.y = (target->cy + entity->pivot_y) * inst->grid_size - entity->px_y;
+				}
+
+				Color color = {
+					(unsigned char)(entity->color >> 16),
+					(unsigned char)(entity->color >> 8),
+					(unsigned char)entity->color,
+					255
+				};
+
+				int kind = GetEntityKind(store, entity->identifier);
+				if (SpawnEntity(store, kind, rect, patrol, kEntityPatrolSpeed, level->worldDepth, color) < 0) return spawned;
+				spawned++;
+			}
+		}
+	}
+	return spawned;
+}
+
+
+// restrict parameters promise the compiler the arrays don't overlap, which lets it vectorize
+// without checking first
+static void UpdatePatrols(int count, float t, const float* ENTITY_RESTRICT originX, const float* ENTITY_RESTRICT originY,
+	const float* ENTITY_RESTRICT patrolX, const float* ENTITY_RESTRICT patrolY, const float* ENTITY_RESTRICT patrolRate,
+	float* ENTITY_RESTRICT x, float* ENTITY_RESTRICT y)
+{
+	// branch free: a triangle wave 0 -> 1 -> 0 over each patrol, static entities have a
+	// rate of 0 and stay at 0
+	for (int i = 0; i < count; ++i)
+	{
+		float phase = patrolRate[i] * t;
+		float fraction = phase - (float)(int)phase;
+		float along = 1.0f - fabsf(2.0f * fraction - 1.0f);
+		x[i] = originX[i] + patrolX[i] * along;
+		y[i] = originY[i] + patrolY[i] * along;
+	}
+}
+
+
+void UpdateEntities(EntityStore* store, float frame)
+{
+	UpdatePatrols(store->count, frame, store->originX, store->originY, store->patrolX, store->patrolY, store->patrolRate,
+		store->x, store->y);
+}
+
+
+int QueryEntities(const EntityStore* store, Rectangle area, int depth, int* indices, int maxIndices)
+{
+	int found = 0;
+	for (int i = 0; i < store->count; ++i)
+	{
+		bool overlaps = store->x[i] < area.x + area.width && store->x[i] + store->width[i] > area.x &&
+			store->y[i] < area.y + area.height && store->y[i] + store->height[i] > area.y &&
+			store->depth[i] == depth;
+		if (!overlaps) continue;
+
+		if (found < maxIndices) indices[found] = i;
+		found++;
+	}
+	return found;
+}
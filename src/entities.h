@@ -0,0 +1,77 @@
+// Entities placed in the world, stored as a structure of arrays.
+//
+// Every component is its own contiguous array indexed by entity, so the update only streams
+// through the arrays it needs and the loops vectorize. Entities are simple: they sit where
+// they were placed or patrol back and forth along a line. Their position is a function of
+// the frame number alone, so the timeline can be scrubbed or re-simulated without recording
+// entity state.
+
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#include "raylib.h"
+
+#define kMaxEntityKinds 64
+#define kEntityPatrolSpeed 0.5f		// pixels per frame
+
+struct ldtk_world;
+
+typedef struct EntityStore
+{
+	int count;
+	int capacity;
+
+	// read by UpdateEntities
+	float* originX;			// top left corner at frame 0
+	float* originY;
+	float* patrolX;			// offset to the far end of the patrol, 0 for static entities
+	float* patrolY;
+	float* patrolRate;		// patrols (there and back) per frame
+
+	// written by UpdateEntities, top left corner
+	float* x;
+	float* y;
+
+	float* width;
+	float* height;
+	short* kind;			// index into kinds, -1 if the table was full
+	int* depth;				// worldDepth of the level the entity is in
+	Color* color;
+
+	int kindCount;
+	const char* kinds[kMaxEntityKinds];		// identifiers, not owned
+} EntityStore;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+void InitEntityStore(EntityStore* store);
+void FreeEntityStore(EntityStore* store);
+
+// Index of an identifier in the kinds table, added if it's new. -1 if the table is full.
+int GetEntityKind(EntityStore* store, const char* identifier);
+
+// Add an entity at rect, patrolling to rect + patrol and back at speed pixels per frame.
+// Returns its index, or -1 if out of memory.
+int SpawnEntity(EntityStore* store, int kind, Rectangle rect, Vector2 patrol, float speed, int depth, Color color);
+
+// Spawn the entities of every Entities layer in the world, except the player which the game
+// simulates itself. A "patrol" Point field makes the entity patrol to that cell. Returns the
+// number spawned. Identifiers point into the world, which must outlive the store.
+int SpawnWorldEntities(EntityStore* store, struct ldtk_world* world);
+
+// Move every entity to where it is on frame, which is fractional for steps between frames
+// when the game ticks faster than the frames speeds are given in.
+void UpdateEntities(EntityStore* store, float frame);
+
+// Collect up to maxIndices entities at depth overlapping area, returns how many overlap in
+// total.
+int QueryEntities(const EntityStore* store, Rectangle area, int depth, int* indices, int maxIndices);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // ENTITIES_H
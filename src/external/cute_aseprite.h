@@ -102,6 +102,13 @@ ase_t* cute_aseprite_load_from_file(const char* path, void* mem_ctx);
 ase_t* cute_aseprite_load_from_memory(const void* memory, int size, void* mem_ctx);
 void cute_aseprite_free(ase_t* aseprite);
 
+// Inflate raw DEFLATE data (RFC 1951) into out, which must be large enough for all of it.
+// Returns 1 on success. Cels are decoded with cute_aseprite_inflate, a table driven decoder;
+// define CUTE_ASEPRITE_REFERENCE_INFLATE to decode them with the original bit at a time
+// decoder instead, which cute_aseprite_inflate_reference also exposes to check against.
+int cute_aseprite_inflate(const void* in, int in_bytes, void* out, int out_bytes, void* mem_ctx);
+int cute_aseprite_inflate_reference(const void* in, int in_bytes, void* out, int out_bytes, void* mem_ctx);
+
 #define CUTE_ASEPRITE_MAX_LAYERS (64)
 #define CUTE_ASEPRITE_MAX_SLICES (128)
 #define CUTE_ASEPRITE_MAX_PALETTE_ENTRIES (1024)
@@ -347,6 +354,24 @@ struct ase_t
 	#define CUTE_ASEPRITE_ASSERT assert
 #endif
 
+// Calls job(udata, i) for every i in [0, count), and returns once all calls have. Loading runs
+// inflating cels and composing frames through it, define it to spread them across threads.
+#if !defined(CUTE_ASEPRITE_PARALLEL_FOR)
+	#define CUTE_ASEPRITE_PARALLEL_FOR(count, job, udata) do { for (int parallel_for_i = 0; parallel_for_i < (count); ++parallel_for_i) (job)((udata), parallel_for_i); } while (0)
+#endif
+
+// Frames are blended four pixels at a time with SSE2 or NEON where available, define
+// CUTE_ASEPRITE_NO_SIMD to always use the scalar code. Both give the same pixels.
+#if !defined(CUTE_ASEPRITE_NO_SIMD)
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#include <emmintrin.h>
+		#define CUTE_ASEPRITE_SSE2
+	#elif defined(__aarch64__) || defined(_M_ARM64)
+		#include <arm_neon.h>
+		#define CUTE_ASEPRITE_NEON
+	#endif
+#endif
+
 #if !defined(CUTE_ASEPRITE_SEEK_SET)
 	#include <stdio.h> // SEEK_SET
 	#define CUTE_ASEPRITE_SEEK_SET SEEK_SET
@@ -388,7 +413,6 @@ struct ase_t
 #endif
 
 static const char* s_error_file = NULL; // The filepath of the file being parsed. NULL if from memory.
-static const char* s_error_reason;      // Used to capture errors during DEFLATE parsing.
 
 #if !defined(CUTE_ASEPRITE_WARNING)
 	#define CUTE_ASEPRITE_WARNING(msg) cute_aseprite_warning(msg, __LINE__)
@@ -403,7 +427,8 @@ static const char* s_error_reason;      // Used to capture errors during DEFLATE
 #endif
 
 #define CUTE_ASEPRITE_FAIL() do { goto ase_err; } while (0)
-#define CUTE_ASEPRITE_CHECK(X, Y) do { if (!(X)) { s_error_reason = Y; CUTE_ASEPRITE_FAIL(); } } while (0)
+// Only used while inflating, the reason is kept in the inflate state s so cels can be inflated in parallel.
+#define CUTE_ASEPRITE_CHECK(X, Y) do { if (!(X)) { s->error_reason = Y; CUTE_ASEPRITE_FAIL(); } } while (0)
 #define CUTE_ASEPRITE_CALL(X) do { if (!(X)) goto ase_err; } while (0)
 #define CUTE_ASEPRITE_DEFLATE_MAX_BITLEN 15
 
@@ -443,6 +468,8 @@ typedef struct deflate_t
 	uint32_t nlit;
 	uint32_t ndst;
 	uint32_t nlen;
+
+	const char* error_reason;
 } deflate_t;
 
 static int s_would_overflow(deflate_t* s, int num_bits)
@@ -674,10 +701,12 @@ ase_err:
 }
 
 // 3.2.3
-static int s_inflate(const void* in, int in_bytes, void* out, int out_bytes, void* mem_ctx)
+// On failure error_reason, if not NULL, is set to why.
+static int s_inflate(const void* in, int in_bytes, void* out, int out_bytes, void* mem_ctx, const char** error_reason)
 {
 	CUTE_ASEPRITE_UNUSED(mem_ctx);
 	deflate_t* s = (deflate_t*)CUTE_ASEPRITE_ALLOC(sizeof(deflate_t), mem_ctx);
+	s->error_reason = NULL;
 	s->bits = 0;
 	s->count = 0;
 	s->word_index = 0;
@@ -726,10 +755,411 @@ static int s_inflate(const void* in, int in_bytes, void* out, int out_bytes, voi
 	return 1;
 
 ase_err:
+	if (error_reason) *error_reason = s->error_reason;
+	CUTE_ASEPRITE_FREE(s, mem_ctx);
+	return 0;
+}
+
+// Table driven inflate, what cels are decoded with. s_inflate above is the original decoder,
+// kept as a reference to check this one against.
+//
+// Codes are decoded by looking up the next CUTE_ASEPRITE_FAST_BITS bits of input, codes longer
+// than that continue in a subtable stored after the root table. Length and distance entries
+// carry their base and extra bit count, and where two literal codes fit in the root bits one
+// entry holds both. Input goes through a 64-bit buffer refilled up to eight bytes at a time,
+// enough for a whole length/distance pair between refills.
+
+#define CUTE_ASEPRITE_FAST_BITS 10
+#define CUTE_ASEPRITE_FAST_TABLE_SIZE 2048
+
+// Table entries: bits 0-4 code length, 5-7 kind, 8-11 extra bits (subtable bits for links),
+// 16-31 value
+#define CUTE_ASEPRITE_FAST_LITERAL 0  // value is the byte
+#define CUTE_ASEPRITE_FAST_PAIR 1     // two literals, value is first | second << 8
+#define CUTE_ASEPRITE_FAST_BASE 2     // length or distance base
+#define CUTE_ASEPRITE_FAST_END 3      // end of block
+#define CUTE_ASEPRITE_FAST_LINK 4     // value is the subtable offset
+#define CUTE_ASEPRITE_FAST_INVALID 5  // code not in use
+#define CUTE_ASEPRITE_FAST_ENTRY(len, kind, extra, value) ((uint32_t)(len) | ((uint32_t)(kind) << 5) | ((uint32_t)(extra) << 8) | ((uint32_t)(value) << 16))
+#define CUTE_ASEPRITE_FAST_KIND(entry) (((entry) >> 5) & 7)
+
+typedef struct fast_deflate_t
+{
+	const uint8_t* in;
+	const uint8_t* in_end;
+	int overrun; // zero bytes shifted in after in_end
+	uint64_t bits;
+	int count;
+
+	uint8_t* out;
+	uint8_t* out_end;
+	uint8_t* begin;
+
+	uint32_t lit[CUTE_ASEPRITE_FAST_TABLE_SIZE];
+	uint32_t dst[CUTE_ASEPRITE_FAST_TABLE_SIZE];
+
+	const char* error_reason;
+} fast_deflate_t;
+
+// Fill the bit buffer to at least 56 bits
+static void s_fast_refill(fast_deflate_t* s)
+{
+	if (s->in_end - s->in >= 8)
+	{
+		// Bits past the new count are the start of the next byte, and are or'ed in again
+		// unchanged by the next refill. Compilers turn the shifts into a single load.
+		const uint8_t* p = s->in;
+		uint64_t word = (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+			((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+		s->bits |= word << s->count;
+		s->in += (63 - s->count) >> 3;
+		s->count |= 56;
+		return;
+	}
+
+	while (s->count <= 56)
+	{
+		if (s->in < s->in_end) s->bits |= (uint64_t)*s->in++ << s->count;
+		else s->overrun++;
+		s->count += 8;
+	}
+}
+
+static uint32_t s_fast_bits(fast_deflate_t* s, int num_bits)
+{
+	uint32_t bits = (uint32_t)(s->bits & (((uint64_t)1 << num_bits) - 1));
+	s->bits >>= num_bits;
+	s->count -= num_bits;
+	return bits;
+}
+
+// Bits read past the end of the input, rather than zeros shifted in but never used
+static int s_fast_overread(fast_deflate_t* s)
+{
+	return s->overrun * 8 > s->count;
+}
+
+// RFC 1951 section 3.2.2. Symbols below 256 are literals and 256 ends the block when literals
+// is set, the rest index base and extra from first_base on. Returns 0 for over-subscribed code
+// lengths, or lengths needing more subtable space than the table has.
+static int s_fast_build(uint32_t* table, const uint8_t* lens, int sym_count, int literals, int first_base, const uint32_t* base, const uint8_t* extra)
+{
+	const uint32_t root_mask = (1 << CUTE_ASEPRITE_FAST_BITS) - 1;
+	int counts[16] = { 0 };
+	int codes[16];
+
+	for (int i = 0; i < sym_count; ++i) counts[lens[i]]++;
+	counts[0] = 0;
+
+	int left = 1;
+	codes[0] = 0;
+	for (int len = 1; len < 16; ++len)
+	{
+		left = (left << 1) - counts[len];
+		if (left < 0) return 0;
+		codes[len] = (codes[len - 1] + counts[len - 1]) << 1;
+	}
+
+	// size each subtable by the longest code under its root entry
+	uint8_t sub_bits[1 << CUTE_ASEPRITE_FAST_BITS] = { 0 };
+	int next[16];
+	CUTE_ASEPRITE_MEMCPY(next, codes, sizeof(next));
+	for (int i = 0; i < sym_count; ++i)
+	{
+		int len = lens[i];
+		if (len <= CUTE_ASEPRITE_FAST_BITS) continue;
+		uint32_t root = (s_rev16((uint32_t)next[len]++) >> (16 - len)) & root_mask;
+		if (len - CUTE_ASEPRITE_FAST_BITS > sub_bits[root]) sub_bits[root] = (uint8_t)(len - CUTE_ASEPRITE_FAST_BITS);
+	}
+
+	int used = 1 << CUTE_ASEPRITE_FAST_BITS;
+	for (uint32_t i = 0; i <= root_mask; ++i)
+	{
+		table[i] = CUTE_ASEPRITE_FAST_ENTRY(0, CUTE_ASEPRITE_FAST_INVALID, 0, 0);
+		if (!sub_bits[i]) continue;
+
+		int size = 1 << sub_bits[i];
+		if (used + size > CUTE_ASEPRITE_FAST_TABLE_SIZE) return 0;
+		table[i] = CUTE_ASEPRITE_FAST_ENTRY(0, CUTE_ASEPRITE_FAST_LINK, sub_bits[i], used);
+		for (int j = 0; j < size; ++j) table[used + j] = CUTE_ASEPRITE_FAST_ENTRY(0, CUTE_ASEPRITE_FAST_INVALID, 0, 0);
+		used += size;
+	}
+
+	for (int i = 0; i < sym_count; ++i)
+	{
+		int len = lens[i];
+		if (!len) continue;
+
+		uint32_t entry = CUTE_ASEPRITE_FAST_ENTRY(len, CUTE_ASEPRITE_FAST_INVALID, 0, 0);
+		if (literals && i < 256) entry = CUTE_ASEPRITE_FAST_ENTRY(len, CUTE_ASEPRITE_FAST_LITERAL, 0, i);
+		else if (literals && i == 256) entry = CUTE_ASEPRITE_FAST_ENTRY(len, CUTE_ASEPRITE_FAST_END, 0, 0);
+		else if (base && base[i - first_base]) entry = CUTE_ASEPRITE_FAST_ENTRY(len, CUTE_ASEPRITE_FAST_BASE, extra[i - first_base], base[i - first_base]);
+
+		// codes are stored bit reversed, the order they are read in
+		uint32_t code = s_rev16((uint32_t)codes[len]++) >> (16 - len);
+		if (len <= CUTE_ASEPRITE_FAST_BITS)
+		{
+			for (uint32_t j = code; j <= root_mask; j += 1u << len) table[j] = entry;
+		}
+		else
+		{
+			uint32_t link = table[code & root_mask];
+			uint32_t* sub = table + (link >> 16);
+			uint32_t size = 1u << ((link >> 8) & 0xF);
+			for (uint32_t j = code >> CUTE_ASEPRITE_FAST_BITS; j < size; j += 1u << (len - CUTE_ASEPRITE_FAST_BITS)) sub[j] = entry;
+		}
+	}
+
+	// pair up literals whose codes fit in the root bits together
+	if (literals && base)
+	{
+		uint32_t single[1 << CUTE_ASEPRITE_FAST_BITS];
+		CUTE_ASEPRITE_MEMCPY(single, table, sizeof(single));
+		for (uint32_t i = 0; i <= root_mask; ++i)
+		{
+			uint32_t first = single[i];
+			uint32_t len = first & 0x1F;
+			if (CUTE_ASEPRITE_FAST_KIND(first) != CUTE_ASEPRITE_FAST_LITERAL) continue;
+
+			uint32_t second = single[i >> len];
+			uint32_t len2 = second & 0x1F;
+			if (CUTE_ASEPRITE_FAST_KIND(second) != CUTE_ASEPRITE_FAST_LITERAL || len + len2 > CUTE_ASEPRITE_FAST_BITS) continue;
+
+			table[i] = CUTE_ASEPRITE_FAST_ENTRY(len + len2, CUTE_ASEPRITE_FAST_PAIR, 0, (first >> 16) | ((second >> 16) << 8));
+		}
+	}
+
+	return 1;
+}
+
+// Decode one table entry, consuming its bits. Needs 15 bits in the buffer.
+static uint32_t s_fast_decode(fast_deflate_t* s, const uint32_t* table)
+{
+	uint32_t entry = table[s->bits & ((1 << CUTE_ASEPRITE_FAST_BITS) - 1)];
+	if (CUTE_ASEPRITE_FAST_KIND(entry) == CUTE_ASEPRITE_FAST_LINK)
+	{
+		uint32_t index = (uint32_t)(s->bits >> CUTE_ASEPRITE_FAST_BITS) & ((1u << ((entry >> 8) & 0xF)) - 1);
+		entry = table[(entry >> 16) + index];
+	}
+	s->bits >>= entry & 0x1F;
+	s->count -= (int)(entry & 0x1F);
+	return entry;
+}
+
+// 3.2.4
+static int s_fast_stored(fast_deflate_t* s)
+{
+	// skip to the byte boundary, then rewind the input to the first byte not consumed
+	s_fast_bits(s, s->count & 7);
+	const uint8_t* p = s->in + s->overrun - s->count / 8;
+	CUTE_ASEPRITE_CHECK(s->in_end - p >= 4, "Stored block header extends beyond end of input stream.");
+
+	uint16_t LEN = (uint16_t)(p[0] | (p[1] << 8));
+	uint16_t NLEN = (uint16_t)(p[2] | (p[3] << 8));
+	uint16_t TILDE_NLEN = (uint16_t)~NLEN;
+	CUTE_ASEPRITE_CHECK(LEN == TILDE_NLEN, "Failed to find LEN and NLEN as complements within stored (uncompressed) stream.");
+	p += 4;
+	CUTE_ASEPRITE_CHECK(s->in_end - p >= LEN, "Stored block extends beyond end of input stream.");
+	CUTE_ASEPRITE_CHECK(s->out_end - s->out >= LEN, "Attempted to overwrite out buffer while copying a stored block.");
+	CUTE_ASEPRITE_MEMCPY(s->out, p, LEN);
+	s->out += LEN;
+
+	s->in = p + LEN;
+	s->overrun = 0;
+	s->bits = 0;
+	s->count = 0;
+	return 1;
+
+ase_err:
+	return 0;
+}
+
+// 3.2.6
+static int s_fast_fixed(fast_deflate_t* s)
+{
+	s_fast_build(s->lit, s_fixed_table, 288, 1, 257, s_len_base, s_len_extra_bits);
+	s_fast_build(s->dst, s_fixed_table + 288, 32, 0, 0, s_dist_base, s_dist_extra_bits);
+	return 1;
+}
+
+// 3.2.7
+static int s_fast_dynamic(fast_deflate_t* s)
+{
+	uint8_t lenlens[19] = { 0 };
+	uint8_t lens[288 + 32];
+
+	s_fast_refill(s);
+	uint32_t nlit = 257 + s_fast_bits(s, 5);
+	uint32_t ndst = 1 + s_fast_bits(s, 5);
+	uint32_t nlen = 4 + s_fast_bits(s, 4);
+	CUTE_ASEPRITE_CHECK(nlit <= 286 && ndst <= 30, "Too many codes in dynamic block header.");
+
+	s_fast_refill(s);
+	for (uint32_t i = 0; i < nlen; ++i)
+		lenlens[s_permutation_order[i]] = (uint8_t)s_fast_bits(s, 3);
+
+	// code length codes decode as literals, without pairs
+	CUTE_ASEPRITE_CHECK(s_fast_build(s->lit, lenlens, 19, 1, 0, NULL, NULL), "Invalid code length code lengths.");
+
+	for (uint32_t n = 0; n < nlit + ndst;)
+	{
+		if (s->count < 32) s_fast_refill(s);
+		uint32_t entry = s_fast_decode(s, s->lit);
+		CUTE_ASEPRITE_CHECK(CUTE_ASEPRITE_FAST_KIND(entry) == CUTE_ASEPRITE_FAST_LITERAL, "Invalid code length code.");
+
+		uint32_t sym = entry >> 16;
+		uint32_t repeat = 1;
+		uint8_t len = (uint8_t)sym;
+		switch (sym)
+		{
+		case 16: CUTE_ASEPRITE_CHECK(n > 0, "Code length repeated before the first."); len = lens[n - 1]; repeat = 3 + s_fast_bits(s, 2); break;
+		case 17: len = 0; repeat = 3 + s_fast_bits(s, 3); break;
+		case 18: len = 0; repeat = 11 + s_fast_bits(s, 7); break;
+		}
+		CUTE_ASEPRITE_CHECK(n + repeat <= nlit + ndst, "Code lengths repeated past the last code.");
+		for (; repeat; --repeat) lens[n++] = len;
+	}
+
+	CUTE_ASEPRITE_CHECK(s_fast_build(s->lit, lens, (int)nlit, 1, 257, s_len_base, s_len_extra_bits), "Invalid literal/length code lengths.");
+	CUTE_ASEPRITE_CHECK(s_fast_build(s->dst, lens + nlit, (int)ndst, 0, 0, s_dist_base, s_dist_extra_bits), "Invalid distance code lengths.");
+	return 1;
+
+ase_err:
+	return 0;
+}
+
+// 3.2.3
+static int s_fast_block(fast_deflate_t* s)
+{
+	uint8_t* out = s->out;
+	uint8_t* out_end = s->out_end;
+
+	while (1)
+	{
+		// a length code with its extra bits takes at most 20 bits
+		if (s->count < 32) s_fast_refill(s);
+		uint32_t entry = s_fast_decode(s, s->lit);
+		uint32_t kind = CUTE_ASEPRITE_FAST_KIND(entry);
+
+		if (kind == CUTE_ASEPRITE_FAST_PAIR)
+		{
+			CUTE_ASEPRITE_CHECK(out_end - out >= 2, "Attempted to overwrite out buffer while outputting a symbol.");
+			out[0] = (uint8_t)(entry >> 16);
+			out[1] = (uint8_t)(entry >> 24);
+			out += 2;
+		}
+
+		else if (kind == CUTE_ASEPRITE_FAST_LITERAL)
+		{
+			CUTE_ASEPRITE_CHECK(out < out_end, "Attempted to overwrite out buffer while outputting a symbol.");
+			*out++ = (uint8_t)(entry >> 16);
+		}
+
+		else if (kind == CUTE_ASEPRITE_FAST_BASE)
+		{
+			uint32_t length = (entry >> 16) + s_fast_bits(s, (int)((entry >> 8) & 0xF));
+
+			// and a distance code with its extra bits at most 28
+			if (s->count < 28) s_fast_refill(s);
+			entry = s_fast_decode(s, s->dst);
+			CUTE_ASEPRITE_CHECK(CUTE_ASEPRITE_FAST_KIND(entry) == CUTE_ASEPRITE_FAST_BASE, "Invalid distance code.");
+			uint32_t distance = (entry >> 16) + s_fast_bits(s, (int)((entry >> 8) & 0xF));
+
+			CUTE_ASEPRITE_CHECK(distance <= (uint32_t)(out - s->begin), "Attempted to write before out buffer (invalid backwards distance).");
+			CUTE_ASEPRITE_CHECK(length <= (uint32_t)(out_end - out), "Attempted to overwrite out buffer while outputting a string.");
+			const uint8_t* src = out - distance;
+			uint8_t* dst = out;
+			out += length;
+
+			if (distance == 1)
+			{
+				// runs of one colour, very common in images
+				CUTE_ASEPRITE_MEMSET(dst, *src, (size_t)length);
+			}
+			else if (distance >= 8 && (size_t)(out_end - dst) >= (size_t)length + 8)
+			{
+				// eight bytes at a time never reads bytes it writes, and may write up to
+				// seven past the match, which later output overwrites
+				for (uint8_t* end = dst + length; dst < end; dst += 8, src += 8) CUTE_ASEPRITE_MEMCPY(dst, src, 8);
+			}
+			else
+			{
+				while (length--) *dst++ = *src++;
+			}
+		}
+
+		else if (kind == CUTE_ASEPRITE_FAST_END) break;
+
+		else CUTE_ASEPRITE_CHECK(0, "Invalid literal/length code.");
+	}
+
+	s->out = out;
+	CUTE_ASEPRITE_CHECK(!s_fast_overread(s), "Compressed block extends beyond end of input stream.");
+	return 1;
+
+ase_err:
+	s->out = out;
+	return 0;
+}
+
+// 3.2.3
+// On failure error_reason, if not NULL, is set to why.
+static int s_fast_inflate(const void* in, int in_bytes, void* out, int out_bytes, void* mem_ctx, const char** error_reason)
+{
+	CUTE_ASEPRITE_UNUSED(mem_ctx);
+	fast_deflate_t* s = (fast_deflate_t*)CUTE_ASEPRITE_ALLOC(sizeof(fast_deflate_t), mem_ctx);
+	if (!s)
+	{
+		if (error_reason) *error_reason = "Out of memory for inflate state.";
+		return 0;
+	}
+	s->error_reason = NULL;
+	s->in = (const uint8_t*)in;
+	s->in_end = s->in + in_bytes;
+	s->overrun = 0;
+	s->bits = 0;
+	s->count = 0;
+	s->out = (uint8_t*)out;
+	s->out_end = s->out + out_bytes;
+	s->begin = (uint8_t*)out;
+
+	uint32_t bfinal;
+	do
+	{
+		s_fast_refill(s);
+		bfinal = s_fast_bits(s, 1);
+		uint32_t btype = s_fast_bits(s, 2);
+		CUTE_ASEPRITE_CHECK(!s_fast_overread(s), "Block header extends beyond end of input stream.");
+
+		switch (btype)
+		{
+		case 0: CUTE_ASEPRITE_CALL(s_fast_stored(s)); break;
+		case 1: s_fast_fixed(s); CUTE_ASEPRITE_CALL(s_fast_block(s)); break;
+		case 2: CUTE_ASEPRITE_CALL(s_fast_dynamic(s)); CUTE_ASEPRITE_CALL(s_fast_block(s)); break;
+		case 3: CUTE_ASEPRITE_CHECK(0, "Detected unknown block type within input stream.");
+		}
+	}
+	while (!bfinal);
+
+	CUTE_ASEPRITE_FREE(s, mem_ctx);
+	return 1;
+
+ase_err:
+	if (error_reason) *error_reason = s->error_reason;
 	CUTE_ASEPRITE_FREE(s, mem_ctx);
 	return 0;
 }
 
+int cute_aseprite_inflate(const void* in, int in_bytes, void* out, int out_bytes, void* mem_ctx)
+{
+	return s_fast_inflate(in, in_bytes, out, out_bytes, mem_ctx, NULL);
+}
+
+int cute_aseprite_inflate_reference(const void* in, int in_bytes, void* out, int out_bytes, void* mem_ctx)
+{
+	return s_inflate(in, in_bytes, out, out_bytes, mem_ctx, NULL);
+}
+
 typedef struct ase_state_t
 {
 	uint8_t* in;
@@ -922,6 +1352,183 @@ static ase_color_t s_color(ase_t* ase, void* src, int index)
 	return result;
 }
 
+typedef struct ase_inflate_job_t
+{
+	const void* in;
+	int in_bytes;
+	void* out;
+	int out_bytes;
+	void* mem_ctx;
+
+	// written by the job, reported once all jobs are done
+	int ok;
+	const char* error_reason;
+} ase_inflate_job_t;
+
+static void s_inflate_job(void* udata, int index)
+{
+	ase_inflate_job_t* job = (ase_inflate_job_t*)udata + index;
+#ifdef CUTE_ASEPRITE_REFERENCE_INFLATE
+	job->ok = s_inflate(job->in, job->in_bytes, job->out, job->out_bytes, job->mem_ctx, &job->error_reason);
+#else
+	job->ok = s_fast_inflate(job->in, job->in_bytes, job->out, job->out_bytes, job->mem_ctx, &job->error_reason);
+#endif
+}
+
+#if defined(CUTE_ASEPRITE_SSE2)
+
+static __m128i s_mul_un8_sse2(__m128i a, __m128i b)
+{
+	// 32-bit lanes holding bytes, so the 16-bit multiply gives the whole product
+	__m128i t = _mm_add_epi32(_mm_mullo_epi16(a, b), _mm_set1_epi32(0x80));
+	return _mm_srli_epi32(_mm_add_epi32(_mm_srli_epi32(t, 8), t), 8);
+}
+
+static __m128i s_blend_channel_sse2(__m128i src, __m128i dst, __m128 src_a, __m128 a)
+{
+	// (src - dst) * src_a is exact in a float and the quotient is never close enough to an
+	// integer to round onto it, so truncating matches the integer division
+	__m128 delta = _mm_mul_ps(_mm_cvtepi32_ps(_mm_sub_epi32(src, dst)), src_a);
+	__m128i result = _mm_add_epi32(dst, _mm_cvttps_epi32(_mm_div_ps(delta, a)));
+	return _mm_and_si128(result, _mm_set1_epi32(0xFF));
+}
+
+#elif defined(CUTE_ASEPRITE_NEON)
+
+static uint32x4_t s_mul_un8_neon(uint32x4_t a, uint32x4_t b)
+{
+	uint32x4_t t = vmlaq_u32(vdupq_n_u32(0x80), a, b);
+	return vshrq_n_u32(vaddq_u32(vshrq_n_u32(t, 8), t), 8);
+}
+
+static uint32x4_t s_blend_channel_neon(uint32x4_t src, uint32x4_t dst, float32x4_t src_a, float32x4_t a)
+{
+	// exact, see s_blend_channel_sse2
+	int32x4_t delta = vsubq_s32(vreinterpretq_s32_u32(src), vreinterpretq_s32_u32(dst));
+	float32x4_t quotient = vdivq_f32(vmulq_f32(vcvtq_f32_s32(delta), src_a), a);
+	int32x4_t result = vaddq_s32(vreinterpretq_s32_u32(dst), vcvtq_s32_f32(quotient));
+	return vandq_u32(vreinterpretq_u32_s32(result), vdupq_n_u32(0xFF));
+}
+
+#endif
+
+// s_blend over a row of pixels
+static void s_blend_row(ase_color_t* dst, const ase_color_t* src, int count, uint8_t opacity)
+{
+	int i = 0;
+
+#if defined(CUTE_ASEPRITE_SSE2)
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	const __m128i op = _mm_set1_epi32(opacity);
+	for (; i + 4 <= count; i += 4) {
+		__m128i s = _mm_loadu_si128((const __m128i*)(src + i));
+		__m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+		__m128i src_a = s_mul_un8_sse2(_mm_srli_epi32(s, 24), op);
+		__m128i dst_a = _mm_srli_epi32(d, 24);
+		__m128i a = _mm_sub_epi32(_mm_add_epi32(src_a, dst_a), s_mul_un8_sse2(src_a, dst_a));
+		__m128 fsrc_a = _mm_cvtepi32_ps(src_a);
+		__m128 fa = _mm_cvtepi32_ps(a);
+
+		__m128i r = s_blend_channel_sse2(_mm_and_si128(s, mask), _mm_and_si128(d, mask), fsrc_a, fa);
+		__m128i g = s_blend_channel_sse2(_mm_and_si128(_mm_srli_epi32(s, 8), mask), _mm_and_si128(_mm_srli_epi32(d, 8), mask), fsrc_a, fa);
+		__m128i b = s_blend_channel_sse2(_mm_and_si128(_mm_srli_epi32(s, 16), mask), _mm_and_si128(_mm_srli_epi32(d, 16), mask), fsrc_a, fa);
+		__m128i result = _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 8)), _mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+
+		// fully transparent results are all zero
+		result = _mm_andnot_si128(_mm_cmpeq_epi32(a, _mm_setzero_si128()), result);
+		_mm_storeu_si128((__m128i*)(dst + i), result);
+	}
+#elif defined(CUTE_ASEPRITE_NEON)
+	const uint32x4_t mask = vdupq_n_u32(0xFF);
+	const uint32x4_t op = vdupq_n_u32(opacity);
+	for (; i + 4 <= count; i += 4) {
+		uint32x4_t s = vld1q_u32((const uint32_t*)(src + i));
+		uint32x4_t d = vld1q_u32((const uint32_t*)(dst + i));
+		uint32x4_t src_a = s_mul_un8_neon(vshrq_n_u32(s, 24), op);
+		uint32x4_t dst_a = vshrq_n_u32(d, 24);
+		uint32x4_t a = vsubq_u32(vaddq_u32(src_a, dst_a), s_mul_un8_neon(src_a, dst_a));
+		float32x4_t fsrc_a = vcvtq_f32_u32(src_a);
+		float32x4_t fa = vcvtq_f32_u32(a);
+
+		uint32x4_t r = s_blend_channel_neon(vandq_u32(s, mask), vandq_u32(d, mask), fsrc_a, fa);
+		uint32x4_t g = s_blend_channel_neon(vandq_u32(vshrq_n_u32(s, 8), mask), vandq_u32(vshrq_n_u32(d, 8), mask), fsrc_a, fa);
+		uint32x4_t b = s_blend_channel_neon(vandq_u32(vshrq_n_u32(s, 16), mask), vandq_u32(vshrq_n_u32(d, 16), mask), fsrc_a, fa);
+		uint32x4_t result = vorrq_u32(vorrq_u32(r, vshlq_n_u32(g, 8)), vorrq_u32(vshlq_n_u32(b, 16), vshlq_n_u32(a, 24)));
+
+		// fully transparent results are all zero
+		result = vbicq_u32(result, vceqq_u32(a, vdupq_n_u32(0)));
+		vst1q_u32((uint32_t*)(dst + i), result);
+	}
+#endif
+
+	for (; i < count; ++i) {
+		dst[i] = s_blend(src[i], dst[i], opacity);
+	}
+}
+
+static void s_compose_frame_job(void* udata, int index)
+{
+	ase_t* ase = (ase_t*)udata;
+	ase_frame_t* frame = ase->frames + index;
+	frame->pixels = (ase_color_t*)CUTE_ASEPRITE_ALLOC((int)(sizeof(ase_color_t)) * ase->w * ase->h, ase->mem_ctx);
+	CUTE_ASEPRITE_MEMSET(frame->pixels, 0, sizeof(ase_color_t) * (size_t)ase->w * (size_t)ase->h);
+	ase_color_t* dst = frame->pixels;
+	ase_color_t* row = NULL;
+	for (int j = 0; j < frame->cel_count; ++j) {
+		ase_cel_t* cel = frame->cels + j;
+		if (!(cel->layer->flags & ASE_LAYER_FLAGS_VISIBLE)) {
+			continue;
+		}
+		if (cel->layer->parent && !(cel->layer->parent->flags & ASE_LAYER_FLAGS_VISIBLE)) {
+			continue;
+		}
+		while (cel->is_linked) {
+			ase_frame_t* frame = ase->frames + cel->linked_frame_index;
+			int found = 0;
+			for (int k = 0; k < frame->cel_count; ++k) {
+				if (frame->cels[k].layer == cel->layer) {
+					cel = frame->cels + k;
+					found = 1;
+					break;
+				}
+			}
+			CUTE_ASEPRITE_ASSERT(found);
+		}
+		void* src = cel->pixels;
+		uint8_t opacity = (uint8_t)(cel->opacity * cel->layer->opacity * 255.0f);
+		int cx = cel->x;
+		int cy = cel->y;
+		int cw = cel->w;
+		int ch = cel->h;
+		int cl = -s_min(cx, 0);
+		int ct = -s_min(cy, 0);
+		int dl = s_max(cx, 0);
+		int dt = s_max(cy, 0);
+		int dr = s_min(ase->w, cw + cx);
+		int db = s_min(ase->h, ch + cy);
+		int aw = ase->w;
+		if (dr <= dl) continue;
+
+		// Grayscale and indexed cels are converted a row at a time, RGBA blends straight from the cel.
+		if (ase->mode != ASE_MODE_RGBA && !row) {
+			row = (ase_color_t*)CUTE_ASEPRITE_ALLOC((int)(sizeof(ase_color_t)) * aw, ase->mem_ctx);
+		}
+		for (int dy = dt, sy = ct; dy < db; dy++, sy++) {
+			const ase_color_t* src_row;
+			if (ase->mode == ASE_MODE_RGBA) {
+				src_row = (const ase_color_t*)src + cw * sy + cl;
+			} else {
+				for (int dx = dl, sx = cl; dx < dr; dx++, sx++) {
+					row[dx - dl] = s_color(ase, src, cw * sy + sx);
+				}
+				src_row = row;
+			}
+			s_blend_row(dst + aw * dy + dl, src_row, dr - dl, opacity);
+		}
+	}
+	if (row) CUTE_ASEPRITE_FREE(row, ase->mem_ctx);
+}
+
 ase_t* cute_aseprite_load_from_memory(const void* memory, int size, void* mem_ctx)
 {
 	ase_t* ase = (ase_t*)CUTE_ASEPRITE_ALLOC(sizeof(ase_t), mem_ctx);
@@ -970,6 +1577,10 @@ ase_t* cute_aseprite_load_from_memory(const void* memory, int size, void* mem_ct
 
 	ase_layer_t* layer_stack[CUTE_ASEPRITE_MAX_LAYERS];
 
+	ase_inflate_job_t* inflate_jobs = NULL;
+	int inflate_count = 0;
+	int inflate_capacity = 0;
+
 	// Parse all chunks in the .aseprite file.
 	for (int i = 0; i < ase->frame_count; ++i) {
 		ase_frame_t* frame = ase->frames + i;
@@ -1051,10 +1662,25 @@ ase_t* cute_aseprite_load_from_memory(const void* memory, int size, void* mem_ct
 					CUTE_ASEPRITE_ASSERT((zlib_byte0 & 0xF0) <= 0x70); // Innapropriate window size detected.
 					CUTE_ASEPRITE_ASSERT(!(zlib_byte1 & 0x20)); // Preset dictionary is present and not supported.
 					int pixels_sz = cel->w * cel->h * bpp;
-					void* pixels_decompressed = CUTE_ASEPRITE_ALLOC(pixels_sz, mem_ctx);
-					int ret = s_inflate(pixels, deflate_bytes, pixels_decompressed, pixels_sz, mem_ctx);
-					if (!ret) CUTE_ASEPRITE_WARNING(s_error_reason);
-					cel->pixels = pixels_decompressed;
+					cel->pixels = CUTE_ASEPRITE_ALLOC(pixels_sz, mem_ctx);
+
+					// Inflated once all chunks are read, in parallel with other cels.
+					if (inflate_count == inflate_capacity) {
+						int capacity = inflate_capacity ? inflate_capacity * 2 : 64;
+						ase_inflate_job_t* jobs = (ase_inflate_job_t*)CUTE_ASEPRITE_ALLOC(sizeof(ase_inflate_job_t) * capacity, mem_ctx);
+						if (inflate_count) CUTE_ASEPRITE_MEMCPY(jobs, inflate_jobs, sizeof(ase_inflate_job_t) * inflate_count);
+						if (inflate_jobs) CUTE_ASEPRITE_FREE(inflate_jobs, mem_ctx);
+						inflate_jobs = jobs;
+						inflate_capacity = capacity;
+					}
+					ase_inflate_job_t* job = inflate_jobs + inflate_count++;
+					job->in = pixels;
+					job->in_bytes = deflate_bytes;
+					job->out = cel->pixels;
+					job->out_bytes = pixels_sz;
+					job->mem_ctx = mem_ctx;
+					job->ok = 0;
+					job->error_reason = NULL;
 					s_skip(s, deflate_bytes);
 				}	break;
 				}
@@ -1198,58 +1824,16 @@ ase_t* cute_aseprite_load_from_memory(const void* memory, int size, void* mem_ct
 		}
 	}
 
-	// Blend all cel pixels into each of their respective frames, for convenience.
-	for (int i = 0; i < ase->frame_count; ++i) {
-		ase_frame_t* frame = ase->frames + i;
-		frame->pixels = (ase_color_t*)CUTE_ASEPRITE_ALLOC((int)(sizeof(ase_color_t)) * ase->w * ase->h, mem_ctx);
-		CUTE_ASEPRITE_MEMSET(frame->pixels, 0, sizeof(ase_color_t) * (size_t)ase->w * (size_t)ase->h);
-		ase_color_t* dst = frame->pixels;
-		for (int j = 0; j < frame->cel_count; ++j) {
-			ase_cel_t* cel = frame->cels + j;
-			if (!(cel->layer->flags & ASE_LAYER_FLAGS_VISIBLE)) {
-				continue;
-			}
-			if (cel->layer->parent && !(cel->layer->parent->flags & ASE_LAYER_FLAGS_VISIBLE)) {
-				continue;
-			}
-			while (cel->is_linked) {
-				ase_frame_t* frame = ase->frames + cel->linked_frame_index;
-				int found = 0;
-				for (int k = 0; k < frame->cel_count; ++k) {
-					if (frame->cels[k].layer == cel->layer) {
-						cel = frame->cels + k;
-						found = 1;
-						break;
-					}
-				}
-				CUTE_ASEPRITE_ASSERT(found);
-			}
-			void* src = cel->pixels;
-			uint8_t opacity = (uint8_t)(cel->opacity * cel->layer->opacity * 255.0f);
-			int cx = cel->x;
-			int cy = cel->y;
-			int cw = cel->w;
-			int ch = cel->h;
-			int cl = -s_min(cx, 0);
-			int ct = -s_min(cy, 0);
-			int dl = s_max(cx, 0);
-			int dt = s_max(cy, 0);
-			int dr = s_min(ase->w, cw + cx);
-			int db = s_min(ase->h, ch + cy);
-			int aw = ase->w;
-			for (int dx = dl, sx = cl; dx < dr; dx++, sx++) {
-				for (int dy = dt, sy = ct; dy < db; dy++, sy++) {
-					int dst_index = aw * dy + dx;
-					ase_color_t src_color = s_color(ase, src, cw * sy + sx);
-					ase_color_t dst_color = dst[dst_index];
-					ase_color_t result = s_blend(src_color, dst_color, opacity);
-					dst[dst_index] = result;
-				}
-			}
-		}
+	// Decompress all cels, then blend them into each of their respective frames, for convenience.
+	CUTE_ASEPRITE_PARALLEL_FOR(inflate_count, s_inflate_job, inflate_jobs);
+	for (int i = 0; i < inflate_count; ++i)
+	{
+		if (!inflate_jobs[i].ok) CUTE_ASEPRITE_WARNING(inflate_jobs[i].error_reason);
 	}
-
+	if (inflate_jobs) CUTE_ASEPRITE_FREE(inflate_jobs, mem_ctx);
 	ase->mem_ctx = mem_ctx;
+	CUTE_ASEPRITE_PARALLEL_FOR(ase->frame_count, s_compose_frame_job, ase);
+
 	return ase;
 }
 
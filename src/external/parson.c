@@ -61,6 +61,8 @@
 #define strcpy USE_MEMCPY_INSTEAD_OF_STRCPY
 
 #define STARTING_CAPACITY 16
+#define ARRAY_STACK_ITEMS 8 /* items of an array being parsed kept on the stack */
+#define ARRAY_STACK_NUMBERS 64 /* numbers of a packed array being parsed kept on the stack */
 #define MAX_NESTING       2048
 
 #ifndef PARSON_DEFAULT_FLOAT_FORMAT
@@ -73,8 +75,10 @@
 
 #define SIZEOF_TOKEN(a)       (sizeof(a) - 1)
 #define SKIP_CHAR(str)        ((*str)++)
-#define SKIP_WHITESPACES(str) while (isspace((unsigned char)(**str))) { SKIP_CHAR(str); }
+#define SKIP_WHITESPACES(str) do { if (isspace((unsigned char)(**str))) { SKIP_CHAR(str);\
+                                     if (isspace((unsigned char)(**str))) { skip_whitespaces(str); } } } while (0)
 #define MAX(a, b)             ((a) > (b) ? (a) : (b))
+#define MIN(a, b)             ((a) < (b) ? (a) : (b))
 
 #undef malloc
 #undef free
@@ -87,8 +91,22 @@
 
 #define OBJECT_INVALID_IX ((size_t)-1)
 
-static JSON_Malloc_Function parson_malloc = malloc;
-static JSON_Free_Function parson_free = free;
+#ifndef PARSON_ARENA_ALIGNMENT
+#define PARSON_ARENA_ALIGNMENT 8 /* enough for doubles, pointers and size_t */
+#endif
+
+/* The arena json_parse_*_in_arena is filling, per thread so several threads can parse at once */
+#if defined(_MSC_VER)
+#define PARSON_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__) || defined(__clang__)
+#define PARSON_THREAD_LOCAL __thread
+#else
+#define PARSON_THREAD_LOCAL
+#endif
+
+static JSON_Malloc_Function parson_malloc_fun = malloc;
+static JSON_Free_Function parson_free_fun = free;
+static PARSON_THREAD_LOCAL JSON_Arena *parson_arena = NULL;
 
 static int parson_escape_slashes = 1;
 
@@ -96,11 +114,90 @@ static char *parson_float_format = NULL;
 
 #define IS_CONT(b) (((unsigned char)(b) & 0xC0) == 0x80) /* is utf-8 continuation byte */
 
+/* Reads that may go past the end of the string, but never across a page, are hidden from
+   address sanitizers */
+#if defined(__GNUC__) || defined(__clang__)
+#define PARSON_NO_SANITIZE_ADDRESS __attribute__((no_sanitize_address))
+#else
+#define PARSON_NO_SANITIZE_ADDRESS
+#endif
+
+/* Digits of packed number arrays are read 8 at a time from a 64 bit word, which needs the first
+   digit in the lowest byte. The word may read past the end of the string, but never across a
+   page. */
+#if (defined(__GNUC__) || defined(__clang__)) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define PARSON_SWAR_DIGITS 1
+#define PARSON_SWAR_PAGE_SIZE 4096 /* smallest page size of the supported platforms */
+#endif
+
+/* Strings and whitespace are scanned a block at a time with AVX2, SSE2 or NEON, byte by byte
+   elsewhere. Scans up to the null character load aligned blocks, which may go past the end of
+   the string but never across a page. A block's mask has PARSON_SIMD_MASK_BITS bits per byte. */
+#if defined(PARSON_NO_SIMD)
+#elif defined(__AVX2__)
+#include <immintrin.h>
+typedef __m256i parson_simd_t;
+#define PARSON_SIMD_BLOCK           32
+#define PARSON_SIMD_MASK_BITS       1
+#define PARSON_SIMD_FULL_MASK       0xFFFFFFFFULL
+#define PARSON_SIMD_LOAD(p)         _mm256_loadu_si256((const __m256i*)(const void*)(p))
+#define PARSON_SIMD_SPLAT(c)        _mm256_set1_epi8((char)(c))
+#define PARSON_SIMD_EQ(a, b)        _mm256_cmpeq_epi8((a), (b))
+#define PARSON_SIMD_LE(a, b)        _mm256_cmpeq_epi8(_mm256_min_epu8((a), (b)), (a)) /* unsigned */
+#define PARSON_SIMD_SUB(a, b)       _mm256_sub_epi8((a), (b))
+#define PARSON_SIMD_OR(a, b)        _mm256_or_si256((a), (b))
+#define PARSON_SIMD_MASK(a)         ((unsigned long long)(unsigned int)_mm256_movemask_epi8(a))
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+typedef __m128i parson_simd_t;
+#define PARSON_SIMD_BLOCK           16
+#define PARSON_SIMD_MASK_BITS       1
+#define PARSON_SIMD_FULL_MASK       0xFFFFULL
+#define PARSON_SIMD_LOAD(p)         _mm_loadu_si128((const __m128i*)(const void*)(p))
+#define PARSON_SIMD_SPLAT(c)        _mm_set1_epi8((char)(c))
+#define PARSON_SIMD_EQ(a, b)        _mm_cmpeq_epi8((a), (b))
+#define PARSON_SIMD_LE(a, b)        _mm_cmpeq_epi8(_mm_min_epu8((a), (b)), (a)) /* unsigned */
+#define PARSON_SIMD_SUB(a, b)       _mm_sub_epi8((a), (b))
+#define PARSON_SIMD_OR(a, b)        _mm_or_si128((a), (b))
+#define PARSON_SIMD_MASK(a)         ((unsigned long long)(unsigned int)_mm_movemask_epi8(a))
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+typedef uint8x16_t parson_simd_t;
+#define PARSON_SIMD_BLOCK           16
+#define PARSON_SIMD_MASK_BITS       4 /* no movemask, each byte is narrowed to a nibble instead */
+#define PARSON_SIMD_FULL_MASK       0xFFFFFFFFFFFFFFFFULL
+#define PARSON_SIMD_LOAD(p)         vld1q_u8((const uint8_t*)(const void*)(p))
+#define PARSON_SIMD_SPLAT(c)        vdupq_n_u8((uint8_t)(c))
+#define PARSON_SIMD_EQ(a, b)        vceqq_u8((a), (b))
+#define PARSON_SIMD_LE(a, b)        vcleq_u8((a), (b))
+#define PARSON_SIMD_SUB(a, b)       vsubq_u8((a), (b))
+#define PARSON_SIMD_OR(a, b)        vorrq_u8((a), (b))
+#define PARSON_SIMD_MASK(a)         ((unsigned long long)vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(a), 4)), 0))
+#endif
+
+#if defined(PARSON_SIMD_BLOCK) && defined(_MSC_VER) && !defined(__clang__) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
 typedef int parson_bool_t;
 
 #define PARSON_TRUE 1
 #define PARSON_FALSE 0
 
+typedef struct json_arena_block {
+    struct json_arena_block *next;
+    size_t size;
+    size_t used;
+} JSON_Arena_Block;
+
+struct json_arena_t {
+    JSON_Arena_Block *blocks; /* the one allocations come from first */
+    size_t block_size;
+    size_t allocation_count;
+    size_t block_count;
+    size_t used;
+};
+
 typedef struct json_string {
     char *chars;
     size_t length;
@@ -139,8 +236,16 @@ struct json_array_t {
     JSON_Value **items;
     size_t       count;
     size_t       capacity;
+    void        *numbers; /* packed numbers, items are made from them on first use */
+    JSON_Number_Array_Type numbers_type;
+    JSON_Arena  *arena; /* the numbers and items are in */
 };
 
+/* Allocation */
+static void * parson_malloc(size_t size);
+static void   parson_free(void *ptr);
+static void * json_arena_alloc(JSON_Arena *arena, size_t size);
+
 /* Various */
 static char * read_file(const char *filename);
 static void   remove_comments(char *string, const char *start_token, const char *end_token);
@@ -171,18 +276,26 @@ static JSON_Array * json_array_make(JSON_Value *wrapping_value);
 static JSON_Status  json_array_add(JSON_Array *array, JSON_Value *value);
 static JSON_Status  json_array_resize(JSON_Array *array, size_t new_capacity);
 static void         json_array_free(JSON_Array *array);
+static JSON_Status  json_array_unpack_numbers(JSON_Array *array);
 
 /* JSON Value */
 static JSON_Value * json_value_init_string_no_copy(char *string, size_t length);
 static const JSON_String * json_value_get_string_desc(const JSON_Value *value);
 
 /* Parser */
+static size_t        count_trailing_zeros(unsigned long long x);
+static size_t        scan_string_special(const char *string);
+static size_t        scan_whitespace(const char *string);
+static void          skip_whitespaces(const char **string);
 static JSON_Status   skip_quotes(const char **string);
 static JSON_Status   parse_utf16(const char **unprocessed, char **processed);
 static char *        process_string(const char *input, size_t input_len, size_t *output_len);
 static char *        get_quoted_string(const char **string, size_t *output_string_len);
 static JSON_Value *  parse_object_value(const char **string, size_t nesting);
 static JSON_Value *  parse_array_value(const char **string, size_t nesting);
+static JSON_Status   parse_number_array(const char **string, JSON_Array *array);
+static parson_bool_t parse_int_number(const char **string, int *number);
+static size_t        parse_digits(const char *string, unsigned long long *value);
 static JSON_Value *  parse_string_value(const char **string);
 static JSON_Value *  parse_boolean_value(const char **string);
 static JSON_Value *  parse_number_value(const char **string);
@@ -195,6 +308,45 @@ static int json_serialize_string(const char *string, size_t len, char *buf);
 static int append_indent(char *buf, int level);
 static int append_string(char *buf, const char *string);
 
+/* Allocation */
+static void * parson_malloc(size_t size) {
+    if (parson_arena) {
+        return json_arena_alloc(parson_arena, size);
+    }
+    return parson_malloc_fun(size);
+}
+
+static void parson_free(void *ptr) {
+    if (parson_arena) {
+        return; /* freed with the arena */
+    }
+    parson_free_fun(ptr);
+}
+
+static void * json_arena_alloc(JSON_Arena *arena, size_t size) {
+    JSON_Arena_Block *block = arena->blocks;
+    size_t header_size = (sizeof(JSON_Arena_Block) + PARSON_ARENA_ALIGNMENT - 1) & ~(size_t)(PARSON_ARENA_ALIGNMENT - 1);
+    void *ptr = NULL;
+    size = (size + PARSON_ARENA_ALIGNMENT - 1) & ~(size_t)(PARSON_ARENA_ALIGNMENT - 1);
+    if (block == NULL || block->size - block->used < size) {
+        size_t block_size = MAX(arena->block_size, size);
+        block = (JSON_Arena_Block*)parson_malloc_fun(header_size + block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        block->next = arena->blocks;
+        block->size = block_size;
+        block->used = 0;
+        arena->blocks = block;
+        arena->block_count++;
+    }
+    ptr = (char*)block + header_size + block->used;
+    block->used += size;
+    arena->allocation_count++;
+    arena->used += size;
+    return ptr;
+}
+
 /* Various */
 static char * read_file(const char * filename) {
     FILE *fp = fopen(filename, "r");
@@ -701,6 +853,9 @@ static JSON_Array * json_array_make(JSON_Value *wrapping_value) {
     new_array->items = (JSON_Value**)NULL;
     new_array->capacity = 0;
     new_array->count = 0;
+    new_array->numbers = NULL;
+    new_array->numbers_type = JSONNumberArrayNone;
+    new_array->arena = NULL;
     return new_array;
 }
 
@@ -737,13 +892,34 @@ static JSON_Status json_array_resize(JSON_Array *array, size_t new_capacity) {
 
 static void json_array_free(JSON_Array *array) {
     size_t i;
-    for (i = 0; i < array->count; i++) {
+    for (i = 0; array->items != NULL && i < array->count; i++) {
         json_value_free(array->items[i]);
     }
     parson_free(array->items);
+    parson_free(array->numbers);
     parson_free(array);
 }
 
+static JSON_Status json_array_unpack_numbers(JSON_Array *array) {
+    JSON_Value *values = NULL;
+    JSON_Value **items = NULL;
+    size_t i;
+    values = (JSON_Value*)json_arena_alloc(array->arena, array->count * sizeof(JSON_Value));
+    items = (JSON_Value**)json_arena_alloc(array->arena, array->count * sizeof(JSON_Value*));
+    if (values == NULL || items == NULL) {
+        return JSONFailure;
+    }
+    for (i = 0; i < array->count; i++) {
+        values[i].parent = array->wrapping_value;
+        values[i].type = JSONNumber;
+        values[i].value.number = json_array_get_number(array, i);
+        items[i] = &values[i];
+    }
+    array->items = items;
+    array->capacity = array->count;
+    return JSONSuccess;
+}
+
 /* JSON Value */
 static JSON_Value * json_value_init_string_no_copy(char *string, size_t length) {
     JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
@@ -758,13 +934,100 @@ static JSON_Value * json_value_init_string_no_copy(char *string, size_t length)
 }
 
 /* Parser */
+static size_t count_trailing_zeros(unsigned long long x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (size_t)__builtin_ctzll(x);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index = 0;
+    _BitScanForward64(&index, x);
+    return (size_t)index;
+#else
+    size_t count = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+/* Returns the offset of the first quote, backslash or control character, which includes the
+   null character */
+PARSON_NO_SANITIZE_ADDRESS
+static size_t scan_string_special(const char *string) {
+#ifdef PARSON_SIMD_BLOCK
+    const char *block = (const char*)((size_t)string & ~(size_t)(PARSON_SIMD_BLOCK - 1));
+    const parson_simd_t quote = PARSON_SIMD_SPLAT('\"'), backslash = PARSON_SIMD_SPLAT('\\'), last_control = PARSON_SIMD_SPLAT(0x1F);
+    unsigned long long in_string = PARSON_SIMD_FULL_MASK << ((size_t)(string - block) * PARSON_SIMD_MASK_BITS);
+    unsigned long long mask = 0;
+    parson_simd_t chars;
+    for (;;) {
+        chars = PARSON_SIMD_LOAD(block);
+        mask = PARSON_SIMD_MASK(PARSON_SIMD_OR(PARSON_SIMD_OR(PARSON_SIMD_EQ(chars, quote), PARSON_SIMD_EQ(chars, backslash)),
+                                               PARSON_SIMD_LE(chars, last_control))) & in_string;
+        if (mask != 0) {
+            return (size_t)(block + count_trailing_zeros(mask) / PARSON_SIMD_MASK_BITS - string);
+        }
+        block += PARSON_SIMD_BLOCK;
+        in_string = PARSON_SIMD_FULL_MASK;
+    }
+#else
+    size_t offset = 0;
+    while (string[offset] != '\"' && string[offset] != '\\' && (unsigned char)string[offset] >= 0x20) {
+        offset++;
+    }
+    return offset;
+#endif
+}
+
+/* Returns the number of leading spaces, tabs, newlines, vertical tabs, form feeds and carriage
+   returns: whitespace in any locale */
+PARSON_NO_SANITIZE_ADDRESS
+static size_t scan_whitespace(const char *string) {
+#ifdef PARSON_SIMD_BLOCK
+    const char *block = (const char*)((size_t)string & ~(size_t)(PARSON_SIMD_BLOCK - 1));
+    const parson_simd_t space = PARSON_SIMD_SPLAT(' '), tab = PARSON_SIMD_SPLAT('\t'), controls = PARSON_SIMD_SPLAT('\r' - '\t');
+    unsigned long long in_string = PARSON_SIMD_FULL_MASK << ((size_t)(string - block) * PARSON_SIMD_MASK_BITS);
+    unsigned long long mask = 0;
+    parson_simd_t chars;
+    for (;;) {
+        chars = PARSON_SIMD_LOAD(block);
+        mask = ~PARSON_SIMD_MASK(PARSON_SIMD_OR(PARSON_SIMD_EQ(chars, space), PARSON_SIMD_LE(PARSON_SIMD_SUB(chars, tab), controls))) & in_string;
+        if (mask != 0) {
+            return (size_t)(block + count_trailing_zeros(mask) / PARSON_SIMD_MASK_BITS - string);
+        }
+        block += PARSON_SIMD_BLOCK;
+        in_string = PARSON_SIMD_FULL_MASK;
+    }
+#else
+    size_t offset = 0;
+    while (string[offset] == ' ' || (string[offset] >= '\t' && string[offset] <= '\r')) {
+        offset++;
+    }
+    return offset;
+#endif
+}
+
+static void skip_whitespaces(const char **string) {
+    /* Most runs are a single space, skipped by SKIP_WHITESPACES, only longer ones are scanned.
+       isspace may accept more characters in some locales, which are skipped one by one. */
+    size_t run_len = 0;
+    while (isspace((unsigned char)**string)) {
+        run_len = scan_whitespace(*string);
+        *string += run_len > 0 ? run_len : 1;
+    }
+}
+
 static JSON_Status skip_quotes(const char **string) {
     if (**string != '\"') {
         return JSONFailure;
     }
     SKIP_CHAR(string);
-    while (**string != '\"') {
-        if (**string == '\0') {
+    for (;;) {
+        *string += scan_string_special(*string);
+        if (**string == '\"') {
+            break;
+        } else if (**string == '\0') {
             return JSONFailure;
         } else if (**string == '\\') {
             SKIP_CHAR(string);
@@ -868,7 +1131,10 @@ static char* process_string(const char *input, size_t input_len, size_t *output_
     *output_ptr = '\0';
     /* resize to new length */
     final_size = (size_t)(output_ptr-output) + 1;
-    /* todo: don't resize if final_size == initial_size */
+    if (final_size == initial_size) {
+        *output_len = final_size - 1;
+        return output;
+    }
     resized_output = (char*)parson_malloc(final_size);
     if (resized_output == NULL) {
         goto error;
@@ -887,7 +1153,25 @@ error:
 static char * get_quoted_string(const char **string, size_t *output_string_len) {
     const char *string_start = *string;
     size_t input_string_len = 0;
-    JSON_Status status = skip_quotes(string);
+    char *output = NULL;
+    JSON_Status status = JSONFailure;
+    if (**string != '\"') {
+        return NULL;
+    }
+    /* without escapes or control characters the contents are copied as they are */
+    input_string_len = scan_string_special(string_start + 1);
+    if (string_start[input_string_len + 1] == '\"') {
+        output = (char*)parson_malloc(input_string_len + 1);
+        if (output == NULL) {
+            return NULL;
+        }
+        memcpy(output, string_start + 1, input_string_len);
+        output[input_string_len] = '\0';
+        *output_string_len = input_string_len;
+        *string = string_start + input_string_len + 2;
+        return output;
+    }
+    status = skip_quotes(string);
     if (status != JSONSuccess) {
         return NULL;
     }
@@ -994,7 +1278,12 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
 }
 
 static JSON_Value * parse_array_value(const char **string, size_t nesting) {
+    /* Items are collected on the stack, or on the heap once there are more, and copied into the
+       array once their count is known. Arrays in an arena don't leave grown items behind. */
     JSON_Value *output_value = NULL, *new_array_value = NULL;
+    JSON_Value *stack_items[ARRAY_STACK_ITEMS];
+    JSON_Value **items = stack_items, **new_items = NULL;
+    size_t count = 0, capacity = ARRAY_STACK_ITEMS, i = 0;
     JSON_Array *output_array = NULL;
     output_value = json_value_init_array();
     if (output_value == NULL) {
@@ -1011,17 +1300,30 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
         SKIP_CHAR(string);
         return output_value;
     }
+    if (parson_arena != NULL && (**string == '-' || isdigit((unsigned char)**string)) &&
+        parse_number_array(string, output_array) == JSONSuccess) {
+        return output_value;
+    }
     while (**string != '\0') {
         new_array_value = parse_value(string, nesting);
         if (new_array_value == NULL) {
-            json_value_free(output_value);
-            return NULL;
+            goto error;
         }
-        if (json_array_add(output_array, new_array_value) != JSONSuccess) {
-            json_value_free(new_array_value);
-            json_value_free(output_value);
-            return NULL;
+        if (count >= capacity) {
+            new_items = (JSON_Value**)parson_malloc_fun(capacity * 2 * sizeof(JSON_Value*));
+            if (new_items == NULL) {
+                json_value_free(new_array_value);
+                goto error;
+            }
+            memcpy(new_items, items, count * sizeof(JSON_Value*));
+            if (items != stack_items) {
+                parson_free_fun(items);
+            }
+            items = new_items;
+            capacity *= 2;
         }
+        items[count] = new_array_value;
+        count++;
         SKIP_WHITESPACES(string);
         if (**string != ',') {
             break;
@@ -1033,13 +1335,158 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
         }
     }
     SKIP_WHITESPACES(string);
-    if (**string != ']' || /* Trim array after parsing is over */
-        json_array_resize(output_array, json_array_get_count(output_array)) != JSONSuccess) {
-            json_value_free(output_value);
-            return NULL;
+    if (**string != ']' || json_array_resize(output_array, count) != JSONSuccess) {
+        goto error;
+    }
+    for (i = 0; i < count; i++) {
+        items[i]->parent = output_value;
+        output_array->items[i] = items[i];
+    }
+    output_array->count = count;
+    if (items != stack_items) {
+        parson_free_fun(items);
     }
     SKIP_CHAR(string);
     return output_value;
+error:
+    for (i = 0; i < count; i++) {
+        json_value_free(items[i]);
+    }
+    if (items != stack_items) {
+        parson_free_fun(items);
+    }
+    json_value_free(output_value);
+    return NULL;
+}
+
+static JSON_Status parse_number_array(const char **string, JSON_Array *array) {
+    /* Parses the rest of an array of integers into packed numbers. Leaves string where it was
+       and fails on anything else, which is left to parse_value. */
+    const char *cursor = *string;
+    int stack_numbers[ARRAY_STACK_NUMBERS];
+    int *numbers = stack_numbers, *new_numbers = NULL;
+    size_t count = 0, capacity = ARRAY_STACK_NUMBERS, i = 0;
+    int number = 0, min = 0, max = 0;
+    unsigned char *uint8_numbers = NULL;
+    JSON_Status status = JSONFailure;
+    while (parse_int_number(&cursor, &number)) {
+        if (count >= capacity) {
+            new_numbers = (int*)parson_malloc_fun(capacity * 2 * sizeof(int));
+            if (new_numbers == NULL) {
+                goto end;
+            }
+            memcpy(new_numbers, numbers, count * sizeof(int));
+            if (numbers != stack_numbers) {
+                parson_free_fun(numbers);
+            }
+            numbers = new_numbers;
+            capacity *= 2;
+        }
+        min = count == 0 || number < min ? number : min;
+        max = count == 0 || number > max ? number : max;
+        numbers[count] = number;
+        count++;
+        SKIP_WHITESPACES(&cursor);
+        if (*cursor != ',') {
+            break;
+        }
+        SKIP_CHAR(&cursor);
+        SKIP_WHITESPACES(&cursor);
+        if (*cursor == ']') {
+            break;
+        }
+    }
+    if (count == 0 || *cursor != ']') {
+        goto end;
+    }
+    if (min >= 0 && max <= 255) {
+        uint8_numbers = (unsigned char*)parson_malloc(count);
+        if (uint8_numbers == NULL) {
+            goto end;
+        }
+        for (i = 0; i < count; i++) {
+            uint8_numbers[i] = (unsigned char)numbers[i];
+        }
+        array->numbers = uint8_numbers;
+        array->numbers_type = JSONNumberArrayUint8;
+    } else {
+        array->numbers = parson_malloc(count * sizeof(int));
+        if (array->numbers == NULL) {
+            goto end;
+        }
+        memcpy(array->numbers, numbers, count * sizeof(int));
+        array->numbers_type = JSONNumberArrayInt32;
+    }
+    array->count = count;
+    array->arena = parson_arena;
+    *string = cursor + 1;
+    status = JSONSuccess;
+end:
+    if (numbers != stack_numbers) {
+        parson_free_fun(numbers);
+    }
+    return status;
+}
+
+static parson_bool_t parse_int_number(const char **string, int *number) {
+    /* Only what parse_number_value reads as the same integer, without leading zeros or "-0" */
+    const char *digits = *string;
+    parson_bool_t negative = *digits == '-';
+    unsigned long long magnitude = 0;
+    size_t digit_count = 0;
+    if (negative) {
+        digits++;
+    }
+    digit_count = parse_digits(digits, &magnitude);
+    if (digit_count == 0 || digit_count > 10 || (digit_count > 1 && digits[0] == '0')) {
+        return PARSON_FALSE;
+    }
+    if (negative ? (magnitude == 0 || magnitude > 2147483648ULL) : magnitude > 2147483647ULL) {
+        return PARSON_FALSE;
+    }
+    *number = negative ? (int)(-(long long)magnitude) : (int)magnitude;
+    *string = digits + digit_count;
+    return PARSON_TRUE;
+}
+
+PARSON_NO_SANITIZE_ADDRESS
+static size_t parse_digits(const char *string, unsigned long long *value) {
+    /* Reads digits until the first other character or more than 10 of them */
+    size_t count = 0;
+    *value = 0;
+#ifdef PARSON_SWAR_DIGITS
+    while (count <= 10 && ((size_t)(string + count) & (PARSON_SWAR_PAGE_SIZE - 1)) <= PARSON_SWAR_PAGE_SIZE - 8) {
+        static const unsigned long long powers[9] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+        unsigned long long chunk = 0, non_digits = 0;
+        size_t digit_count = 8;
+        __builtin_memcpy(&chunk, string + count, 8);
+        /* the high bit of each byte that isn't '0' to '9' */
+        non_digits = ((chunk & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL) |
+                     (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) ^ 0x3030303030303030ULL);
+        non_digits = (((non_digits & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | non_digits) & 0x8080808080808080ULL;
+        if (non_digits != 0) {
+            digit_count = (size_t)__builtin_ctzll(non_digits) / 8;
+        }
+        if (digit_count == 0) {
+            return count;
+        }
+        /* the digits to the top bytes, then pairs, quads and eights of them combined */
+        chunk = (chunk - 0x3030303030303030ULL) << (8 * (8 - digit_count));
+        chunk = ((chunk * 10) + (chunk >> 8)) & 0x00FF00FF00FF00FFULL;
+        chunk = ((chunk * 100) + (chunk >> 16)) & 0x0000FFFF0000FFFFULL;
+        chunk = ((chunk * 10000) + (chunk >> 32)) & 0x00000000FFFFFFFFULL;
+        *value = *value * powers[digit_count] + chunk;
+        count += digit_count;
+        if (digit_count < 8) {
+            return count;
+        }
+    }
+#endif
+    while (count <= 10 && string[count] >= '0' && string[count] <= '9') {
+        *value = *value * 10 + (unsigned long long)(string[count] - '0');
+        count++;
+    }
+    return count;
 }
 
 static JSON_Value * parse_string_value(const char **string) {
@@ -1367,6 +1814,18 @@ JSON_Value * json_parse_string(const char *string) {
     return parse_value((const char**)&string, 0);
 }
 
+JSON_Value * json_parse_string_in_arena(const char *string, JSON_Arena *arena) {
+    JSON_Arena *previous_arena = parson_arena;
+    JSON_Value *output_value = NULL;
+    if (arena == NULL) {
+        return NULL;
+    }
+    parson_arena = arena;
+    output_value = json_parse_string(string);
+    parson_arena = previous_arena;
+    return output_value;
+}
+
 JSON_Value * json_parse_string_with_comments(const char *string) {
     JSON_Value *result = NULL;
     char *string_mutable_copy = NULL, *string_mutable_copy_ptr = NULL;
@@ -1496,6 +1955,9 @@ JSON_Value * json_array_get_value(const JSON_Array *array, size_t index) {
     if (array == NULL || index >= json_array_get_count(array)) {
         return NULL;
     }
+    if (array->items == NULL && json_array_unpack_numbers((JSON_Array*)array) != JSONSuccess) {
+        return NULL;
+    }
     return array->items[index];
 }
 
@@ -1508,6 +1970,13 @@ size_t json_array_get_string_len(const JSON_Array *array, size_t index) {
 }
 
 double json_array_get_number(const JSON_Array *array, size_t index) {
+    if (array != NULL && index < array->count) {
+        if (array->numbers_type == JSONNumberArrayUint8) {
+            return ((const unsigned char*)array->numbers)[index];
+        } else if (array->numbers_type == JSONNumberArrayInt32) {
+            return ((const int*)array->numbers)[index];
+        }
+    }
     return json_value_get_number(json_array_get_value(array, index));
 }
 
@@ -1527,6 +1996,46 @@ size_t json_array_get_count(const JSON_Array *array) {
     return array ? array->count : 0;
 }
 
+JSON_Number_Array_Type json_array_get_number_array_type(const JSON_Array *array) {
+    return array ? array->numbers_type : JSONNumberArrayNone;
+}
+
+const int * json_array_get_int32_numbers(const JSON_Array *array) {
+    if (array == NULL || array->numbers_type != JSONNumberArrayInt32) {
+        return NULL;
+    }
+    return (const int*)array->numbers;
+}
+
+const unsigned char * json_array_get_uint8_numbers(const JSON_Array *array) {
+    if (array == NULL || array->numbers_type != JSONNumberArrayUint8) {
+        return NULL;
+    }
+    return (const unsigned char*)array->numbers;
+}
+
+size_t json_array_get_ints(const JSON_Array *array, size_t index, int *ints, size_t count) {
+    const unsigned char *uint8_numbers = json_array_get_uint8_numbers(array);
+    const int *int32_numbers = json_array_get_int32_numbers(array);
+    size_t i = 0;
+    if (index >= json_array_get_count(array)) {
+        return 0;
+    }
+    count = MIN(count, json_array_get_count(array) - index);
+    if (uint8_numbers != NULL) {
+        for (i = 0; i < count; i++) {
+            ints[i] = uint8_numbers[index + i];
+        }
+    } else if (int32_numbers != NULL) {
+        memcpy(ints, int32_numbers + index, count * sizeof(int));
+    } else {
+        for (i = 0; i < count; i++) {
+            ints[i] = (int)json_array_get_number(array, index + i);
+        }
+    }
+    return count;
+}
+
 JSON_Value * json_array_get_wrapping_value(const JSON_Array *array) {
     if (!array) {
         return NULL;
@@ -2432,8 +2941,45 @@ int json_boolean(const JSON_Value *value) {
 }
 
 void json_set_allocation_functions(JSON_Malloc_Function malloc_fun, JSON_Free_Function free_fun) {
-    parson_malloc = malloc_fun;
-    parson_free = free_fun;
+    parson_malloc_fun = malloc_fun;
+    parson_free_fun = free_fun;
+}
+
+JSON_Arena * json_arena_create(size_t block_size) {
+    JSON_Arena *arena = (JSON_Arena*)parson_malloc_fun(sizeof(JSON_Arena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->blocks = NULL;
+    arena->block_size = MAX(block_size, 1024);
+    arena->allocation_count = 0;
+    arena->block_count = 0;
+    arena->used = 0;
+    return arena;
+}
+
+void json_arena_free(JSON_Arena *arena) {
+    JSON_Arena_Block *block = NULL, *next = NULL;
+    if (arena == NULL) {
+        return;
+    }
+    for (block = arena->blocks; block != NULL; block = next) {
+        next = block->next;
+        parson_free_fun(block);
+    }
+    parson_free_fun(arena);
+}
+
+size_t json_arena_get_allocation_count(const JSON_Arena *arena) {
+    return arena ? arena->allocation_count : 0;
+}
+
+size_t json_arena_get_block_count(const JSON_Arena *arena) {
+    return arena ? arena->block_count : 0;
+}
+
+size_t json_arena_get_size(const JSON_Arena *arena) {
+    return arena ? arena->used : 0;
 }
 
 void json_set_escape_slashes(int escape_slashes) {
@@ -46,6 +46,7 @@ extern "C"
 typedef struct json_object_t JSON_Object;
 typedef struct json_array_t  JSON_Array;
 typedef struct json_value_t  JSON_Value;
+typedef struct json_arena_t  JSON_Arena;
 
 enum json_value_type {
     JSONError   = -1,
@@ -58,6 +59,14 @@ enum json_value_type {
 };
 typedef int JSON_Value_Type;
 
+/* How the numbers of an array parsed in an arena are stored, see json_array_get_number_array_type */
+enum json_number_array_type {
+    JSONNumberArrayNone  = 0, /* values, like any other array */
+    JSONNumberArrayInt32 = 1,
+    JSONNumberArrayUint8 = 2
+};
+typedef int JSON_Number_Array_Type;
+
 enum json_result_t {
     JSONSuccess = 0,
     JSONFailure = -1
@@ -94,6 +103,21 @@ JSON_Value * json_parse_string(const char *string);
     returns NULL in case of error */
 JSON_Value * json_parse_string_with_comments(const char *string);
 
+/* Arenas
+   Values parsed in an arena are allocated from a few large blocks instead of one allocation each,
+   and are all freed at once with the arena by json_arena_free. They must not be freed with
+   json_value_free or modified. Blocks come from the allocation functions. An arena may be filled
+   by one thread at a time, parsing on several threads needs an arena each. */
+JSON_Arena * json_arena_create(size_t block_size); /* block_size is the size of each block, larger values get their own */
+void         json_arena_free(JSON_Arena *arena);
+size_t       json_arena_get_allocation_count(const JSON_Arena *arena); /* values, strings and arrays allocated */
+size_t       json_arena_get_block_count(const JSON_Arena *arena);
+size_t       json_arena_get_size(const JSON_Arena *arena); /* bytes allocated, without unused space in blocks */
+
+/* Like json_parse_string, allocating the values from arena. Values of a failed parse stay in
+   the arena until it is freed. */
+JSON_Value * json_parse_string_in_arena(const char *string, JSON_Arena *arena);
+
 /* Serialization */
 size_t      json_serialization_size(const JSON_Value *value); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes);
@@ -200,6 +224,18 @@ int           json_array_get_boolean(const JSON_Array *array, size_t index); /*
 size_t        json_array_get_count  (const JSON_Array *array);
 JSON_Value  * json_array_get_wrapping_value(const JSON_Array *array);
 
+/* Packed number arrays
+   Arrays parsed in an arena that hold only integers from -2^31 to 2^31-1, written without
+   fraction, exponent or "-0", are stored packed: as unsigned chars when all of them are 0 to 255,
+   ints otherwise. The other array functions read them as usual, but the first json_array_get_value
+   allocates values for all of them from the arena, which must not happen on two threads at once. */
+JSON_Number_Array_Type json_array_get_number_array_type(const JSON_Array *array);
+const int           * json_array_get_int32_numbers(const JSON_Array *array); /* NULL unless JSONNumberArrayInt32 */
+const unsigned char * json_array_get_uint8_numbers(const JSON_Array *array); /* NULL unless JSONNumberArrayUint8 */
+/* Copies up to count numbers from index on, converted to int, returns how many were copied.
+   Works on any array, non numbers are 0. */
+size_t json_array_get_ints(const JSON_Array *array, size_t index, int *ints, size_t count);
+
 /* Frees and removes value at given index, does nothing and returns JSONFailure if index doesn't exist.
  * Order of values in array may change during execution.  */
 JSON_Status json_array_remove(JSON_Array *array, size_t i);
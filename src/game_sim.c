@@ -0,0 +1,538 @@
+#include "game_sim.h"
+#include "entities.h"
+#include "ldtk.h"
+#include "state_history.h"
+#include "raymath.h"
+#include "sys.h"
+
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+static struct ldtk_world* gSimWorld = NULL;
+static EntityStore* gSimEntities = NULL;
+static SimProfile* gSimProfile = NULL;
+static int gSimTickRate = kTuningTickRate;
+
+
+void SetSimWorld(struct ldtk_world* world)
+{
+	gSimWorld = world;
+}
+
+
+void SetSimEntities(EntityStore* entities)
+{
+	gSimEntities = entities;
+}
+
+
+void SetSimProfile(SimProfile* profile)
+{
+	gSimProfile = profile;
+}
+
+
+void SetSimTickRate(int tickRate)
+{
+	gSimTickRate = (tickRate < kMinSimTickRate) ? kMinSimTickRate : (tickRate > kMaxSimTickRate) ? kMaxSimTickRate : tickRate;
+}
+
+
+int GetSimTickRate(void)
+{
+	return gSimTickRate;
+}
+
+
+float GetTuningFrame(int step, int tickRate)
+{
+	return step * ((float)kTuningTickRate / tickRate);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Collision functions
+
+
+// callback function to determine the grid cell contents when used for collisions
+static int ldtk_grid_lookup(void* ctx, int x, int y)
+{
+	ldtk_layer_instance* inst = ctx;
+	int i = x + inst->cWid * y;
+	return inst->int_grid[i];
+}
+
+
+// iterate the ldtk world and raycast against each collision layer to find the closest collision
+coll_trace_hit_t ldtk_trace_ray(struct ldtk_world* world, Vector2 start, Vector2 end, int depth)
+{
+	double startTime = gSimProfile ? GetHighResTime() : 0.0;
+
+	coll_ray_t ray = {
+		.start_x = start.x,
+		.start_y = start.y,
+		.end_x = end.x,
+		.end_y = end.y
+	};
+
+	coll_trace_hit_t result = {
+		.dist = FLT_MAX
+	};
+
+	// iterate all level instances and check which ones contain the bounding box
+	int count = ldtk_get_level_count(world);
+	for (int i = 0; i < count; ++i)
+	{
+		ldtk_level* level = ldtk_get_level(world, i);
+		if (level->worldDepth != depth) continue;
+		for (int j = 0; j < level->layer_instances_count; ++j)
+		{
+			ldtk_layer_instance* inst = &level->layer_instances[j];
+			if (inst->int_grid)
+			{
+				coll_grid_t grid = {
+					.offset_x = (float)level->worldX + inst->px_offset_x,
+					.offset_y = (float)level->worldY + inst->px_offset_y,
+					.width = inst->cWid,
+					.height = inst->cHei,
+					.cell_size = (float)inst->grid_size,
+					.context = inst,
+					.cb_has_hit = ldtk_grid_lookup
+				};
+
+				coll_trace_hit_t hit;
+				if (coll_ray_grid(grid, ray, &hit))
+				{
+					if (hit.dist < result.dist)
+					{
+						result = hit;
+					}
+				}
+			}
+		}
+	}
+
+	if (gSimProfile)
+	{
+		gSimProfile->collisionTime += GetHighResTime() - startTime;
+		gSimProfile->collisionQueries++;
+	}
+
+	return result;
+}
+
+
+// iterate the ldtk world and raycast against each collision layer to find the closest collision
+coll_trace_hit_t ldtk_sweep_aabb(struct ldtk_world* world, coll_aabb_t aabb, Vector2 dir, int depth)
+{
+	double startTime = gSimProfile ? GetHighResTime() : 0.0;
+
+	coll_trace_hit_t result = {
+		.dist = FLT_MAX
+	};
+
+	// iterate all level instances and check which ones contain the bounding box
+	int count = ldtk_get_level_count(world);
+	for (int i = 0; i < count; ++i)
+	{
+		ldtk_level* level = ldtk_get_level(world, i);
+		if (level->worldDepth != depth) continue;
+		for (int j = 0; j < level->layer_instances_count; ++j)
+		{
+			ldtk_layer_instance* inst = &level->layer_instances[j];
+			if (inst->int_grid)
+			{
+				coll_grid_t grid = {
+					.offset_x = (float)level->worldX + inst->px_offset_x,
+					.offset_y = (float)level->worldY + inst->px_offset_y,
+					.width = inst->cWid,
+					.height = inst->cHei,
+					.cell_size = (float)inst->grid_size,
+					.context = inst,
+					.cb_has_hit = ldtk_grid_lookup
+				};
+
+				coll_trace_hit_t hit;
+				if (coll_sweep_aabb_grid(grid, aabb, dir.x, dir.y, &hit))
+				{
+					if (hit.dist < result.dist)
+					{
+						result = hit;
+					}
+				}
+			}
+		}
+	}
+
+	if (gSimProfile)
+	{
+		gSimProfile->collisionTime += GetHighResTime() - startTime;
+		gSimProfile->collisionQueries++;
+	}
+
+	return result;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Tuning
+
+PlayerTuning gPlayerTuning =
+{
+	.Width = 12,
+	.Height = 20,
+	.JumpHeight = 32.0f,
+	.JumpFrames = 20,
+	.JumpDistance = 180.0f,
+	.FallGravityScale = 1.0f,
+	.JumpReleaseGravityScale = 4.0f,
+	.HangTimeFrames = 3,
+	.AccelX = 0.8f,
+	.MaxSpeedX = 2.0f,
+	.MaxFallSpeed = 10.0f,
+	.MaxJumpCount = 2,
+	.CoyoteTime = 3,
+};
+
+#define TUNING_FLOAT(name, field) { name, offsetof(PlayerTuning, field), false }
+#define TUNING_INT(name, field) { name, offsetof(PlayerTuning, field), true }
+
+// tuning values stored in replays, playing a replay back switches to its values
+const TuningVar gTuningVars[] =
+{
+	TUNING_INT("PlayerWidth", Width),
+	TUNING_INT("PlayerHeight", Height),
+	TUNING_FLOAT("PlayerJumpHeight", JumpHeight),
+	TUNING_FLOAT("PlayerJumpFrames", JumpFrames),
+	TUNING_FLOAT("PlayerJumpDistance", JumpDistance),
+	TUNING_FLOAT("PlayerFallGravityScale", FallGravityScale),
+	TUNING_FLOAT("PlayerJumpReleaseGravityScale", JumpReleaseGravityScale),
+	TUNING_INT("PlayerHangTimeFrames", HangTimeFrames),
+	TUNING_FLOAT("PlayerAccelX", AccelX),
+	TUNING_FLOAT("PlayerMaxSpeedX", MaxSpeedX),
+	TUNING_FLOAT("PlayerMaxFallSpeed", MaxFallSpeed),
+	TUNING_INT("PlayerMaxJumpCount", MaxJumpCount),
+	TUNING_INT("PlayerCoyoteTime", CoyoteTime),
+};
+
+const int gTuningVarCount = sizeof(gTuningVars) / sizeof(gTuningVars[0]);
+
+// track how high the player has jumped
+float gStat_MaxHeight = 0.0f;
+
+
+float GetTuningValue(const PlayerTuning* tuning, const TuningVar* var)
+{
+	const char* field = (const char*)tuning + var->offset;
+	return var->isInt ? (float)*(const int*)field : *(const float*)field;
+}
+
+
+void SetTuningValue(PlayerTuning* tuning, const TuningVar* var, float value)
+{
+	char* field = (char*)tuning + var->offset;
+	if (var->isInt) *(int*)field = (int)value;
+	else *(float*)field = value;
+}
+
+
+GameState GetInitialGameState(void)
+{
+	GameState state;
+	memset(&state, 0, sizeof(state));
+	state.Player.Location = (Vector2){ 8 * 16, 4 * 16 };
+	return state;
+}
+
+
+void UpdatePlayer(SimContext* sim, GameState* state)
+{
+	const PlayerTuning* tuning = sim->tuning;
+	const PlayerInput* input = &state->Input;
+	Player* player = &state->Player;
+
+
+	// tuning frames per step: speeds scale with it, accelerations with its square and frame
+	// counts are compared in tuning frames. At kTuningTickRate it is 1 and changes nothing.
+	const float frameScale = (float)kTuningTickRate / sim->tickRate;
+	const float maxSpeedX = tuning->MaxSpeedX * frameScale;
+	const float maxFallSpeed = tuning->MaxFallSpeed * frameScale;
+	// AccelX closes that fraction of the gap to the target speed each frame
+	const float accelX = (frameScale == 1.0f) ? tuning->AccelX : 1.0f - powf(1.0f - tuning->AccelX, frameScale);
+
+	// take off vertical speed
+	const float v0 = (-2.0f * tuning->JumpHeight * tuning->MaxFallSpeed) / tuning->JumpDistance * frameScale;
+	// gravity
+	const float G = (2.0f * tuning->JumpHeight * (tuning->MaxFallSpeed * tuning->MaxFallSpeed)) / (tuning->JumpDistance * tuning->JumpDistance) * (frameScale * frameScale);
+
+	// transient downward force applied to the player (differs depending on certain conditions)
+	float g = G;
+
+	Vector2 posDelta = { 0 };
+
+	//////////////////////////////////////////////////////////////////////////
+	// horizontal movement
+	float targetSpeedX = 0.0f;
+	if (input->bMoveLeft)
+	{
+		targetSpeedX = -maxSpeedX;
+	}
+	else if (input->bMoveRight)
+	{
+		targetSpeedX = maxSpeedX;
+	}
+
+	// store desired delta of player position in X axis
+	posDelta.x = accelX * targetSpeedX + (1.0f - accelX) * player->Velocity.x;
+	player->Velocity.x = posDelta.x;
+
+
+	//////////////////////////////////////////////////////////////////////////
+	// vertical movement
+
+	float halfW = tuning->Width / 2.0f;
+	float halfH = tuning->Height / 2.0f;
+	coll_aabb_t playerAABB = {
+		player->Location.x, player->Location.y - halfH,
+		halfW, halfH
+	};
+
+	// check if player is on the ground
+	coll_trace_hit_t groundTrace = ldtk_sweep_aabb(sim->world, playerAABB, (Vector2){0, 1}, 0);
+	bool bIsGrounded = groundTrace.hit_value && groundTrace.dist == 0.0f;
+
+	// TODO trace box down not just a ray...
+
+	if (bIsGrounded)
+	{
+		player->bIsJumping = false;
+		player->JumpCount = 0;
+		player->JumpState = PJS_None;
+		player->JumpStateTime = 0;
+		player->NotGroundedTime = 0;
+		player->Velocity.y = 0.0f;
+	}
+	else
+	{
+		player->NotGroundedTime++;
+		if (!player->bIsJumping && player->JumpState == 0)
+		{
+			// player walked off an edge?
+			//player->JumpCount = 1;
+			player->JumpState = PJS_Falling;
+		}
+
+		// after N frames clear coyote time by setting JumpCount to 1
+		if (!player->bIsJumping && player->JumpState == 3 && player->JumpCount == 0)
+		{
+			if (player->NotGroundedTime * frameScale > tuning->CoyoteTime)
+			{
+				player->JumpCount = 1;
+			}
+		}
+	}
+
+	if (input->bJump && !player->bJumpPrev && player->JumpCount < tuning->MaxJumpCount)
+	{
+		// start jumping
+		player->bIsJumping = true;
+		player->JumpState = PJS_JumpAscending;
+		player->JumpStateTime = 0;
+		player->JumpCount++;
+
+		// apply initial impulse
+		player->Velocity.y = v0;
+
+		if (bIsGrounded)
+		{
+			// reset max height when we start jumping again
+			sim->maxHeight = 0;
+		}
+	}
+
+	switch (player->JumpState)
+	{
+		// no jump
+	case PJS_None:
+		break;
+
+		// ascending
+	case PJS_JumpAscending:
+		if (player->Velocity.y > 0.0f)
+		{
+			// reached the peak
+			player->Velocity.y = 0.0f;
+			player->JumpState = PJS_JumpApex;
+			player->JumpStateTime = 0;
+		}
+
+		// if the player releases the button on the way up, slow them down quicker
+		if (!input->bJump)
+		{
+			g = G * tuning->JumpReleaseGravityScale;
+		}
+		break;
+
+		// hang time
+	case PJS_JumpApex:
+		player->Velocity.y = 0.0f;
+		g = 0.0f;
+
+		// wait a few frames then move to falling state
+		if (player->JumpStateTime * frameScale >= tuning->HangTimeFrames)
+		{
+			player->JumpState = PJS_Falling;
+			player->JumpStateTime = 0;
+		}
+		break;
+
+		// falling
+	case PJS_Falling:
+		if (player->Velocity.y > 0.0f)
+		{
+			g = G * tuning->FallGravityScale;
+		}
+		break;
+	}
+
+	player->JumpStateTime += 1;
+
+	posDelta.y = player->Velocity.y;// + (g / 2.0f);
+	player->Velocity.y += g;
+
+	// clamp to max speed
+	if (player->Velocity.y > maxFallSpeed)
+	{
+		player->Velocity.y = maxFallSpeed;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Collide desired posDelta with the world
+	{
+		// Simple raycasts in the four directions.
+		// To improve this we could cast multiple rays, or make a shape cast function.
+
+		if (fabsf(posDelta.x) > 0.0f)
+		{
+			Vector2 playerOffset = { (float)tuning->Width / 2.0f, -2.0f };
+			if (posDelta.x < 0.0f) playerOffset.x *= -1.0f;
+			coll_trace_hit_t hit = ldtk_sweep_aabb(sim->world, playerAABB, (Vector2) { posDelta.x, 0 }, 0);
+			if (hit.hit_value)
+			{
+				posDelta.x = copysignf(hit.dist, posDelta.x);
+			}
+		}
+
+		if (fabsf(posDelta.y) > 0.0f)
+		{
+			Vector2 playerOffset = { 0 };
+			if (posDelta.y < 0.0f) playerOffset.y = (float) -tuning->Height;
+			Vector2 rayStart = Vector2Add(player->Location, playerOffset);
+			Vector2 rayEnd = Vector2Add(rayStart, (Vector2) { 0.0f, posDelta.y });
+			coll_trace_hit_t hit = ldtk_trace_ray(sim->world, rayStart, rayEnd, 0);
+			if (hit.hit_value)
+			{
+				posDelta.y = copysignf(hit.dist, posDelta.y);
+			}
+		}
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	// Move player according to desired delta
+	player->Location = Vector2Add(player->Location, posDelta);
+
+
+	// store if the player had Jump pressed this frame
+	player->bJumpPrev = input->bJump;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+
+
+GameState StepSim(SimContext* sim, GameState state)
+{
+	// start by copying the previous gamestate
+	GameState newState = state;
+	newState.Frame++;
+
+	// update player
+	UpdatePlayer(sim, &newState);
+
+	// entities don't depend on the player, they only need to be where they are this frame
+	if (sim->entities)
+	{
+		UpdateEntities(sim->entities, GetTuningFrame(newState.Frame, sim->tickRate));
+	}
+
+	// track some random stats...
+	if (sim->maxHeight > newState.Player.Location.y)
+	{
+		sim->maxHeight = newState.Player.Location.y;
+	}
+
+	return newState;
+}
+
+
+GameState StepGame(GameState state)
+{
+	SimContext sim = { &gPlayerTuning, gSimWorld, gStat_MaxHeight, gSimEntities, gSimTickRate };
+	GameState newState = StepSim(&sim, state);
+	gStat_MaxHeight = sim.maxHeight;
+	return newState;
+}
+
+
+static void StepRecordedInput(void* context, const void* previous, const void* recorded, void* next)
+{
+	GameState state = *(const GameState*)previous;
+	state.Input = ((const GameState*)recorded)->Input;
+	*(GameState*)next = StepSim(context, state);
+}
+
+
+RollbackResult RollbackInput(struct StateHistory* history, int frame, PlayerInput input)
+{
+	RollbackResult result = { 0, -1 };
+
+	// past frames are stepped on their own context, so they neither raise the live stats nor
+	// move the entity store away from the current frame (entities don't depend on the player)
+	SimContext sim = { &gPlayerTuning, gSimWorld, 0.0f, NULL, gSimTickRate };
+
+	// the edited frame is the step from the frame before it taken with the new input,
+	// the very first frame has no step so only its input changes
+	GameState state;
+	if (!GetState(history, frame, &state)) return result;
+	if (frame > 0)
+	{
+		if (!GetState(history, frame - 1, &state)) return result;
+		state.Input = input;
+		state = StepSim(&sim, state);
+	}
+	state.Input = input;
+
+	result.frames = ResimulateStateHistory(history, frame, &state, StepRecordedInput, &sim, &result.convergedFrame);
+	return result;
+}
+
+
+// Input bits as stored in replays
+unsigned char PackPlayerInput(PlayerInput input)
+{
+	return (input.bMoveLeft ? 1 : 0) | (input.bMoveRight ? 2 : 0) | (input.bJump ? 4 : 0);
+}
+
+PlayerInput UnpackPlayerInput(unsigned char bits)
+{
+	PlayerInput input;
+	memset(&input, 0, sizeof(input));
+	input.bMoveLeft = (bits & 1) != 0;
+	input.bMoveRight = (bits & 2) != 0;
+	input.bJump = (bits & 4) != 0;
+	return input;
+}
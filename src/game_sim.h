@@ -0,0 +1,196 @@
+// Game simulation.
+//
+// The game state, player tuning and StepGame, split from the gameplay screen so the
+// simulation runs without a window: in the screen itself, in headless runs and benchmarks.
+// Reading input and drawing stay in the screen.
+
+#ifndef GAME_SIM_H
+#define GAME_SIM_H
+
+#include "raylib.h"
+#include "coll.h"
+
+#include <stddef.h>
+
+struct ldtk_world;
+struct StateHistory;
+struct EntityStore;
+
+typedef struct PlayerInput
+{
+	bool bMoveLeft;
+	bool bMoveRight;
+	bool bJump;
+} PlayerInput;
+
+typedef enum EPlayerJumpState
+{
+	PJS_None,
+	PJS_JumpAscending,
+	PJS_JumpApex,
+	PJS_Falling
+} EPlayerJumpState;
+
+typedef struct Player
+{
+	// runtime vars
+	Vector2 Location;
+	Vector2 Velocity;
+	int JumpCount;
+	EPlayerJumpState JumpState;
+	int JumpStateTime;
+	int NotGroundedTime;
+	bool bIsJumping;
+
+	// was Jump pressed last frame?
+	bool bJumpPrev;
+} Player;
+
+
+typedef struct GameState
+{
+	Player Player;
+	PlayerInput Input;
+	int Frame;			// steps since the initial state, entities are placed from it
+} GameState;
+
+
+// outcome of RollbackInput
+typedef struct RollbackResult
+{
+	int frames;				// frames re-simulated after the edited one
+	int convergedFrame;		// first frame which came out as recorded, -1 if it ran to the end
+} RollbackResult;
+
+// tuning gives speeds in pixels per frame and times in frames at this rate, simulations
+// ticking at another rate convert it so the player moves the same
+#define kTuningTickRate 60
+#define kMinSimTickRate 30
+#define kMaxSimTickRate 240
+
+// movement tuning, each simulation can run with its own
+typedef struct PlayerTuning
+{
+	// player size
+	int Width;
+	int Height;
+	// max height of jump if player holds the jump button
+	float JumpHeight;
+	// how many frames to reach peak height?
+	float JumpFrames;
+	// alternative to JumpFrames - pick a target distance (at max speed)
+	float JumpDistance;
+
+	// change jump gravity this much when falling (>1 for falling faster)
+	float FallGravityScale;
+
+	// change jump gravity this much when player releases jump early
+	float JumpReleaseGravityScale;
+
+	// how many frames to pause at the top of the jump
+	int HangTimeFrames;
+
+	// 0 - no accel, 1 infinite accel
+	float AccelX;
+	// max speed pixels/frame
+	float MaxSpeedX;
+
+	// max speed pixels/frame
+	float MaxFallSpeed;
+
+	// 2 is double jump
+	int MaxJumpCount;
+
+	// how many frames of coyote time
+	int CoyoteTime;
+} PlayerTuning;
+
+// tuning values stored in replays, playing a replay back switches to its values
+typedef struct TuningVar
+{
+	const char* name;
+	size_t offset;		// of the field in PlayerTuning
+	bool isInt;
+} TuningVar;
+
+// everything a step reads and writes besides the game state, so simulations with their own
+// context can run side by side on different threads
+typedef struct SimContext
+{
+	const PlayerTuning* tuning;
+	struct ldtk_world* world;		// only read
+	float maxHeight;				// smallest y since the last jump off the ground
+	struct EntityStore* entities;	// moved to the new frame, may be NULL
+	int tickRate;					// steps per second
+} SimContext;
+
+// accumulated cost of the collision queries made while stepping, see SetSimProfile
+typedef struct SimProfile
+{
+	double collisionTime;		// seconds
+	long long collisionQueries;
+} SimProfile;
+
+
+// tuning of the game, see game_sim.c for the defaults
+extern PlayerTuning gPlayerTuning;
+
+extern const TuningVar gTuningVars[];
+extern const int gTuningVarCount;
+
+// track how high the player has jumped
+extern float gStat_MaxHeight;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// World the player collides with, must be set before stepping
+void SetSimWorld(struct ldtk_world* world);
+
+// Entities StepGame moves along with the player, NULL for none
+void SetSimEntities(struct EntityStore* entities);
+
+// Steps per second StepGame and RollbackInput simulate, clamped to kMinSimTickRate..
+// kMaxSimTickRate. Frames recorded at one rate must be replayed at the same rate.
+void SetSimTickRate(int tickRate);
+int GetSimTickRate(void);
+
+// Time of a step in frames at kTuningTickRate, which is what entity patrols are timed in
+float GetTuningFrame(int step, int tickRate);
+
+// Time collision queries into profile while set, NULL to stop. Not thread safe, leave it
+// unset while simulations run in parallel.
+void SetSimProfile(SimProfile* profile);
+
+// iterate the ldtk world and raycast against each collision layer to find the closest collision
+coll_trace_hit_t ldtk_trace_ray(struct ldtk_world* world, Vector2 start, Vector2 end, int depth);
+coll_trace_hit_t ldtk_sweep_aabb(struct ldtk_world* world, coll_aabb_t aabb, Vector2 dir, int depth);
+
+// State of the first frame, padding bytes are zeroed so they never differ between frames
+GameState GetInitialGameState(void);
+
+float GetTuningValue(const PlayerTuning* tuning, const TuningVar* var);
+void SetTuningValue(PlayerTuning* tuning, const TuningVar* var, float value);
+
+void UpdatePlayer(SimContext* sim, GameState* state);
+GameState StepSim(SimContext* sim, GameState state);
+
+// StepSim with gPlayerTuning, the world from SetSimWorld, the entities from SetSimEntities,
+// the rate from SetSimTickRate and gStat_MaxHeight
+GameState StepGame(GameState state);
+
+// Change the input of a recorded frame and re-simulate from there, keeping the recorded
+// inputs of the later frames. Stops early once the timeline converges back onto the recording.
+RollbackResult RollbackInput(struct StateHistory* history, int frame, PlayerInput input);
+
+// Input bits as stored in replays
+unsigned char PackPlayerInput(PlayerInput input);
+PlayerInput UnpackPlayerInput(unsigned char bits);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // GAME_SIM_H
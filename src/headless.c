@@ -0,0 +1,1218 @@
+#include "headless.h"
+#include "game_sim.h"
+#include "replay.h"
+#include "sim_batch.h"
+#include "entities.h"
+#include "assets.h"
+#include "atlas.h"
+#include "bake.h"
+#include "ldtk.h"
+#include "pack.h"
+#include "music_stream.h"
+#include "sys.h"
+
+#include "raylib.h"
+#include "cute_aseprite.h"
+#include "parson.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kHeadlessWorldFileName "resources/WorldMap_GridVania_layout.ldtk"
+#define kHeadlessDefaultSeconds (60 * 60)	// of scripted play, frames depend on the rate
+#define kHeadlessBatchSeconds 60
+#define kHeadlessBatchScripts 8
+#define kHeadlessEntityFrames 600
+#define kHeadlessInflateRepeats 20
+#define kHeadlessBakeRepeats 10
+#define kHeadlessPackRepeats 20
+#define kHeadlessPackFileName "headless.pack"
+#define kHeadlessMusicSeconds 20	// of music played
+#define kHeadlessMusicSpeed 4		// times faster than real time
+#define kHeadlessMusicPeriods 100	// reads per second of music, like a 10 ms device buffer
+#define kHeadlessParseRepeats 10
+#define kHeadlessThroughputRepeats 20
+#define kHeadlessTileRepeats 100
+#define kHeadlessAtlasMaxRects 300		// per random set
+
+
+// Deterministic stand-in for a player: walks one way for a while, stops or turns around,
+// and holds jump for a random number of frames every now and then.
+typedef struct InputScript
+{
+	unsigned int rng;
+	int moveFrames;
+	int jumpFrames;
+	unsigned char move;
+	bool jump;
+} InputScript;
+
+static unsigned int NextRandom(InputScript* script)
+{
+	// xorshift32, the seed must not be zero
+	unsigned int x = script->rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	script->rng = x;
+	return x;
+}
+
+static unsigned char NextScriptedInput(InputScript* script)
+{
+	if (script->moveFrames-- <= 0)
+	{
+		unsigned int r = NextRandom(script) % 4;
+		script->move = (r == 0) ? 0 : (r == 1) ? 1 : 2;		// stand, left, right (twice as likely)
+		script->moveFrames = 30 + NextRandom(script) % 150;
+	}
+
+	if (script->jumpFrames-- <= 0)
+	{
+		script->jump = !script->jump;
+		script->jumpFrames = script->jump ? 3 + NextRandom(script) % 25 : 10 + NextRandom(script) % 90;
+	}
+
+	PlayerInput input;
+	memset(&input, 0, sizeof(input));
+	input.bMoveLeft = (script->move == 1);
+	input.bMoveRight = (script->move == 2);
+	input.bJump = script->jump;
+	return PackPlayerInput(input);
+}
+
+
+// Step all inputs from the initial state, returns the elapsed seconds
+static double RunFrames(const unsigned char* inputs, int count, GameState* finalState)
+{
+	GameState state = GetInitialGameState();
+	gStat_MaxHeight = 0.0f;
+
+	double start = GetHighResTime();
+	for (int i = 0; i < count; ++i)
+	{
+		state.Input = UnpackPlayerInput(inputs[i]);
+		state = StepGame(state);
+	}
+	double elapsed = GetHighResTime() - start;
+
+	*finalState = state;
+	return elapsed;
+}
+
+
+// Sweep jump height and acceleration over a few input scripts, running the whole batch on
+// 1, 2, 4... threads up to maxThreads. Every run must produce the same metrics.
+static int RunBatchBenchmark(struct ldtk_world* world, int jobCount, int frames, unsigned int seed, int maxThreads)
+{
+	unsigned char* inputs = malloc((size_t)kHeadlessBatchScripts * frames);
+	SimJob* jobs = malloc((size_t)jobCount * sizeof(SimJob));
+	SimMetrics* reference = malloc((size_t)jobCount * sizeof(SimMetrics));
+	if (!inputs || !jobs || !reference)
+	{
+		printf("out of memory\n");
+		free(inputs);
+		free(jobs);
+		free(reference);
+		return 1;
+	}
+
+	for (int s = 0; s < kHeadlessBatchScripts; ++s)
+	{
+		InputScript script = { (seed ? seed : 1) + s * 7919, 0, 0, 0, false };
+		for (int i = 0; i < frames; ++i)
+		{
+			inputs[s * frames + i] = NextScriptedInput(&script);
+		}
+	}
+
+	// square grid of JumpHeight 16..64 by AccelX 0.1..1, repeated over the scripts
+	int side = 1;
+	while ((side + 1) * (side + 1) <= jobCount / kHeadlessBatchScripts) side++;
+	for (int i = 0; i < jobCount; ++i)
+	{
+		int cell = i / kHeadlessBatchScripts;
+		float u = (side > 1) ? (float)(cell % side) / (side - 1) : 0.5f;
+		float v = (side > 1) ? (float)((cell / side) % side) / (side - 1) : 0.5f;
+
+		SimJob* job = &jobs[i];
+		job->tuning = gPlayerTuning;
+		job->tuning.JumpHeight = 16.0f + 48.0f * u;
+		job->tuning.AccelX = 0.1f + 0.9f * v;
+		job->inputs = &inputs[(i % kHeadlessBatchScripts) * frames];
+		job->frameCount = frames;
+	}
+
+	printf("batch:      %d jobs x %d frames, %d processors\n", jobCount, frames, GetProcessorCount());
+
+	bool deterministic = true;
+	double baseline = 0.0;
+	for (int threads = 1; ; threads *= 2)
+	{
+		if (threads > maxThreads) threads = maxThreads;
+
+		double start = GetHighResTime();
+		RunSimBatch(world, jobs, jobCount, threads);
+		double elapsed = GetHighResTime() - start;
+
+		if (threads == 1)
+		{
+			baseline = elapsed;
+			for (int i = 0; i < jobCount; ++i) reference[i] = jobs[i].metrics;
+		}
+		else
+		{
+			for (int i = 0; i < jobCount; ++i)
+			{
+				if (memcmp(&reference[i], &jobs[i].metrics, sizeof(SimMetrics)) != 0) deterministic = false;
+			}
+		}
+
+		double speedup = baseline / elapsed;
+		printf("  %2d threads %.3f s, %.0f jobs/s, %.1fM frames/s, %.2fx (%.0f%% efficiency)\n", threads, elapsed, jobCount / elapsed,
+			(double)jobCount * frames / elapsed * 1e-6, speedup, 100.0 * speedup / threads);
+
+		if (threads == maxThreads) break;
+	}
+
+	// show the spread the sweep produced
+	float minHeight = reference[0].maxJumpHeight, maxHeight = minHeight;
+	float minDistance = reference[0].distance, maxDistance = minDistance;
+	for (int i = 1; i < jobCount; ++i)
+	{
+		if (reference[i].maxJumpHeight < minHeight) minHeight = reference[i].maxJumpHeight;
+		if (reference[i].maxJumpHeight > maxHeight) maxHeight = reference[i].maxJumpHeight;
+		if (reference[i].distance < minDistance) minDistance = reference[i].distance;
+		if (reference[i].distance > maxDistance) maxDistance = reference[i].distance;
+	}
+	printf("metrics:    jump height %.1f..%.1f px, distance %.1f..%.1f px\n", minHeight, maxHeight, minDistance, maxDistance);
+	if (!deterministic) printf("error: metrics depend on the thread count\n");
+
+	free(inputs);
+	free(jobs);
+	free(reference);
+	return deterministic ? 0 : 1;
+}
+
+
+// Spawn the world's entities plus random patrolling ones up to count, then time updating them
+// all every frame and an overlap query around a spot in each level.
+static int RunEntityBenchmark(struct ldtk_world* world, int count, int frames, unsigned int seed)
+{
+	EntityStore store;
+	InitEntityStore(&store);
+	int placed = SpawnWorldEntities(&store, world);
+
+	InputScript rng = { seed ? seed : 1, 0, 0, 0, false };
+	int kind = GetEntityKind(&store, "Benchmark");
+	int levelCount = ldtk_get_level_count(world);
+	while (store.count < count)
+	{
+		ldtk_level* level = ldtk_get_level(world, NextRandom(&rng) % levelCount);
+		Rectangle rect = {
+			(float)(level->worldX + NextRandom(&rng) % level->pxWid),
+			(float)(level->worldY + NextRandom(&rng) % level->pxHei),
+			8.0f + NextRandom(&rng) % 24,
+			8.0f + NextRandom(&rng) % 24
+		};
+		Vector2 patrol = { (float)(NextRandom(&rng) % 129) - 64.0f, (float)(NextRandom(&rng) % 33) - 16.0f };
+		float speed = 0.25f + (NextRandom(&rng) % 100) * 0.01f;
+		if (SpawnEntity(&store, kind, rect, patrol, speed, level->worldDepth, WHITE) < 0)
+		{
+			printf("out of memory\n");
+			FreeEntityStore(&store);
+			return 1;
+		}
+	}
+
+	double start = GetHighResTime();
+	for (int f = 1; f <= frames; ++f)
+	{
+		UpdateEntities(&store, (float)f);
+	}
+	double updateTime = GetHighResTime() - start;
+
+	// a 256x256 area in the middle of every level, roughly what the camera sees
+	long long hits = 0;
+	start = GetHighResTime();
+	for (int l = 0; l < levelCount; ++l)
+	{
+		ldtk_level* level = ldtk_get_level(world, l);
+		Rectangle area = { level->worldX + level->pxWid * 0.5f - 128.0f, level->worldY + level->pxHei * 0.5f - 128.0f, 256.0f, 256.0f };
+		hits += QueryEntities(&store, area, level->worldDepth, NULL, 0);
+	}
+	double queryTime = GetHighResTime() - start;
+
+	double updates = (double)store.count * frames;
+	printf("entities:   %d (%d from the world, %d kinds), %d frames\n", store.count, placed, store.kindCount, frames);
+	printf("update:     %.3f ms/frame, %.2f ns/entity, %.0f entities/ms\n", updateTime * 1e3 / frames, updateTime * 1e9 / updates,
+		updates / (updateTime * 1e3));
+	printf("query:      %.1f us/query over all entities, %.1f hits/query\n", queryTime * 1e6 / levelCount, (double)hits / levelCount);
+
+	FreeEntityStore(&store);
+	return 0;
+}
+
+
+// Look up the tiles of every cell of every tile layer in the world through the cell index,
+// then by scanning the layer's tile lists the way lookups were done before it. Checks both find
+// the same tiles in the same order and prints the time per lookup.
+static int RunTileBenchmark(struct ldtk_world* world, int repeats)
+{
+	int levelCount = ldtk_get_level_count(world);
+	long long cells = 0;
+	long long tiles = 0;
+	int layers = 0;
+	bool matching = true;
+
+	for (int l = 0; l < levelCount; ++l)
+	{
+		ldtk_level* level = ldtk_get_level(world, l);
+		for (int i = 0; i < level->layer_instances_count; ++i)
+		{
+			const ldtk_layer_instance* inst = &level->layer_instances[i];
+			if (!inst->cell_tile_offsets) continue;
+			layers++;
+			cells += inst->cWid * inst->cHei;
+			tiles += inst->autotile_count + inst->gridtile_count;
+
+			for (int y = 0; y < inst->cHei && matching; ++y)
+			{
+				for (int x = 0; x < inst->cWid && matching; ++x)
+				{
+					ldtk_tile_span span = ldtk_layer_tiles_at(inst, x, y);
+					int found = 0;
+					for (int list = 0; list < 2; ++list)
+					{
+						const ldtk_tile* lists = (list == 0) ? inst->autotiles : inst->gridtiles;
+						int count = (list == 0) ? inst->autotile_count : inst->gridtile_count;
+						for (int t = 0; t < count; ++t)
+						{
+							const ldtk_tile* tile = &lists[t];
+							if (tile->px_x < 0 || tile->px_y < 0 || tile->px_x / inst->grid_size != x || tile->px_y / inst->grid_size != y) continue;
+							if (found >= span.count || span.tiles[found] != tile) matching = false;
+							found++;
+						}
+					}
+					if (found != span.count) matching = false;
+				}
+			}
+		}
+	}
+
+	if (!matching)
+	{
+		printf("tiles:      the cell index and the scan found different tiles\n");
+		return 1;
+	}
+	if (cells == 0)
+	{
+		printf("tiles:      the world has no tile layers\n");
+		return 0;
+	}
+
+	long long indexFound = 0;
+	double start = GetHighResTime();
+	for (int r = 0; r < repeats; ++r)
+	{
+		for (int l = 0; l < levelCount; ++l)
+		{
+			ldtk_level* level = ldtk_get_level(world, l);
+			for (int i = 0; i < level->layer_instances_count; ++i)
+			{
+				const ldtk_layer_instance* inst = &level->layer_instances[i];
+				if (!inst->cell_tile_offsets) continue;
+				for (int y = 0; y < inst->cHei; ++y)
+				{
+					for (int x = 0; x < inst->cWid; ++x)
+					{
+						indexFound += ldtk_layer_tiles_at(inst, x, y).count;
+					}
+				}
+			}
+		}
+	}
+	double indexTime = GetHighResTime() - start;
+
+	// the scan is orders of magnitude slower, once over the world is plenty
+	long long scanFound = 0;
+	start = GetHighResTime();
+	for (int l = 0; l < levelCount; ++l)
+	{
+		ldtk_level* level = ldtk_get_level(world, l);
+		for (int i = 0; i < level->layer_instances_count; ++i)
+		{
+			const ldtk_layer_instance* inst = &level->layer_instances[i];
+			if (!inst->cell_tile_offsets) continue;
+			for (int y = 0; y < inst->cHei; ++y)
+			{
+				for (int x = 0; x < inst->cWid; ++x)
+				{
+					for (int t = 0; t < inst->autotile_count; ++t)
+					{
+						const ldtk_tile* tile = &inst->autotiles[t];
+						scanFound += (tile->px_x >= 0 && tile->px_y >= 0 && tile->px_x / inst->grid_size == x && tile->px_y / inst->grid_size == y);
+					}
+					for (int t = 0; t < inst->gridtile_count; ++t)
+					{
+						const ldtk_tile* tile = &inst->gridtiles[t];
+						scanFound += (tile->px_x >= 0 && tile->px_y >= 0 && tile->px_x / inst->grid_size == x && tile->px_y / inst->grid_size == y);
+					}
+				}
+			}
+		}
+	}
+	double scanTime = GetHighResTime() - start;
+
+	printf("tiles:      %lld tiles in %lld cells of %d layers\n", tiles, cells, layers);
+	printf("index:      %.1f ns/lookup, %lld tiles found over %d repeats\n", indexTime * 1e9 / ((double)cells * repeats), indexFound, repeats);
+	printf("scan:       %.1f ns/lookup, %lld tiles found\n", scanTime * 1e9 / (double)cells, scanFound);
+	printf("speedup:    %.0fx\n", (scanTime / cells) / (indexTime / ((double)cells * repeats)));
+	return 0;
+}
+
+
+// Where the zlib data of a compressed cel is in an .aseprite file
+typedef struct CelStream
+{
+	const unsigned char* data;		// deflate data, after the two byte zlib header
+	int size;
+	int rawSize;					// of the decoded pixels
+} CelStream;
+
+
+static unsigned int ReadLittleEndian(const unsigned char* data, int bytes)
+{
+	unsigned int value = 0;
+	for (int i = bytes - 1; i >= 0; --i) value = (value << 8) | data[i];
+	return value;
+}
+
+
+// Walk the frames and chunks of an .aseprite file to find its compressed cels, skipping the
+// rest of the file. Returns the number of cels found, or -1 if out of memory.
+static int FindCelStreams(const unsigned char* data, int size, CelStream** streams, int* capacity)
+{
+	if (size < 128 || ReadLittleEndian(data + 4, 2) != 0xA5E0) return 0;
+	int frameCount = (int)ReadLittleEndian(data + 6, 2);
+	int bytesPerPixel = (int)ReadLittleEndian(data + 12, 2) / 8;
+
+	int count = 0;
+	int frameOffset = 128;
+	for (int f = 0; f < frameCount && frameOffset + 16 <= size; ++f)
+	{
+		const unsigned char* frame = data + frameOffset;
+		int frameSize = (int)ReadLittleEndian(frame, 4);
+		if (ReadLittleEndian(frame + 4, 2) != 0xF1FA || frameSize < 16 || frameSize > size - frameOffset) break;
+
+		int chunkCount = (int)ReadLittleEndian(frame + 6, 2);
+		if (chunkCount == 0xFFFF) chunkCount = (int)ReadLittleEndian(frame + 12, 4);
+
+		int chunkOffset = 16;
+		for (int c = 0; c < chunkCount && chunkOffset + 6 <= frameSize; ++c)
+		{
+			const unsigned char* chunk = frame + chunkOffset;
+			int chunkSize = (int)ReadLittleEndian(chunk, 4);
+			if (chunkSize < 6 || chunkSize > frameSize - chunkOffset) break;
+			chunkOffset += chunkSize;
+
+			// cel chunk: layer, x, y, opacity, cel type, z-index and 5 reserved bytes, then
+			// for compressed cels the width, height and zlib data
+			const unsigned char* cel = chunk + 6;
+			if (ReadLittleEndian(chunk + 4, 2) != 0x2005 || chunkSize < 6 + 22 || ReadLittleEndian(cel + 7, 2) != 2) continue;
+
+			if (count == *capacity)
+			{
+				int grown = *capacity ? *capacity * 2 : 64;
+				CelStream* resized = realloc(*streams, grown * sizeof(CelStream));
+				if (!resized) return -1;
+				*streams = resized;
+				*capacity = grown;
+			}
+			CelStream* stream = &(*streams)[count++];
+			stream->data = cel + 22;
+			stream->size = chunkSize - 6 - 22;
+			stream->rawSize = (int)ReadLittleEndian(cel + 16, 2) * (int)ReadLittleEndian(cel + 18, 2) * bytesPerPixel;
+		}
+		frameOffset += frameSize;
+	}
+	return count;
+}
+
+
+// Decode the compressed cels of every .aseprite file in a directory with the table driven
+// inflate and the reference one, check both give the same pixels and print their throughput,
+// then time loading the files whole.
+static int RunInflateBenchmark(const char* directory)
+{
+	FilePathList files = LoadDirectoryFiles(directory);
+	CelStream* streams = NULL;
+	int capacity = 0;
+	int fileCount = 0;
+	int celCount = 0;
+	int mismatches = 0;
+	long long compressedBytes = 0;
+	long long rawBytes = 0;
+	double referenceTime = 0.0;
+	double fastTime = 0.0;
+	double loadTime = 0.0;
+
+	for (unsigned int i = 0; i < files.count; ++i)
+	{
+		if (!IsFileExtension(files.paths[i], ".aseprite")) continue;
+
+		unsigned int size = 0;
+		unsigned char* data = LoadFileData(files.paths[i], &size);
+		int count = data ? FindCelStreams(data, (int)size, &streams, &capacity) : 0;
+		if (count < 0)
+		{
+			printf("out of memory\n");
+			UnloadFileData(data);
+			break;
+		}
+		fileCount++;
+
+		for (int c = 0; c < count; ++c)
+		{
+			const CelStream* stream = &streams[c];
+			unsigned char* reference = malloc(stream->rawSize);
+			unsigned char* fast = malloc(stream->rawSize);
+			if (!reference || !fast)
+			{
+				free(reference);
+				free(fast);
+				continue;
+			}
+
+			int referenceResult = cute_aseprite_inflate_reference(stream->data, stream->size, reference, stream->rawSize, NULL);
+			memset(fast, 0, stream->rawSize);
+			int fastResult = cute_aseprite_inflate(stream->data, stream->size, fast, stream->rawSize, NULL);
+			if (referenceResult != fastResult || memcmp(reference, fast, stream->rawSize) != 0)
+			{
+				printf("cel %d of %s decodes differently\n", c, GetFileName(files.paths[i]));
+				mismatches++;
+			}
+
+			double start = GetHighResTime();
+			for (int r = 0; r < kHeadlessInflateRepeats; ++r)
+			{
+				cute_aseprite_inflate_reference(stream->data, stream->size, reference, stream->rawSize, NULL);
+			}
+			referenceTime += GetHighResTime() - start;
+
+			start = GetHighResTime();
+			for (int r = 0; r < kHeadlessInflateRepeats; ++r)
+			{
+				cute_aseprite_inflate(stream->data, stream->size, fast, stream->rawSize, NULL);
+			}
+			fastTime += GetHighResTime() - start;
+
+			celCount++;
+			compressedBytes += stream->size;
+			rawBytes += stream->rawSize;
+			free(reference);
+			free(fast);
+		}
+
+		// cels inflated and frames composed, on as many threads as the game uses
+		double start = GetHighResTime();
+		for (int r = 0; data && r < kHeadlessInflateRepeats; ++r)
+		{
+			cute_aseprite_free(cute_aseprite_load_from_memory(data, (int)size, NULL));
+		}
+		loadTime += GetHighResTime() - start;
+		UnloadFileData(data);
+	}
+	free(streams);
+	UnloadDirectoryFiles(files);
+
+	if (celCount == 0)
+	{
+		printf("no compressed cels in %s\n", directory);
+		return 1;
+	}
+
+	double megabytes = (double)rawBytes * kHeadlessInflateRepeats / (1024.0 * 1024.0);
+	printf("inflate:    %d cels in %d files, %.2f MB compressed to %.2f MB\n", celCount, fileCount,
+		compressedBytes / (1024.0 * 1024.0), rawBytes / (1024.0 * 1024.0));
+	printf("reference:  %.1f MB/s\n", megabytes / referenceTime);
+	printf("table:      %.1f MB/s, %.2fx\n", megabytes / fastTime, referenceTime / fastTime);
+	printf("output:     %s\n", mismatches ? "DIFFERENT" : "identical");
+	printf("load:       %.2f ms/file\n", loadTime * 1e3 / (fileCount * kHeadlessInflateRepeats));
+	return mismatches ? 1 : 0;
+}
+
+
+static unsigned long long HashFile(const char* fileName)
+{
+	unsigned int size = 0;
+	unsigned char* data = LoadFileData(fileName, &size);
+	unsigned long long hash = data ? HashReplayData(data, size) : 0;
+	UnloadFileData(data);
+	return hash;
+}
+
+
+// Load every PNG and .aseprite file in a directory the way the asset cache does: hashing and
+// decoding it, as a first run does while baking it, and hashing it and mapping the baked
+// pixels, as later runs do. Checks both give the same image.
+static int RunBakeBenchmark(const char* directory)
+{
+	FilePathList files = LoadDirectoryFiles(directory);
+	int imageCount = 0;
+	int failures = 0;
+	long long pixelBytes = 0;
+	double coldTime = 0.0;
+	double warmTime = 0.0;
+
+	for (unsigned int i = 0; i < files.count; ++i)
+	{
+		const char* fileName = files.paths[i];
+		bool aseprite = IsFileExtension(fileName, ".aseprite");
+		if (!aseprite && !IsFileExtension(fileName, ".png")) continue;
+
+		Image image = { 0 };
+		bool saved = true;
+		double start = GetHighResTime();
+		for (int r = 0; r < kHeadlessBakeRepeats; ++r)
+		{
+			UnloadImage(image);
+			unsigned long long hash = HashFile(fileName);
+			image = aseprite ? LoadAsepriteImage(fileName) : LoadImage(fileName);
+			ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+			saved = SaveBakedImage(hash, 0, &image) && saved;
+		}
+		coldTime += GetHighResTime() - start;
+
+		BakedImage baked = { 0 };
+		bool loaded = true;
+		start = GetHighResTime();
+		for (int r = 0; r < kHeadlessBakeRepeats; ++r)
+		{
+			UnloadBakedImage(&baked);
+			loaded = LoadBakedImage(HashFile(fileName), 0, &baked) && loaded;
+		}
+		warmTime += GetHighResTime() - start;
+
+		size_t size = (size_t)image.width * image.height * 4;
+		if (!image.data || !saved || !loaded || baked.image.width != image.width || baked.image.height != image.height ||
+			memcmp(baked.image.data, image.data, size) != 0)
+		{
+			printf("%s doesn't load the same from the bake directory\n", GetFileName(fileName));
+			failures++;
+		}
+
+		imageCount++;
+		pixelBytes += (long long)size;
+		UnloadBakedImage(&baked);
+		UnloadImage(image);
+	}
+	UnloadDirectoryFiles(files);
+
+	if (imageCount == 0)
+	{
+		printf("no images in %s\n", directory);
+		return 1;
+	}
+
+	double coldMs = coldTime * 1e3 / kHeadlessBakeRepeats;
+	double warmMs = warmTime * 1e3 / kHeadlessBakeRepeats;
+	printf("bake:       %d images, %.2f MB of pixels in %s/\n", imageCount, pixelBytes / (1024.0 * 1024.0), kBakeDirectory);
+	printf("cold:       %.2f ms (hash, decode and bake)\n", coldMs);
+	printf("warm:       %.2f ms (hash and map), %.1fx\n", warmMs, coldMs / warmMs);
+	printf("output:     %s\n", failures ? "DIFFERENT" : "identical");
+	return failures ? 1 : 0;
+}
+
+
+// Read and hash every file, then parse the worlds among them, from the pack if one is given.
+// Adds the time of each to times.
+static int LoadPackBenchmarkFiles(const FilePathList* files, const char* packFileName, unsigned long long* hash, double times[2])
+{
+	int failures = 0;
+	double start = GetHighResTime();
+	if (packFileName && !MountPack(packFileName)) return 1;
+	for (unsigned int i = 0; i < files->count; ++i)
+	{
+		PackSlice slice;
+		if (packFileName && LoadPackFile(files->paths[i], &slice))
+		{
+			*hash ^= HashReplayData(slice.data, slice.size) + i;
+			UnloadPackFile(&slice);
+		}
+		else if (!packFileName)
+		{
+			unsigned int size = 0;
+			unsigned char* data = LoadFileData(files->paths[i], &size);
+			*hash ^= data ? HashReplayData(data, size) + i : 0;
+			UnloadFileData(data);
+		}
+	}
+	double middle = GetHighResTime();
+	for (unsigned int i = 0; i < files->count; ++i)
+	{
+		if (!IsFileExtension(files->paths[i], ".ldtk")) continue;
+		struct ldtk_world* world = ldtk_load_world(files->paths[i]);
+		if (!world) failures++;
+		ldtk_destroy_world(world);
+	}
+	UnmountPack();
+	times[0] += middle - start;
+	times[1] += GetHighResTime() - middle;
+	return failures;
+}
+
+
+// Load every file in a directory the way startup does, as loose files and from packs of the
+// directory, stored and compressed, mounting them each time. Checks all give the same bytes.
+static int RunPackBenchmark(const char* directory)
+{
+	static const char* const packFileNames[] = { kHeadlessPackFileName, kHeadlessPackFileName ".lz" };
+	if (!BuildPack(directory, packFileNames[0], false) || !BuildPack(directory, packFileNames[1], true)) return 1;
+
+	FilePathList files = LoadDirectoryFilesEx(directory, NULL, true);
+	int failures = 0;
+	unsigned long long hashes[3] = { 0 };
+	double times[3][2] = { 0 };		// loose, stored and compressed: files, worlds
+
+	for (int r = 0; r < kHeadlessPackRepeats; ++r)
+	{
+		failures += LoadPackBenchmarkFiles(&files, NULL, &hashes[0], times[0]);
+		failures += LoadPackBenchmarkFiles(&files, packFileNames[0], &hashes[1], times[1]);
+		failures += LoadPackBenchmarkFiles(&files, packFileNames[1], &hashes[2], times[2]);
+	}
+	if (hashes[1] != hashes[0] || hashes[2] != hashes[0]) failures++;
+
+	long long bytes = 0;
+	int worldCount = 0;
+	for (unsigned int i = 0; i < files.count; ++i)
+	{
+		bytes += GetFileLength(files.paths[i]);
+		if (IsFileExtension(files.paths[i], ".ldtk")) worldCount++;
+	}
+	printf("pack:       %u files (%d worlds), %.1f KB, packed %.1f KB, compressed %.1f KB\n", files.count, worldCount,
+		bytes / 1024.0, GetFileLength(packFileNames[0]) / 1024.0, GetFileLength(packFileNames[1]) / 1024.0);
+	remove(packFileNames[0]);
+	remove(packFileNames[1]);
+	UnloadDirectoryFiles(files);
+
+	static const char* const labels[] = { "loose:     ", "packed:    ", "compressed:" };
+	for (int i = 0; i < 3; ++i)
+	{
+		double filesMs = times[i][0] * 1e3 / kHeadlessPackRepeats;
+		double worldsMs = times[i][1] * 1e3 / kHeadlessPackRepeats;
+		printf("%s %.2f ms reading and hashing, %.2f ms parsing worlds", labels[i], filesMs, worldsMs);
+		if (i > 0) printf(", %.2fx / %.2fx", times[0][0] / times[i][0], times[0][1] / times[i][1]);
+		printf("\n");
+	}
+	printf("output:     %s\n", failures ? "DIFFERENT" : "identical");
+	return failures ? 1 : 0;
+}
+
+// Play music without an audio device: this thread reads it the way the device's callback
+// would, a buffer at a time, while the decoding thread keeps up
+static int RunMusicBenchmark(const char* fileName)
+{
+	if (!LoadStreamedMusic(fileName, true))
+	{
+		printf("failed to load music: %s\n", fileName);
+		return 1;
+	}
+
+	MusicStreamStats stats = GetStreamedMusicStats();
+	int periodFrames = stats.sampleRate / kHeadlessMusicPeriods;
+	short* samples = malloc((size_t)periodFrames * stats.channels * sizeof(short));
+	int periods = kHeadlessMusicSeconds * kHeadlessMusicPeriods;
+	double period = 1.0 / (kHeadlessMusicPeriods * kHeadlessMusicSpeed);
+
+	double start = GetHighResTime();
+	double longestRead = 0.0;
+	for (int i = 0; samples && i < periods; ++i)
+	{
+		SleepSeconds(start + i * period - GetHighResTime());
+
+		double readStart = GetHighResTime();
+		ReadStreamedMusic(samples, periodFrames);
+		double readTime = GetHighResTime() - readStart;
+		if (readTime > longestRead) longestRead = readTime;
+		UpdateStreamedMusic();
+	}
+	double playTime = GetHighResTime() - start;
+
+	stats = GetStreamedMusicStats();
+	UnloadStreamedMusic();
+	free(samples);
+
+	double decodedSeconds = (double)stats.decodedFrames / stats.sampleRate;
+	printf("music:      %s, %d Hz, %d channels, %d s played in %.2f s\n", GetFileName(fileName), stats.sampleRate, stats.channels,
+		kHeadlessMusicSeconds, playTime);
+	printf("decode:     %.3f ms per second of music (%.0fx real time), longest %d frames in %.3f ms\n",
+		stats.decodeTime * 1e3 / decodedSeconds, decodedSeconds / stats.decodeTime, kMusicDecodeFrames, stats.maxDecodeTime * 1e3);
+	printf("device:     longest read %.3f ms, fewest frames buffered %d (%.1f ms)\n", longestRead * 1e3, stats.minBufferedFrames,
+		stats.minBufferedFrames * 1e3 / stats.sampleRate);
+	printf("underruns:  %d (%d frames)\n", stats.underruns, stats.underrunFrames);
+	return stats.underruns ? 1 : 0;
+}
+
+
+// Allocations made by parson, counted while benchmarking parsing
+static volatile int gParseAllocations = 0;
+
+static void* CountParseMalloc(size_t size)
+{
+	AtomicFetchAdd(&gParseAllocations, 1);
+	return malloc(size);
+}
+
+
+// Parse a json file the way parson does on its own, reading the file and allocating every
+// value, then load it as a world the way the asset cache does: read loose into a buffer, and
+// as a slice of a pack of its directory, both parsed by ldtk_parse_world into an arena
+static int RunParseBenchmark(const char* fileName)
+{
+	json_set_allocation_functions(CountParseMalloc, free);
+
+	double heapParse = 0.0, heapFree = 0.0, looseRead = 0.0, looseParse = 0.0, packedLoad = 0.0, packedParse = 0.0, worldFree = 0.0;
+	int heapAllocations = 0, looseAllocations = 0, packedAllocations = 0;
+	int levelCounts[2] = { -1, -1 };
+	bool loaded = true;
+
+	for (int r = 0; r < kHeadlessParseRepeats; ++r)
+	{
+		gParseAllocations = 0;
+		double start = GetHighResTime();
+		JSON_Value* heapRoot = json_parse_file(fileName);
+		heapParse += GetHighResTime() - start;
+		heapAllocations = gParseAllocations;
+		loaded = loaded && heapRoot;
+
+		start = GetHighResTime();
+		json_value_free(heapRoot);
+		heapFree += GetHighResTime() - start;
+
+		// loose files get room for the terminator, like in the asset cache
+		start = GetHighResTime();
+		unsigned int size = 0;
+		unsigned char* data = LoadFileData(fileName, &size);
+		unsigned char* text = data ? MemRealloc(data, size + 1) : NULL;
+		if (text) text[size] = 0;
+		else UnloadFileData(data);
+		looseRead += GetHighResTime() - start;
+
+		gParseAllocations = 0;
+		start = GetHighResTime();
+		struct ldtk_world* world = text ? ldtk_parse_world((const char*)text, size) : NULL;
+		looseParse += GetHighResTime() - start;
+		looseAllocations = gParseAllocations;
+		UnloadFileData(text);
+
+		loaded = loaded && world;
+		levelCounts[0] = ldtk_get_level_count(world);
+		start = GetHighResTime();
+		ldtk_destroy_world(world);
+		worldFree += GetHighResTime() - start;
+	}
+
+	// the pack holds the whole directory, with the paths the game opens its files by
+	bool packed = BuildPack(GetDirectoryPath(fileName), kHeadlessPackFileName, false) && MountPack(kHeadlessPackFileName);
+	for (int r = 0; r < kHeadlessParseRepeats && packed; ++r)
+	{
+		double start = GetHighResTime();
+		PackSlice slice;
+		bool found = LoadPackFile(fileName, &slice);
+		packedLoad += GetHighResTime() - start;
+
+		gParseAllocations = 0;
+		start = GetHighResTime();
+		struct ldtk_world* world = found ? ldtk_parse_world((const char*)slice.data, slice.size) : NULL;
+		packedParse += GetHighResTime() - start;
+		packedAllocations = gParseAllocations;
+		if (found) UnloadPackFile(&slice);
+
+		loaded = loaded && world;
+		levelCounts[1] = ldtk_get_level_count(world);
+		ldtk_destroy_world(world);
+	}
+	UnmountPack();
+	remove(kHeadlessPackFileName);
+	json_set_allocation_functions(malloc, free);
+
+	double scale = 1e3 / kHeadlessParseRepeats;
+	printf("json:       %s, %.1f KB\n", GetFileName(fileName), GetFileLength(fileName) / 1024.0);
+	printf("heap:       %d allocations, parsed in %.2f ms, freed in %.2f ms\n", heapAllocations, heapParse * scale, heapFree * scale);
+	printf("loose:      read in %.2f ms, %d allocations, world parsed in %.2f ms\n", looseRead * scale, looseAllocations,
+		looseParse * scale);
+	if (packed)
+	{
+		printf("packed:     sliced in %.2f ms, %d allocations, world parsed in %.2f ms\n", packedLoad * scale, packedAllocations,
+			packedParse * scale);
+	}
+	else
+	{
+		printf("packed:     failed to pack %s\n", GetDirectoryPath(fileName));
+	}
+	printf("world:      %d levels, freed in %.2f ms\n", levelCounts[0], worldFree * scale);
+
+	// both ways must give the same world
+	bool ok = loaded && packed && levelCounts[0] == levelCounts[1];
+	printf("output:     %s\n", ok ? "loaded" : "FAILED");
+	return ok ? 0 : 1;
+}
+
+
+// Parse every world in a directory from memory into an arena, the way worlds are loaded, and
+// report how many megabytes of json are parsed per second
+static int RunParseThroughputBenchmark(const char* directory)
+{
+	FilePathList files = LoadDirectoryFilesEx(directory, NULL, true);
+	size_t totalBytes = 0;
+	double totalTime = 0.0;
+	int failures = 0;
+
+	for (unsigned int i = 0; i < files.count; ++i)
+	{
+		if (!IsFileExtension(files.paths[i], ".ldtk")) continue;
+		char* text = LoadFileText(files.paths[i]);
+		if (!text)
+		{
+			failures++;
+			continue;
+		}
+		size_t bytes = strlen(text);
+
+		double time = 0.0;
+		for (int r = 0; r < kHeadlessThroughputRepeats; ++r)
+		{
+			double start = GetHighResTime();
+			JSON_Arena* arena = json_arena_create(bytes);
+			JSON_Value* root = json_parse_string_in_arena(text, arena);
+			time += GetHighResTime() - start;
+			if (!root) failures++;
+			json_arena_free(arena);
+		}
+		UnloadFileText(text);
+
+		printf("%-40s %8.1f KB %8.1f MB/s\n", GetFileName(files.paths[i]), bytes / 1024.0,
+			bytes * (double)kHeadlessThroughputRepeats / time / 1e6);
+		totalBytes += bytes;
+		totalTime += time;
+	}
+	UnloadDirectoryFiles(files);
+
+	if (totalTime > 0.0)
+	{
+		printf("%-40s %8.1f KB %8.1f MB/s\n", "total", totalBytes / 1024.0,
+			totalBytes * (double)kHeadlessThroughputRepeats / totalTime / 1e6);
+	}
+	printf("output:     %s\n", failures ? "FAILED" : "parsed");
+	return failures ? 1 : 0;
+}
+
+
+// Pack random sets of rects, some of them empty or larger than a page, and check every rect
+// got a place inside its page's extents without touching another rect or its padding
+static int RunAtlasBenchmark(int sets, unsigned int seed)
+{
+	static const int pageSizes[] = { 64, 128, 256, 512 };
+	int* widths = malloc(kHeadlessAtlasMaxRects * sizeof(int));
+	int* heights = malloc(kHeadlessAtlasMaxRects * sizeof(int));
+	AtlasPlacement* placements = malloc(kHeadlessAtlasMaxRects * sizeof(AtlasPlacement));
+	int* pageWidths = malloc(kHeadlessAtlasMaxRects * sizeof(int));
+	int* pageHeights = malloc(kHeadlessAtlasMaxRects * sizeof(int));
+	int* pageLimits = malloc(kHeadlessAtlasMaxRects * sizeof(int));
+	if (!widths || !heights || !placements || !pageWidths || !pageHeights || !pageLimits)
+	{
+		printf("out of memory\n");
+		free(widths);
+		free(heights);
+		free(placements);
+		free(pageWidths);
+		free(pageHeights);
+		free(pageLimits);
+		return 1;
+	}
+
+	InputScript rng = { seed ? seed : 1, 0, 0, 0, false };
+	long long rectCount = 0, pageCount = 0, rectArea = 0, pageArea = 0;
+	double packTime = 0.0;
+	int failures = 0;
+
+	for (int set = 0; set < sets; ++set)
+	{
+		int count = 1 + NextRandom(&rng) % kHeadlessAtlasMaxRects;
+		int pageSize = pageSizes[NextRandom(&rng) % 4];
+		int padding = NextRandom(&rng) % 3;
+		int maxSide = 4 + NextRandom(&rng) % (pageSize / 2);
+		for (int i = 0; i < count; ++i)
+		{
+			unsigned int kind = NextRandom(&rng) % 64;
+			widths[i] = (kind == 0) ? 0 : (kind == 1) ? pageSize + NextRandom(&rng) % pageSize : 1 + NextRandom(&rng) % maxSide;
+			heights[i] = (kind == 0) ? NextRandom(&rng) % 8 : 1 + NextRandom(&rng) % maxSide;
+		}
+
+		double start = GetHighResTime();
+		int pages = PackAtlasRects(widths, heights, count, pageSize, padding, placements, pageWidths, pageHeights);
+		packTime += GetHighResTime() - start;
+
+		// a page is pageSize square unless an oversized rect opened it
+		for (int p = 0; p < pages; ++p) pageLimits[p] = pageSize;
+		for (int i = 0; i < count; ++i)
+		{
+			int p = placements[i].page;
+			if (p < 0 || p >= pages) continue;
+			if (widths[i] + padding > pageLimits[p]) pageLimits[p] = widths[i] + padding;
+			if (heights[i] + padding > pageLimits[p]) pageLimits[p] = heights[i] + padding;
+		}
+
+		int setFailures = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			const AtlasPlacement* a = &placements[i];
+			bool empty = widths[i] <= 0 || heights[i] <= 0;
+			if (empty)
+			{
+				if (a->page != -1) setFailures++;
+				continue;
+			}
+
+			if (a->page < 0 || a->page >= pages || a->x < 0 || a->y < 0 ||
+				a->x + widths[i] + padding > pageWidths[a->page] || a->y + heights[i] + padding > pageHeights[a->page] ||
+				pageWidths[a->page] > pageLimits[a->page] || pageHeights[a->page] > pageLimits[a->page])
+			{
+				setFailures++;
+				continue;
+			}
+			rectArea += (long long)widths[i] * heights[i];
+
+			for (int j = 0; j < i; ++j)
+			{
+				const AtlasPlacement* b = &placements[j];
+				if (b->page != a->page || widths[j] <= 0 || heights[j] <= 0) continue;
+				bool apart = a->x + widths[i] + padding <= b->x || b->x + widths[j] + padding <= a->x ||
+					a->y + heights[i] + padding <= b->y || b->y + heights[j] + padding <= a->y;
+				if (!apart) setFailures++;
+			}
+		}
+
+		if (setFailures && !failures)
+		{
+			printf("error:      set %d (%d rects, %d page size, %d padding) has %d bad placements\n", set, count, pageSize, padding,
+				setFailures);
+		}
+		failures += setFailures;
+		rectCount += count;
+		pageCount += pages;
+		for (int p = 0; p < pages; ++p) pageArea += (long long)pageWidths[p] * pageHeights[p];
+	}
+
+	free(widths);
+	free(heights);
+	free(placements);
+	free(pageWidths);
+	free(pageHeights);
+	free(pageLimits);
+
+	printf("atlas:      %d sets, %lld rects on %lld pages, %.1f%% of the used page area filled\n", sets, rectCount, pageCount,
+		pageArea ? 100.0 * rectArea / pageArea : 0.0);
+	printf("pack:       %.3f ms per set\n", sets ? packTime * 1e3 / sets : 0.0);
+	printf("output:     %s\n", failures ? "FAILED" : "placed");
+	return failures ? 1 : 0;
+}
+
+
+bool IsHeadlessSimulation(int argc, char** argv)
+{
+	return argc > 1 && strcmp(argv[1], "--simulate") == 0;
+}
+
+
+int RunHeadlessSimulation(int argc, char** argv)
+{
+	const char* worldFileName = kHeadlessWorldFileName;
+	const char* replayFileName = NULL;
+	int frames = 0;
+	unsigned int seed = 1;
+	int rate = kTuningTickRate;
+	int batchJobs = 0;
+	int threads = 0;
+	int entities = 0;
+	bool tiles = false;
+	const char* inflateDirectory = NULL;
+	const char* bakeDirectory = NULL;
+	const char* packDirectory = NULL;
+	const char* musicFileName = NULL;
+	const char* parseFileName = NULL;
+	const char* throughputDirectory = NULL;
+	int atlasSets = 0;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		bool hasValue = (i + 1 < argc);
+		if (strcmp(argv[i], "--simulate") == 0) continue;
+		else if (strcmp(argv[i], "--world") == 0 && hasValue) worldFileName = argv[++i];
+		else if (strcmp(argv[i], "--replay") == 0 && hasValue) replayFileName = argv[++i];
+		else if (strcmp(argv[i], "--frames") == 0 && hasValue) frames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--seed") == 0 && hasValue) seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+		else if (strcmp(argv[i], "--rate") == 0 && hasValue) rate = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--batch") == 0 && hasValue) batchJobs = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--threads") == 0 && hasValue) threads = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--entities") == 0 && hasValue) entities = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--tiles") == 0) tiles = true;
+		else if (strcmp(argv[i], "--inflate") == 0 && hasValue) inflateDirectory = argv[++i];
+		else if (strcmp(argv[i], "--bake") == 0 && hasValue) bakeDirectory = argv[++i];
+		else if (strcmp(argv[i], "--pack") == 0 && hasValue) packDirectory = argv[++i];
+		else if (strcmp(argv[i], "--music") == 0 && hasValue) musicFileName = argv[++i];
+		else if (strcmp(argv[i], "--parse") == 0 && hasValue) parseFileName = argv[++i];
+		else if (strcmp(argv[i], "--throughput") == 0 && hasValue) throughputDirectory = argv[++i];
+		else if (strcmp(argv[i], "--atlas") == 0 && hasValue) atlasSets = atoi(argv[++i]);
+		else
+		{
+			printf("unknown option: %s\n", argv[i]);
+			return 1;
+		}
+	}
+
+	SetTraceLogLevel(LOG_WARNING);
+	SetSimTickRate(rate);
+
+	if (inflateDirectory) return RunInflateBenchmark(inflateDirectory);
+	if (bakeDirectory) return RunBakeBenchmark(bakeDirectory);
+	if (packDirectory) return RunPackBenchmark(packDirectory);
+	if (musicFileName) return RunMusicBenchmark(musicFileName);
+	if (parseFileName) return RunParseBenchmark(parseFileName);
+	if (throughputDirectory) return RunParseThroughputBenchmark(throughputDirectory);
+	if (atlasSets > 0) return RunAtlasBenchmark(atlasSets, seed);
+
+	double loadStart = GetHighResTime();
+	struct ldtk_world* world = ldtk_load_world(worldFileName);
+	double loadTime = GetHighResTime() - loadStart;
+	if (!world)
+	{
+		printf("failed to load world: %s\n", worldFileName);
+		return 1;
+	}
+	SetSimWorld(world);
+
+	if (batchJobs > 0)
+	{
+		printf("world:      %s (%d levels, loaded in %.1f ms)\n", worldFileName, ldtk_get_level_count(world), loadTime * 1e3);
+		int result = RunBatchBenchmark(world, batchJobs, (frames > 0) ? frames : kHeadlessBatchSeconds * GetSimTickRate(), seed,
+			(threads > 0) ? threads : GetProcessorCount());
+		SetSimWorld(NULL);
+		ldtk_destroy_world(world);
+		return result;
+	}
+
+	if (entities > 0)
+	{
+		printf("world:      %s (%d levels, loaded in %.1f ms)\n", worldFileName, ldtk_get_level_count(world), loadTime * 1e3);
+		int result = RunEntityBenchmark(world, entities, (frames > 0) ? frames : kHeadlessEntityFrames, seed);
+		SetSimWorld(NULL);
+		ldtk_destroy_world(world);
+		return result;
+	}
+
+	if (tiles)
+	{
+		printf("world:      %s (%d levels, loaded in %.1f ms)\n", worldFileName, ldtk_get_level_count(world), loadTime * 1e3);
+		int result = RunTileBenchmark(world, kHeadlessTileRepeats);
+		SetSimWorld(NULL);
+		ldtk_destroy_world(world);
+		return result;
+	}
+
+	// inputs are prepared up front so producing them isn't part of the timing
+	unsigned char* inputs = NULL;
+	int count = 0;
+
+	if (replayFileName)
+	{
+		Replay replay;
+		if (!LoadReplay(replayFileName, &replay))
+		{
+			printf("failed to load replay: %s\n", replayFileName);
+			ldtk_destroy_world(world);
+			return 1;
+		}
+
+		unsigned int size = 0;
+		unsigned char* worldData = LoadFileData(worldFileName, &size);
+		if (worldData && HashReplayData(worldData, size) != replay.worldHash)
+		{
+			printf("warning: replay was recorded on a different world\n");
+		}
+		UnloadFileData(worldData);
+
+		for (int i = 0; i < gTuningVarCount; ++i)
+		{
+			float value;
+			if (!GetReplayTuning(&replay, gTuningVars[i].name, &value)) continue;
+			SetTuningValue(&gPlayerTuning, &gTuningVars[i], value);
+		}
+
+		// the recorded rate wins over --rate, the inputs only play back the same at it
+		SetSimTickRate(replay.tickRate);
+		if (GetSimTickRate() != replay.tickRate)
+		{
+			printf("warning: replay was recorded at %d Hz, simulating at %d Hz\n", replay.tickRate, GetSimTickRate());
+		}
+
+		inputs = replay.inputs;
+		count = replay.frameCount;
+		replay.inputs = NULL;
+		FreeReplay(&replay);
+	}
+	else
+	{
+		count = (frames > 0) ? frames : kHeadlessDefaultSeconds * GetSimTickRate();
+		inputs = malloc(count ? count : 1);
+		InputScript script = { seed ? seed : 1, 0, 0, 0, false };
+		for (int i = 0; i < count && inputs; ++i)
+		{
+			inputs[i] = NextScriptedInput(&script);
+		}
+	}
+
+	if (!inputs || count == 0)
+	{
+		printf("no frames to simulate\n");
+		free(inputs);
+		ldtk_destroy_world(world);
+		return 1;
+	}
+
+	// first run for throughput, then again with collision queries timed, which adds timer
+	// overhead but splits the cost. Both must end in the same state.
+	GameState finalState, profiledState;
+	double elapsed = RunFrames(inputs, count, &finalState);
+
+	SimProfile profile = { 0 };
+	SetSimProfile(&profile);
+	double profiledElapsed = RunFrames(inputs, count, &profiledState);
+	SetSimProfile(NULL);
+
+	bool deterministic = memcmp(&finalState, &profiledState, sizeof(GameState)) == 0;
+
+	double stepNs = elapsed * 1e9 / count;
+	double collisionShare = (profiledElapsed > 0.0) ? profile.collisionTime / profiledElapsed : 0.0;
+	double queriesPerFrame = (double)profile.collisionQueries / count;
+
+	printf("world:      %s (%d levels, loaded in %.1f ms)\n", worldFileName, ldtk_get_level_count(world), loadTime * 1e3);
+	if (replayFileName) printf("inputs:     %s\n", replayFileName);
+	else printf("inputs:     scripted, seed %u\n", seed);
+	printf("frames:     %d in %.3f s, %.0f frames/s (%.0fx real time at %d Hz)\n", count, elapsed, count / elapsed,
+		count / elapsed / GetSimTickRate(), GetSimTickRate());
+	printf("step:       %.1f ns/frame\n", stepNs);
+	printf("  movement  %.1f ns/frame (%.0f%%)\n", stepNs * (1.0 - collisionShare), 100.0 * (1.0 - collisionShare));
+	printf("  collision %.1f ns/frame (%.0f%%), %.2f queries/frame, %.1f ns/query\n", stepNs * collisionShare, 100.0 * collisionShare,
+		queriesPerFrame, (profile.collisionQueries > 0) ? profile.collisionTime * 1e9 / profile.collisionQueries : 0.0);
+	printf("final:      location (%.2f, %.2f), state hash %016llx\n", finalState.Player.Location.x, finalState.Player.Location.y,
+		HashReplayData((const unsigned char*)&finalState, sizeof(GameState)));
+	if (!deterministic) printf("error: runs ended in different states\n");
+
+	free(inputs);
+	SetSimWorld(NULL);
+	ldtk_destroy_world(world);
+	return deterministic ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+// Headless simulation runs.
+//
+// Steps the game as fast as possible without opening a window, driven by a replay file or
+// by scripted inputs, and prints simulation throughput with the time split into movement and
+// collision. With --batch it instead benchmarks a tuning sweep run on a growing number of
+// threads, with --entities the update of the entity store, with --tiles looking up the tiles
+// of a layer cell, with --inflate the decoding of aseprite cels, with --bake loading images
+// decoded or from the bake directory, with --pack loading files loose or from a resource pack,
+// with --music streaming music to a stand in for the audio device, with --parse parsing json
+// into the heap and loading it as a world loose or packed, with --throughput the rate worlds
+// are parsed at, with --atlas packing random rect sets into atlas pages. Started with:
+// raylib_game --simulate [options], see RunHeadlessSimulation.
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <stdbool.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// True if the command line asks for a headless run
+bool IsHeadlessSimulation(int argc, char** argv);
+
+// Options after --simulate:
+//   --world <file.ldtk>   world to collide with (default: the gameplay world)
+//   --replay <file.rpl>   inputs and tuning from a replay instead of scripted inputs
+//   --frames <n>          frames to simulate with scripted inputs (default: one hour)
+//   --seed <n>            seed of the scripted inputs
+//   --rate <hz>           steps per second, tuning is converted to it (default: 60, a replay
+//                         uses the rate it was recorded at)
+//   --batch <n>           run n simulations of a tuning sweep (default: one minute each)
+//   --threads <n>         most threads used by --batch (default: one per processor)
+//   --entities <n>        update n entities, the world's and random ones (default: 600 frames)
+//   --tiles               look up the tiles of every layer cell through the cell index, then
+//                         by scanning the layer's tiles
+//   --inflate <dir>       decode the cels of the .aseprite files in dir and time loading them,
+//                         e.g. resources/atlas
+//   --bake <dir>          load the .png and .aseprite files in dir decoded, then baked
+//   --pack <dir>          load the files in dir loose, then from a pack of them, e.g. resources
+//   --music <file>        play 20 s of music at 4x speed without an audio device, counting
+//                         underruns, e.g. resources/ambient.ogg
+//   --parse <file>        parse a json file with an allocation each, then load it as a world
+//                         read loose and from a pack of its directory, e.g.
+//                         resources/WorldMap_GridVania_layout.ldtk
+//   --throughput <dir>    parse every .ldtk file in dir into an arena and print MB/s, e.g.
+//                         resources
+//   --atlas <n>           pack n random rect sets and check no rect overlaps another or
+//                         leaves its page
+// Returns the process exit code, non-zero if the world or replay failed to load, the
+// simulation wasn't deterministic or a check failed.
+int RunHeadlessSimulation(int argc, char** argv);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // HEADLESS_H
@@ -1,6 +1,7 @@
 
 #include "ldtk.h"
 #include "external/parson.h"
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -14,8 +15,12 @@ struct ldtk_world
 	int tileset_count;
 	struct ldtk_tileset* tilesets;
 
+	int layer_def_count;
+	struct ldtk_layer_def* layer_defs;
+
 	// keep this around so the strings remain valid
 	JSON_Value* json_root;
+	JSON_Arena* json_arena;		// json_root and everything in it
 };
 
 
@@ -29,6 +34,19 @@ static void _ltdk_destroy_layer_instance(struct ldtk_layer_instance* inst)
 		free(inst->gridtiles);
 		free(inst->autotiles);
 		free(inst->int_grid);
+		free(inst->cell_tile_offsets);
+		free(inst->cell_tiles);
+
+		for (int i = 0; i < inst->entity_count; ++i)
+		{
+			struct ldtk_entity* entity = &inst->entities[i];
+			for (int f = 0; f < entity->field_count; ++f)
+			{
+				free(entity->fields[f].values);
+			}
+			free(entity->fields);
+		}
+		free(inst->entities);
 	}
 }
 
@@ -62,10 +80,18 @@ static void _ltdk_destroy_world(struct ldtk_world* world)
 			free(world->tilesets);
 		}
 
-		if (world->json_root)
+		if (world->layer_defs)
 		{
-			json_value_free(world->json_root);
+			for (int i = 0; i < world->layer_def_count; ++i)
+			{
+				free(world->layer_defs[i].int_grid_values);
+			}
+			free(world->layer_defs);
 		}
+
+		json_arena_free(world->json_arena);
+
+		free(world);
 	}
 }
 
@@ -96,6 +122,54 @@ static int _ltdk_parse_tilesets(struct ldtk_world* world, JSON_Array* tilesets_a
 	return 0;
 }
 
+static int _ltdk_parse_layer_defs(struct ldtk_world* world, JSON_Array* layers_arr)
+{
+	if (!world) return -1;
+	int count = (int)json_array_get_count(layers_arr);
+	if (count == 0) return 0;
+
+	world->layer_def_count = count;
+	world->layer_defs = calloc(count, sizeof(struct ldtk_layer_def));
+	if (!world->layer_defs) return -1;
+
+	for (int i = 0; i < count; ++i)
+	{
+		JSON_Object* layer_obj = json_array_get_object(layers_arr, i);
+		struct ldtk_layer_def* def = &world->layer_defs[i];
+
+		def->identifier = json_object_get_string(layer_obj, "identifier");
+		def->type = json_object_get_string(layer_obj, "type");
+		def->uid = (int)json_object_get_number(layer_obj, "uid");
+
+		JSON_Array* values_arr = json_object_get_array(layer_obj, "intGridValues");
+		int value_count = (int)json_array_get_count(values_arr);
+		if (value_count > 0)
+		{
+			def->int_grid_value_count = value_count;
+			def->int_grid_values = calloc(value_count, sizeof(struct ldtk_int_grid_value));
+			if (!def->int_grid_values) return -1;
+
+			for (int v = 0; v < value_count; ++v)
+			{
+				JSON_Object* value_obj = json_array_get_object(values_arr, v);
+				struct ldtk_int_grid_value* value = &def->int_grid_values[v];
+
+				value->value = (int)json_object_get_number(value_obj, "value");
+				value->identifier = json_object_get_string(value_obj, "identifier");
+
+				// colors are stored as "#RRGGBB"
+				const char* color = json_object_get_string(value_obj, "color");
+				if (color && color[0] == '#')
+				{
+					value->color = (unsigned int)strtoul(color + 1, NULL, 16);
+				}
+			}
+		}
+	}
+
+	return 0;
+}
+
 static int _ltdk_parse_tiles(struct ldtk_tile* tiles, JSON_Array* tiles_arr)
 {
 	if (!tiles) return -1;
@@ -119,6 +193,156 @@ static int _ltdk_parse_tiles(struct ldtk_tile* tiles, JSON_Array* tiles_arr)
 	return 0;
 }
 
+static int _ltdk_tile_cell(const struct ldtk_layer_instance* inst, const struct ldtk_tile* tile)
+{
+	if (tile->px_x < 0 || tile->px_y < 0) return -1;
+	int x = tile->px_x / inst->grid_size;
+	int y = tile->px_y / inst->grid_size;
+	if (x >= inst->cWid || y >= inst->cHei) return -1;
+	return x + inst->cWid * y;
+}
+
+// counting sort all tiles of the layer into their cells, keeping autotiles below gridtiles
+static int _ltdk_build_cell_index(struct ldtk_layer_instance* inst)
+{
+	int cell_count = inst->cWid * inst->cHei;
+	int tile_count = inst->autotile_count + inst->gridtile_count;
+	if (tile_count == 0 || cell_count <= 0 || inst->grid_size <= 0) return 0;
+
+	inst->cell_tile_offsets = calloc(cell_count + 1, sizeof(int));
+	inst->cell_tiles = calloc(tile_count, sizeof(struct ldtk_tile*));
+	if (!inst->cell_tile_offsets || !inst->cell_tiles) return -1;
+
+	struct ldtk_tile* lists[2] = { inst->autotiles, inst->gridtiles };
+	int list_counts[2] = { inst->autotile_count, inst->gridtile_count };
+
+	// histogram, stored one slot ahead so the prefix sum yields start offsets
+	for (int l = 0; l < 2; ++l)
+	{
+		for (int i = 0; i < list_counts[l]; ++i)
+		{
+			int cell = _ltdk_tile_cell(inst, &lists[l][i]);
+			if (cell >= 0) inst->cell_tile_offsets[cell + 1]++;
+		}
+	}
+
+	for (int i = 0; i < cell_count; ++i)
+	{
+		inst->cell_tile_offsets[i + 1] += inst->cell_tile_offsets[i];
+	}
+
+	// scatter, using a temporary cursor per cell
+	int* cursor = malloc(cell_count * sizeof(int));
+	if (!cursor) return -1;
+	memcpy(cursor, inst->cell_tile_offsets, cell_count * sizeof(int));
+
+	for (int l = 0; l < 2; ++l)
+	{
+		for (int i = 0; i < list_counts[l]; ++i)
+		{
+			int cell = _ltdk_tile_cell(inst, &lists[l][i]);
+			if (cell >= 0) inst->cell_tiles[cursor[cell]++] = &lists[l][i];
+		}
+	}
+
+	free(cursor);
+	return 0;
+}
+
+static void _ltdk_parse_field_value(struct ldtk_field_value* value, const JSON_Value* json)
+{
+	switch (json_value_get_type(json))
+	{
+	case JSONNumber:
+		value->number = json_value_get_number(json);
+		break;
+	case JSONBoolean:
+		value->number = json_value_get_boolean(json) ? 1.0 : 0.0;
+		break;
+	case JSONString:
+		value->string = json_value_get_string(json);
+		break;
+	case JSONObject:
+	{
+		// Point is { cx, cy }, EntityRef is { entityIid, ... }
+		const JSON_Object* obj = json_value_get_object(json);
+		value->cx = (int)json_object_get_number(obj, "cx");
+		value->cy = (int)json_object_get_number(obj, "cy");
+		value->string = json_object_get_string(obj, "entityIid");
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+static int _ltdk_parse_entities(struct ldtk_layer_instance* inst, JSON_Array* entities_arr)
+{
+	inst->entity_count = (int)json_array_get_count(entities_arr);
+	inst->entities = calloc(inst->entity_count, sizeof(struct ldtk_entity));
+	if (!inst->entities) return -1;
+
+	for (int i = 0; i < inst->entity_count; ++i)
+	{
+		JSON_Object* entity_obj = json_array_get_object(entities_arr, i);
+		struct ldtk_entity* entity = &inst->entities[i];
+
+		entity->identifier = json_object_get_string(entity_obj, "__identifier");
+		entity->iid = json_object_get_string(entity_obj, "iid");
+		entity->def_uid = (int)json_object_get_number(entity_obj, "defUid");
+		entity->width = (int)json_object_get_number(entity_obj, "width");
+		entity->height = (int)json_object_get_number(entity_obj, "height");
+
+		JSON_Array* px_arr = json_object_get_array(entity_obj, "px");
+		entity->px_x = (int)json_array_get_number(px_arr, 0);
+		entity->px_y = (int)json_array_get_number(px_arr, 1);
+		JSON_Array* grid_arr = json_object_get_array(entity_obj, "__grid");
+		entity->grid_x = (int)json_array_get_number(grid_arr, 0);
+		entity->grid_y = (int)json_array_get_number(grid_arr, 1);
+		JSON_Array* pivot_arr = json_object_get_array(entity_obj, "__pivot");
+		entity->pivot_x = (float)json_array_get_number(pivot_arr, 0);
+		entity->pivot_y = (float)json_array_get_number(pivot_arr, 1);
+
+		const char* color = json_object_get_string(entity_obj, "__smartColor");
+		if (color && color[0] == '#')
+		{
+			entity->color = (unsigned int)strtoul(color + 1, NULL, 16);
+		}
+
+		JSON_Array* fields_arr = json_object_get_array(entity_obj, "fieldInstances");
+		entity->field_count = (int)json_array_get_count(fields_arr);
+		if (entity->field_count == 0) continue;
+		entity->fields = calloc(entity->field_count, sizeof(struct ldtk_field));
+		if (!entity->fields) return -1;
+
+		for (int f = 0; f < entity->field_count; ++f)
+		{
+			JSON_Object* field_obj = json_array_get_object(fields_arr, f);
+			struct ldtk_field* field = &entity->fields[f];
+			field->identifier = json_object_get_string(field_obj, "__identifier");
+			field->type = json_object_get_string(field_obj, "__type");
+
+			// arrays and single values are both stored as a list of values
+			const JSON_Value* value = json_object_get_value(field_obj, "__value");
+			const JSON_Array* values_arr = json_value_get_array(value);
+			if (values_arr) field->value_count = (int)json_array_get_count(values_arr);
+			else if (value && json_value_get_type(value) != JSONNull) field->value_count = 1;
+			if (field->value_count == 0) continue;
+
+			field->values = calloc(field->value_count, sizeof(struct ldtk_field_value));
+			if (!field->values) return -1;
+			for (int v = 0; v < field->value_count; ++v)
+			{
+				// packed integer arrays are read as numbers rather than unpacked into values
+				if (json_array_get_number_array_type(values_arr) != JSONNumberArrayNone) field->values[v].number = json_array_get_number(values_arr, v);
+				else _ltdk_parse_field_value(&field->values[v], values_arr ? json_array_get_value(values_arr, v) : value);
+			}
+		}
+	}
+
+	return 0;
+}
+
 static int _ltdk_parse_layer_instances(struct ldtk_world* world, struct ldtk_level* level, JSON_Array* instances_arr)
 {
 	if (instances_arr)
@@ -156,6 +380,16 @@ static int _ltdk_parse_layer_instances(struct ldtk_world* world, struct ldtk_lev
 				}
 			}
 
+			// fixup layer def ptr
+			for (int i = 0; i < world->layer_def_count; ++i)
+			{
+				if (world->layer_defs[i].uid == inst->layer_def_uid)
+				{
+					inst->layer_def = &world->layer_defs[i];
+					break;
+				}
+			}
+
 			// GridTiles
 			JSON_Array* grid_tiles_arr = json_object_get_array(inst_obj, "gridTiles");
 			if (grid_tiles_arr && json_array_get_count(grid_tiles_arr) > 0)
@@ -187,12 +421,18 @@ static int _ltdk_parse_layer_instances(struct ldtk_world* world, struct ldtk_lev
 				inst->int_grid = calloc(intgrid_cell_count, sizeof(int));
 				if (!inst->int_grid) return -1;
 
-				for (int cell_i = 0; cell_i < intgrid_cell_count; ++cell_i)
-				{
-					inst->int_grid[cell_i] = (int)json_array_get_number(intgrid_arr, cell_i);
-				}
+				// packed by the parser, usually as bytes
+				json_array_get_ints(intgrid_arr, 0, inst->int_grid, intgrid_cell_count);
 			}
 
+			// entities
+			JSON_Array* entities_arr = json_object_get_array(inst_obj, "entityInstances");
+			if (entities_arr && json_array_get_count(entities_arr) > 0)
+			{
+				if (_ltdk_parse_entities(inst, entities_arr) < 0) return -1;
+			}
+
+			if (_ltdk_build_cell_index(inst) < 0) return -1;
 		}
 	}
 	return 0;
@@ -225,15 +465,20 @@ static int _ltdk_parse_levels(struct ldtk_world* world, JSON_Array* levels_array
 	return 0;
 }
 
-static struct ldtk_world* _ltdk_parse_world(JSON_Value* root)
+static struct ldtk_world* _ltdk_parse_world(JSON_Value* root, JSON_Arena* arena)
 {
 	struct ldtk_world* world = NULL;
 	if (root)
 	{
 		world = calloc(1, sizeof(struct ldtk_world));
-		if (!world) goto load_world_err;
+		if (!world)
+		{
+			json_arena_free(arena);
+			return NULL;
+		}
 
 		world->json_root = root;
+		world->json_arena = arena;
 
 		JSON_Object* defs_obj = json_object_get_object(json_object(root), "defs");
 		if (!defs_obj) goto load_world_err;
@@ -241,6 +486,9 @@ static struct ldtk_world* _ltdk_parse_world(JSON_Value* root)
 		// load tilesets data
 		if (_ltdk_parse_tilesets(world, json_object_get_array(defs_obj, "tilesets")) < 0) goto load_world_err;
 
+		// load layer definitions
+		if (_ltdk_parse_layer_defs(world, json_object_get_array(defs_obj, "layers")) < 0) goto load_world_err;
+
 		JSON_Array* levels_array = json_object_get_array(json_object(root), "levels");
 		if (!levels_array) goto load_world_err;
 
@@ -262,14 +510,73 @@ load_world_err:
 
 // External functions
 
+// read a whole file as zero terminated text
+static char* _ltdk_read_text(const char* filename, size_t* length)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file) return NULL;
+
+	char* text = NULL;
+	long size = (fseek(file, 0, SEEK_END) == 0) ? ftell(file) : -1;
+	if (size >= 0 && fseek(file, 0, SEEK_SET) == 0)
+	{
+		text = malloc((size_t)size + 1);
+		if (text && fread(text, 1, (size_t)size, file) != (size_t)size)
+		{
+			free(text);
+			text = NULL;
+		}
+	}
+	fclose(file);
+
+	if (text)
+	{
+		text[size] = 0;
+		*length = (size_t)size;
+	}
+	return text;
+}
+
+static ldtk_load_text_callback _ltdk_load_text = NULL;
+static ldtk_unload_text_callback _ltdk_unload_text = NULL;
+
+
+void ldtk_set_file_callbacks(ldtk_load_text_callback load, ldtk_unload_text_callback unload)
+{
+	_ltdk_load_text = load;
+	_ltdk_unload_text = unload;
+}
+
+
+// The json is parsed into an arena, blocks the size of the file, and freed with it in one go
 struct ldtk_world* ldtk_load_world(const char* filename)
 {
-	JSON_Value* json_root = json_parse_file(filename);
-	if (json_root)
+	const char* text = _ltdk_load_text ? _ltdk_load_text(filename) : NULL;
+	if (text)
 	{
-		struct ldtk_world* world = _ltdk_parse_world(json_root);
+		// parson copies what it keeps, the text can go straight away
+		struct ldtk_world* world = ldtk_parse_world(text, strlen(text));
+		if (_ltdk_unload_text) _ltdk_unload_text(text);
 		return world;
 	}
+
+	// loose files are read rather than mapped, the editor may save over them while they are
+	// parsed and a mapping would fault or lose its terminator if the file shrinks or grows
+	size_t length = 0;
+	char* loaded = _ltdk_read_text(filename, &length);
+	if (!loaded) return NULL;
+	struct ldtk_world* world = ldtk_parse_world(loaded, length);
+	free(loaded);
+	return world;
+}
+
+
+struct ldtk_world* ldtk_parse_world(const char* text, size_t length)
+{
+	JSON_Arena* json_arena = json_arena_create(length);
+	JSON_Value* json_root = json_parse_string_in_arena(text, json_arena);
+	if (json_root) return _ltdk_parse_world(json_root, json_arena);
+	json_arena_free(json_arena);
 	return NULL;
 }
 
@@ -297,6 +604,23 @@ struct ldtk_tileset* ldtk_get_tileset(struct ldtk_world* world, int index)
 }
 
 
+int ldtk_get_layer_def_count(struct ldtk_world* world)
+{
+	if (world) return world->layer_def_count;
+	return 0;
+}
+
+
+struct ldtk_layer_def* ldtk_get_layer_def(struct ldtk_world* world, int index)
+{
+	if (world && world->layer_def_count > index)
+	{
+		return &world->layer_defs[index];
+	}
+	return NULL;
+}
+
+
 int ldtk_get_level_count(struct ldtk_world* world)
 {
 	if (world) return world->level_count;
@@ -313,3 +637,42 @@ struct ldtk_level* ldtk_get_level(struct ldtk_world* world, int index)
 	return NULL;
 }
 
+
+ldtk_tile_span ldtk_layer_tiles_at(const struct ldtk_layer_instance* inst, int x, int y)
+{
+	ldtk_tile_span span = { 0 };
+	if (inst && inst->cell_tile_offsets && x >= 0 && y >= 0 && x < inst->cWid && y < inst->cHei)
+	{
+		int cell = x + inst->cWid * y;
+		int begin = inst->cell_tile_offsets[cell];
+		span.tiles = &inst->cell_tiles[begin];
+		span.count = inst->cell_tile_offsets[cell + 1] - begin;
+	}
+	return span;
+}
+
+
+const struct ldtk_int_grid_value* ldtk_find_int_grid_value(const struct ldtk_layer_def* def, int value)
+{
+	if (def)
+	{
+		for (int i = 0; i < def->int_grid_value_count; ++i)
+		{
+			if (def->int_grid_values[i].value == value) return &def->int_grid_values[i];
+		}
+	}
+	return NULL;
+}
+
+
+const struct ldtk_field* ldtk_find_field(const struct ldtk_entity* entity, const char* identifier)
+{
+	for (int i = 0; i < entity->field_count; ++i)
+	{
+		if (entity->fields[i].identifier && strcmp(entity->fields[i].identifier, identifier) == 0)
+		{
+			return &entity->fields[i];
+		}
+	}
+	return NULL;
+}
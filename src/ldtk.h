@@ -1,5 +1,7 @@
 // A simple C API for working with ldtk files
 
+#include <stddef.h>
+
 // External types
 
 struct ldtk_world;
@@ -15,6 +17,7 @@ typedef struct ldtk_level
 	int pxHei;
 	int layer_instances_count;
 	struct ldtk_layer_instance* layer_instances;
+	void* userdata;
 } ldtk_level;
 
 typedef struct ldtk_tileset
@@ -30,6 +33,23 @@ typedef struct ldtk_tileset
 	void* userdata;
 } ldtk_tileset;
 
+typedef struct ldtk_int_grid_value
+{
+	int value;
+	const char* identifier;
+	// 0xRRGGBB
+	unsigned int color;
+} ldtk_int_grid_value;
+
+typedef struct ldtk_layer_def
+{
+	const char* identifier;
+	const char* type;
+	int uid;
+	int int_grid_value_count;
+	struct ldtk_int_grid_value* int_grid_values;
+} ldtk_layer_def;
+
 typedef struct ldtk_layer_instance
 {
 	const char* identifier;
@@ -51,7 +71,19 @@ typedef struct ldtk_layer_instance
 	// there are (cWid * cHei) cells if type is intgrid
 	int* int_grid;
 
+	// dense cell index over autotiles and gridtiles, built at load time.
+	// tiles in cell i are cell_tiles[cell_tile_offsets[i]] .. cell_tiles[cell_tile_offsets[i + 1] - 1]
+	// in draw order, so there are (cWid * cHei + 1) offsets. NULL if the layer has no tiles.
+	int* cell_tile_offsets;
+	struct ldtk_tile** cell_tiles;
+
+	// entities placed in the layer if type is entities
+	int entity_count;
+	struct ldtk_entity* entities;
+
 	struct ldtk_tileset* tileset;
+	struct ldtk_layer_def* layer_def;
+	void* userdata;
 } ldtk_layer_instance;
 
 typedef struct ldtk_tile
@@ -62,8 +94,56 @@ typedef struct ldtk_tile
 	int src_y;
 	int f;
 	int t;
+	int occluded;	// not parsed, set by the game for tiles that can be skipped when drawing
 } ldtk_tile;
 
+// a single value of an entity field, which members are set depends on the field type:
+// Int, Float and Bool set number, String, Multilines, FilePath, Color, enums and EntityRef
+// (the referenced iid) set string, Point sets cx/cy
+typedef struct ldtk_field_value
+{
+	double number;
+	const char* string;
+	int cx;
+	int cy;
+} ldtk_field_value;
+
+typedef struct ldtk_field
+{
+	const char* identifier;
+	const char* type;
+	// elements of an Array<...> field, otherwise 1, or 0 if the value is null
+	int value_count;
+	struct ldtk_field_value* values;
+} ldtk_field;
+
+typedef struct ldtk_entity
+{
+	const char* identifier;
+	const char* iid;
+	int def_uid;
+	// pivot position in pixels relative to the level, and the cell it is in
+	int px_x;
+	int px_y;
+	int grid_x;
+	int grid_y;
+	float pivot_x;
+	float pivot_y;
+	int width;
+	int height;
+	// 0xRRGGBB
+	unsigned int color;
+	int field_count;
+	struct ldtk_field* fields;
+} ldtk_entity;
+
+// the tiles stacked in a single layer cell, bottom to top
+typedef struct ldtk_tile_span
+{
+	struct ldtk_tile** tiles;
+	int count;
+} ldtk_tile_span;
+
 
 #if defined(__cplusplus)
 extern "C" {
@@ -73,12 +153,35 @@ extern "C" {
 struct ldtk_world* ldtk_load_world(const char* filename);
 void ldtk_destroy_world(struct ldtk_world* world);
 
+// Parse a world from zero terminated json text already in memory, length is that of the text.
+// Nothing points into the text afterwards.
+struct ldtk_world* ldtk_parse_world(const char* text, size_t length);
+
+// Where ldtk_load_world reads files from, e.g. a resource pack. load returns the whole file
+// as zero terminated text, or NULL to read the file from disk; unload gets that text back once
+// it is parsed. Passing NULL callbacks restores reading every file from disk.
+typedef const char* (*ldtk_load_text_callback)(const char* filename);
+typedef void (*ldtk_unload_text_callback)(const char* text);
+void ldtk_set_file_callbacks(ldtk_load_text_callback load, ldtk_unload_text_callback unload);
+
 int ldtk_get_tileset_count(struct ldtk_world* world);
 struct ldtk_tileset* ldtk_get_tileset(struct ldtk_world* world, int index);
 
+int ldtk_get_layer_def_count(struct ldtk_world* world);
+struct ldtk_layer_def* ldtk_get_layer_def(struct ldtk_world* world, int index);
+
 int ldtk_get_level_count(struct ldtk_world* world);
 struct ldtk_level* ldtk_get_level(struct ldtk_world* world, int index);
 
+// get the tiles covering cell (x, y) of a layer instance in O(1), empty span if out of range
+ldtk_tile_span ldtk_layer_tiles_at(const struct ldtk_layer_instance* inst, int x, int y);
+
+// find the definition of an int grid value, NULL if the layer doesn't define it
+const struct ldtk_int_grid_value* ldtk_find_int_grid_value(const struct ldtk_layer_def* def, int value);
+
+// find an entity field by identifier, NULL if the entity doesn't have it
+const struct ldtk_field* ldtk_find_field(const struct ldtk_entity* entity, const char* identifier);
+
 
 
 #if defined(__cplusplus)
@@ -0,0 +1,755 @@
+#include "level_render.h"
+#include "ldtk.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//////////////////////////////////////////////////////////////////////////
+// CPU baking
+
+void BlitTileImage(Image* dst, int dstX, int dstY, const Image* src, int srcX, int srcY, int size, int flags)
+{
+	// reject tiles sampling outside of the source sheet
+	if (srcX < 0 || srcY < 0 || srcX + size > src->width || srcY + size > src->height) return;
+
+	unsigned char* dstPixels = dst->data;
+	const unsigned char* srcPixels = src->data;
+
+	for (int y = 0; y < size; ++y)
+	{
+		int dy = dstY + y;
+		if (dy < 0 || dy >= dst->height) continue;
+
+		int sy = srcY + ((flags & 2) ? (size - 1 - y) : y);
+
+		for (int x = 0; x < size; ++x)
+		{
+			int dx = dstX + x;
+			if (dx < 0 || dx >= dst->width) continue;
+
+			int sx = srcX + ((flags & 1) ? (size - 1 - x) : x);
+
+			const unsigned char* s = &srcPixels[(sy * src->width + sx) * 4];
+			unsigned char* d = &dstPixels[(dy * dst->width + dx) * 4];
+
+			int sa = s[3];
+			if (sa == 0) continue;
+			if (sa == 255)
+			{
+				memcpy(d, s, 4);
+				continue;
+			}
+
+			// non premultiplied "over" operator
+			int da = d[3] * (255 - sa) / 255;
+			int oa = sa + da;
+			for (int c = 0; c < 3; ++c)
+			{
+				d[c] = (unsigned char)((s[c] * sa + d[c] * da) / oa);
+			}
+			d[3] = (unsigned char)oa;
+		}
+	}
+}
+
+
+// position of a tile in the layer's draw order, autotiles are drawn before gridtiles
+static int TileDrawOrder(const struct ldtk_layer_instance* inst, const ldtk_tile* tile)
+{
+	if (tile >= inst->autotiles && tile < inst->autotiles + inst->autotile_count)
+	{
+		return (int)(tile - inst->autotiles);
+	}
+	return inst->autotile_count + (int)(tile - inst->gridtiles);
+}
+
+static const ldtk_tile* GetTileAtDrawOrder(const struct ldtk_layer_instance* inst, int order)
+{
+	return (order < inst->autotile_count) ? &inst->autotiles[order] : &inst->gridtiles[order - inst->autotile_count];
+}
+
+static int CompareDrawOrder(const void* a, const void* b)
+{
+	return *(const int*)a - *(const int*)b;
+}
+
+// Gather the tiles of the cells in [x0, x1) x [y0, y1) in the layer's draw order, so tiles
+// spilling over into neighbouring cells overlap the same way as drawing the whole layer.
+// Returns the number of tiles, *orders is allocated and must be freed, -1 if out of memory.
+static int GatherTileDrawOrders(const struct ldtk_layer_instance* inst, int x0, int y0, int x1, int y1, int** orders)
+{
+	*orders = NULL;
+
+	int count = 0;
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = x0; x < x1; ++x)
+		{
+			count += ldtk_layer_tiles_at(inst, x, y).count;
+		}
+	}
+	if (count == 0) return 0;
+
+	*orders = malloc(count * sizeof(int));
+	if (!*orders) return -1;
+
+	int n = 0;
+	for (int y = y0; y < y1; ++y)
+	{
+		for (int x = x0; x < x1; ++x)
+		{
+			ldtk_tile_span span = ldtk_layer_tiles_at(inst, x, y);
+			for (int i = 0; i < span.count; ++i)
+			{
+				(*orders)[n++] = TileDrawOrder(inst, span.tiles[i]);
+			}
+		}
+	}
+
+	qsort(*orders, n, sizeof(int), CompareDrawOrder);
+	return n;
+}
+
+
+int BakeLayerChunkImage(const struct ldtk_layer_instance* inst, int chunkX, int chunkY, Image* out)
+{
+	memset(out, 0, sizeof(*out));
+	if (!inst->tileset || !inst->tileset->userdata) return 0;
+
+	const TileSheet* sheet = inst->tileset->userdata;
+
+	int cellX0 = chunkX * LEVEL_CHUNK_CELLS;
+	int cellY0 = chunkY * LEVEL_CHUNK_CELLS;
+	int cellX1 = cellX0 + LEVEL_CHUNK_CELLS;
+	int cellY1 = cellY0 + LEVEL_CHUNK_CELLS;
+	if (cellX1 > inst->cWid) cellX1 = inst->cWid;
+	if (cellY1 > inst->cHei) cellY1 = inst->cHei;
+
+	// tiles placed with a pixel offset can spill over from neighbouring cells, so gather
+	// a one cell margin around the chunk and let the blit clip them
+	int* orders;
+	int n = GatherTileDrawOrders(inst, cellX0 - 1, cellY0 - 1, cellX1 + 1, cellY1 + 1, &orders);
+	if (n <= 0) return 0;
+
+	int width = (cellX1 - cellX0) * inst->grid_size;
+	int height = (cellY1 - cellY0) * inst->grid_size;
+	int originX = cellX0 * inst->grid_size;
+	int originY = cellY0 * inst->grid_size;
+
+	out->data = calloc((size_t)width * height, 4);
+	if (!out->data)
+	{
+		free(orders);
+		return 0;
+	}
+	out->width = width;
+	out->height = height;
+	out->mipmaps = 1;
+	out->format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+	int drawn = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		const ldtk_tile* tile = GetTileAtDrawOrder(inst, orders[i]);
+		if (tile->occluded) continue;
+
+		int x = tile->px_x - originX;
+		int y = tile->px_y - originY;
+		if (x >= width || y >= height || x + inst->grid_size <= 0 || y + inst->grid_size <= 0) continue;
+
+		BlitTileImage(out, x, y, &sheet->image, tile->src_x, tile->src_y, inst->grid_size, tile->f);
+		drawn++;
+	}
+
+	free(orders);
+
+	if (drawn == 0)
+	{
+		free(out->data);
+		memset(out, 0, sizeof(*out));
+	}
+	return drawn;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Chunk management
+
+LayerChunks* CreateLayerChunks(const struct ldtk_layer_instance* inst)
+{
+	if (!inst->cell_tile_offsets) return NULL;
+
+	LayerChunks* chunks = calloc(1, sizeof(LayerChunks));
+	if (!chunks) return NULL;
+
+	chunks->chunksX = (inst->cWid + LEVEL_CHUNK_CELLS - 1) / LEVEL_CHUNK_CELLS;
+	chunks->chunksY = (inst->cHei + LEVEL_CHUNK_CELLS - 1) / LEVEL_CHUNK_CELLS;
+	chunks->chunks = calloc((size_t)chunks->chunksX * chunks->chunksY, sizeof(LayerChunk));
+	if (!chunks->chunks)
+	{
+		free(chunks);
+		return NULL;
+	}
+
+	for (int i = 0; i < chunks->chunksX * chunks->chunksY; ++i)
+	{
+		chunks->chunks[i].dirty = true;
+	}
+
+	return chunks;
+}
+
+
+void DestroyLayerChunks(LayerChunks* chunks)
+{
+	if (!chunks) return;
+
+	for (int i = 0; i < chunks->chunksX * chunks->chunksY; ++i)
+	{
+		LayerChunk* chunk = &chunks->chunks[i];
+		if (chunk->texture.id != 0) UnloadTexture(chunk->texture);
+		free(chunk->image.data);
+	}
+	free(chunks->chunks);
+	free(chunks);
+}
+
+
+void InvalidateLayerChunk(struct ldtk_layer_instance* inst, int x, int y)
+{
+	LayerChunks* chunks = inst->userdata;
+	if (!chunks) return;
+
+	// chunks bake a one cell margin, so a cell on a chunk border affects its neighbours too
+	for (int cy = y - 1; cy <= y + 1; ++cy)
+	{
+		for (int cx = x - 1; cx <= x + 1; ++cx)
+		{
+			if (cx < 0 || cy < 0) continue;
+
+			int chunkX = cx / LEVEL_CHUNK_CELLS;
+			int chunkY = cy / LEVEL_CHUNK_CELLS;
+			if (chunkX >= chunks->chunksX || chunkY >= chunks->chunksY) continue;
+
+			chunks->chunks[chunkX + chunkY * chunks->chunksX].dirty = true;
+		}
+	}
+}
+
+
+// CPU half of updating a chunk, the texture it had stays until the new image is uploaded
+static void BakeLayerChunk(const struct ldtk_layer_instance* inst, LayerChunk* chunk, int chunkX, int chunkY)
+{
+	free(chunk->image.data);
+	chunk->tileCount = BakeLayerChunkImage(inst, chunkX, chunkY, &chunk->image);
+	chunk->dirty = false;
+}
+
+
+static void UploadLayerChunk(LayerChunk* chunk)
+{
+	if (chunk->texture.id != 0)
+	{
+		UnloadTexture(chunk->texture);
+		chunk->texture = (Texture) { 0 };
+	}
+
+	if (chunk->image.data)
+	{
+		chunk->texture = LoadTextureFromImage(chunk->image);
+
+		// the chunk can always be re-baked from the tileset, so don't keep the pixels around
+		free(chunk->image.data);
+		chunk->image = (Image) { 0 };
+	}
+}
+
+
+int BakeLayerChunks(struct ldtk_layer_instance* inst)
+{
+	LayerChunks* chunks = inst->userdata;
+	if (!chunks) return 0;
+
+	int baked = 0;
+	for (int cy = 0; cy < chunks->chunksY; ++cy)
+	{
+		for (int cx = 0; cx < chunks->chunksX; ++cx)
+		{
+			LayerChunk* chunk = &chunks->chunks[cx + cy * chunks->chunksX];
+			if (!chunk->dirty) continue;
+			BakeLayerChunk(inst, chunk, cx, cy);
+			baked++;
+		}
+	}
+	return baked;
+}
+
+
+bool UploadLayerChunks(struct ldtk_layer_instance* inst, size_t* budget)
+{
+	LayerChunks* chunks = inst->userdata;
+	if (!chunks) return true;
+
+	for (int i = 0; i < chunks->chunksX * chunks->chunksY; ++i)
+	{
+		LayerChunk* chunk = &chunks->chunks[i];
+		if (chunk->dirty || !chunk->image.data) continue;
+		if (budget && *budget == 0) return false;
+
+		size_t size = (size_t)chunk->image.width * chunk->image.height * 4;
+		UploadLayerChunk(chunk);
+		if (budget) *budget = (size < *budget) ? *budget - size : 0;
+	}
+	return true;
+}
+
+
+bool GetLayerCellRange(const struct ldtk_layer_instance* inst, Vector2 offset, Rectangle view, int margin, int* x0, int* y0, int* x1, int* y1)
+{
+	float cellSize = (float)inst->grid_size;
+	if (cellSize <= 0.0f) return false;
+
+	*x0 = (int)floorf((view.x - offset.x) / cellSize) - margin;
+	*y0 = (int)floorf((view.y - offset.y) / cellSize) - margin;
+	*x1 = (int)ceilf((view.x + view.width - offset.x) / cellSize) + margin;
+	*y1 = (int)ceilf((view.y + view.height - offset.y) / cellSize) + margin;
+
+	if (*x0 < 0) *x0 = 0;
+	if (*y0 < 0) *y0 = 0;
+	if (*x1 > inst->cWid) *x1 = inst->cWid;
+	if (*y1 > inst->cHei) *y1 = inst->cHei;
+
+	return (*x0 < *x1) && (*y0 < *y1);
+}
+
+
+int DrawLayerChunks(DrawList* list, int layer, struct ldtk_layer_instance* inst, Vector2 offset, Rectangle view)
+{
+	LayerChunks* chunks = inst->userdata;
+	if (!chunks) return 0;
+
+	int x0, y0, x1, y1;
+	if (!GetLayerCellRange(inst, offset, view, 0, &x0, &y0, &x1, &y1)) return 0;
+
+	// convert the cell range to a chunk range
+	x0 /= LEVEL_CHUNK_CELLS;
+	y0 /= LEVEL_CHUNK_CELLS;
+	x1 = (x1 + LEVEL_CHUNK_CELLS - 1) / LEVEL_CHUNK_CELLS;
+	y1 = (y1 + LEVEL_CHUNK_CELLS - 1) / LEVEL_CHUNK_CELLS;
+
+	float chunkPixels = (float)(LEVEL_CHUNK_CELLS * inst->grid_size);
+	int drawn = 0;
+
+	for (int cy = y0; cy < y1; ++cy)
+	{
+		for (int cx = x0; cx < x1; ++cx)
+		{
+			LayerChunk* chunk = &chunks->chunks[cx + cy * chunks->chunksX];
+			if (chunk->dirty)
+			{
+				BakeLayerChunk(inst, chunk, cx, cy);
+				UploadLayerChunk(chunk);
+			}
+			else if (chunk->image.data) UploadLayerChunk(chunk);
+			if (chunk->texture.id == 0) continue;
+
+			Rectangle src = { 0.0f, 0.0f, (float)chunk->texture.width, (float)chunk->texture.height };
+			Rectangle dst = { offset.x + cx * chunkPixels, offset.y + cy * chunkPixels, src.width, src.height };
+			DrawListTexture(list, layer, chunk->texture, src, dst, WHITE);
+			drawn++;
+		}
+	}
+
+	return drawn;
+}
+
+
+static void DrawTile(DrawList* list, int layer, const struct ldtk_layer_instance* inst, const ldtk_tile* tile, Vector2 offset)
+{
+	Rectangle src = { (float)tile->src_x, (float)tile->src_y, (float)inst->grid_size, (float)inst->grid_size };
+	Rectangle dst = { (float)tile->px_x + offset.x, (float)tile->px_y + offset.y, (float)inst->grid_size, (float)inst->grid_size };
+
+	if (tile->f & 1)
+	{
+		// flip horizontally
+		src.width *= -1;
+	}
+	if (tile->f & 2)
+	{
+		// flip vertically
+		src.height *= -1;
+	}
+
+	const TileSheet* sheet = inst->tileset->userdata;
+	DrawListTexture(list, layer, sheet->texture, src, dst, WHITE);
+}
+
+
+int DrawLayerTiles(DrawList* list, int layer, const struct ldtk_layer_instance* inst, Vector2 offset, Rectangle view)
+{
+	if (!inst->tileset || !inst->tileset->userdata) return 0;
+
+	// include a one cell margin for tiles placed with a pixel offset
+	int x0, y0, x1, y1;
+	if (!GetLayerCellRange(inst, offset, view, 1, &x0, &y0, &x1, &y1)) return 0;
+
+	// same order as BakeLayerChunkImage, so overlapping tiles look the same baked or not
+	int* orders;
+	int n = GatherTileDrawOrders(inst, x0, y0, x1, y1, &orders);
+	if (n <= 0) return 0;
+
+	int drawn = 0;
+	for (int i = 0; i < n; ++i)
+	{
+		const ldtk_tile* tile = GetTileAtDrawOrder(inst, orders[i]);
+		if (tile->occluded) continue;
+		DrawTile(list, layer, inst, tile, offset);
+		drawn++;
+	}
+
+	free(orders);
+	return drawn;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Occlusion
+
+bool IsTileImageOpaque(const Image* image, int x, int y, int size)
+{
+	if (x < 0 || y < 0 || x + size > image->width || y + size > image->height) return false;
+
+	const unsigned char* pixels = image->data;
+	for (int py = y; py < y + size; ++py)
+	{
+		const unsigned char* row = &pixels[((size_t)py * image->width + x) * 4];
+		for (int px = 0; px < size; ++px)
+		{
+			if (row[px * 4 + 3] != 255) return false;
+		}
+	}
+	return true;
+}
+
+
+// is any tile drawn after the given one fully opaque and covering its whole rect?
+static bool IsTileCovered(const struct ldtk_level* level, bool** opaque, int layerIndex, const ldtk_tile* tile)
+{
+	const ldtk_layer_instance* inst = &level->layer_instances[layerIndex];
+	Rectangle rect = { (float)(inst->px_offset_x + tile->px_x), (float)(inst->px_offset_y + tile->px_y), (float)inst->grid_size, (float)inst->grid_size };
+	int order = TileDrawOrder(inst, tile);
+
+	// layers are stored front to back, walk from the tile's own layer to the front
+	for (int j = layerIndex; j >= 0; --j)
+	{
+		const ldtk_layer_instance* cover = &level->layer_instances[j];
+		if (!opaque[j] || cover->grid_size < inst->grid_size) continue;
+
+		int x0, y0, x1, y1;
+		Vector2 offset = { (float)cover->px_offset_x, (float)cover->px_offset_y };
+		if (!GetLayerCellRange(cover, offset, rect, 1, &x0, &y0, &x1, &y1)) continue;
+
+		for (int y = y0; y < y1; ++y)
+		{
+			for (int x = x0; x < x1; ++x)
+			{
+				ldtk_tile_span span = ldtk_layer_tiles_at(cover, x, y);
+				for (int i = 0; i < span.count; ++i)
+				{
+					const ldtk_tile* other = span.tiles[i];
+					int otherOrder = TileDrawOrder(cover, other);
+					if (!opaque[j][otherOrder]) continue;
+					if (j == layerIndex && otherOrder <= order) continue;
+
+					float ox = (float)(cover->px_offset_x + other->px_x);
+					float oy = (float)(cover->px_offset_y + other->px_y);
+					if (ox <= rect.x && oy <= rect.y && ox + cover->grid_size >= rect.x + rect.width && oy + cover->grid_size >= rect.y + rect.height)
+					{
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
+
+
+int CullCoveredTiles(struct ldtk_level* level)
+{
+	if (level->layer_instances_count <= 0) return 0;
+
+	// opacity of every tile, indexed by layer and draw order
+	bool** opaque = calloc(level->layer_instances_count, sizeof(bool*));
+	if (!opaque) return 0;
+
+	for (int j = 0; j < level->layer_instances_count; ++j)
+	{
+		ldtk_layer_instance* inst = &level->layer_instances[j];
+		int count = inst->autotile_count + inst->gridtile_count;
+
+		for (int k = 0; k < inst->autotile_count; ++k) inst->autotiles[k].occluded = 0;
+		for (int k = 0; k < inst->gridtile_count; ++k) inst->gridtiles[k].occluded = 0;
+
+		if (!inst->tileset || !inst->tileset->userdata || !inst->cell_tile_offsets || count == 0) continue;
+
+		const TileSheet* sheet = inst->tileset->userdata;
+		opaque[j] = malloc(count * sizeof(bool));
+		if (!opaque[j]) continue;
+
+		for (int k = 0; k < inst->autotile_count; ++k)
+		{
+			const ldtk_tile* tile = &inst->autotiles[k];
+			opaque[j][k] = IsTileImageOpaque(&sheet->image, tile->src_x, tile->src_y, inst->grid_size);
+		}
+		for (int k = 0; k < inst->gridtile_count; ++k)
+		{
+			const ldtk_tile* tile = &inst->gridtiles[k];
+			opaque[j][inst->autotile_count + k] = IsTileImageOpaque(&sheet->image, tile->src_x, tile->src_y, inst->grid_size);
+		}
+	}
+
+	int culled = 0;
+	for (int j = 0; j < level->layer_instances_count; ++j)
+	{
+		ldtk_layer_instance* inst = &level->layer_instances[j];
+		if (!opaque[j]) continue;
+
+		for (int k = 0; k < inst->autotile_count; ++k)
+		{
+			inst->autotiles[k].occluded = IsTileCovered(level, opaque, j, &inst->autotiles[k]);
+			culled += inst->autotiles[k].occluded;
+		}
+		for (int k = 0; k < inst->gridtile_count; ++k)
+		{
+			inst->gridtiles[k].occluded = IsTileCovered(level, opaque, j, &inst->gridtiles[k]);
+			culled += inst->gridtiles[k].occluded;
+		}
+	}
+
+	for (int j = 0; j < level->layer_instances_count; ++j) free(opaque[j]);
+	free(opaque);
+	return culled;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Level of detail
+
+Image BakeLevelImage(const struct ldtk_level* level)
+{
+	Image image = { 0 };
+	if (level->pxWid <= 0 || level->pxHei <= 0) return image;
+
+	image.data = calloc((size_t)level->pxWid * level->pxHei, 4);
+	if (!image.data) return image;
+	image.width = level->pxWid;
+	image.height = level->pxHei;
+	image.mipmaps = 1;
+	image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+	for (int j = level->layer_instances_count - 1; j >= 0; --j)
+	{
+		const ldtk_layer_instance* inst = &level->layer_instances[j];
+
+		// IntGrid layers without an auto layer show their value colors, like the editor does
+		if (inst->int_grid && inst->autotile_count == 0)
+		{
+			for (int y = 0; y < inst->cHei; ++y)
+			{
+				for (int x = 0; x < inst->cWid; ++x)
+				{
+					const ldtk_int_grid_value* value = ldtk_find_int_grid_value(inst->layer_def, inst->int_grid[x + y * inst->cWid]);
+					if (!value) continue;
+
+					unsigned char rgba[4] = { (value->color >> 16) & 0xff, (value->color >> 8) & 0xff, value->color & 0xff, 255 };
+					int px = inst->px_offset_x + x * inst->grid_size;
+					int py = inst->px_offset_y + y * inst->grid_size;
+					for (int cy = py; cy < py + inst->grid_size; ++cy)
+					{
+						if (cy < 0 || cy >= image.height) continue;
+						for (int cx = px; cx < px + inst->grid_size; ++cx)
+						{
+							if (cx < 0 || cx >= image.width) continue;
+							memcpy((unsigned char*)image.data + ((size_t)cy * image.width + cx) * 4, rgba, 4);
+						}
+					}
+				}
+			}
+		}
+
+		if (!inst->tileset || !inst->tileset->userdata) continue;
+		const TileSheet* sheet = inst->tileset->userdata;
+
+		for (int k = 0; k < inst->autotile_count; ++k)
+		{
+			const ldtk_tile* tile = &inst->autotiles[k];
+			if (tile->occluded) continue;
+			BlitTileImage(&image, inst->px_offset_x + tile->px_x, inst->px_offset_y + tile->px_y, &sheet->image, tile->src_x, tile->src_y, inst->grid_size, tile->f);
+		}
+		for (int k = 0; k < inst->gridtile_count; ++k)
+		{
+			const ldtk_tile* tile = &inst->gridtiles[k];
+			if (tile->occluded) continue;
+			BlitTileImage(&image, inst->px_offset_x + tile->px_x, inst->px_offset_y + tile->px_y, &sheet->image, tile->src_x, tile->src_y, inst->grid_size, tile->f);
+		}
+	}
+
+	return image;
+}
+
+
+Image DownsampleImage(const Image* image)
+{
+	Image out = { 0 };
+	int width = (image->width + 1) / 2;
+	int height = (image->height + 1) / 2;
+
+	out.data = calloc((size_t)width * height, 4);
+	if (!out.data) return out;
+	out.width = width;
+	out.height = height;
+	out.mipmaps = 1;
+	out.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+	const unsigned char* src = image->data;
+	unsigned char* dst = out.data;
+
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			// alpha weighted average, so transparent texels don't darken the edges
+			unsigned int sum[4] = { 0 };
+			for (int sy = y * 2; sy < y * 2 + 2 && sy < image->height; ++sy)
+			{
+				for (int sx = x * 2; sx < x * 2 + 2 && sx < image->width; ++sx)
+				{
+					const unsigned char* p = &src[((size_t)sy * image->width + sx) * 4];
+					sum[0] += p[0] * p[3];
+					sum[1] += p[1] * p[3];
+					sum[2] += p[2] * p[3];
+					sum[3] += p[3];
+				}
+			}
+
+			unsigned char* d = &dst[((size_t)y * width + x) * 4];
+			if (sum[3] > 0)
+			{
+				d[0] = (unsigned char)(sum[0] / sum[3]);
+				d[1] = (unsigned char)(sum[1] / sum[3]);
+				d[2] = (unsigned char)(sum[2] / sum[3]);
+				d[3] = (unsigned char)(sum[3] / 4);
+			}
+		}
+	}
+
+	return out;
+}
+
+
+LevelLod* BakeLevelLod(const struct ldtk_level* level)
+{
+	// empty levels get no images, but still a LevelLod so they aren't baked again
+	LevelLod* lod = calloc(1, sizeof(LevelLod));
+	if (!lod) return NULL;
+
+	Image full = BakeLevelImage(level);
+	if (!full.data) return lod;
+
+	const Image* prev = &full;
+	for (int i = 0; i < LEVEL_LOD_COUNT; ++i)
+	{
+		lod->images[i] = DownsampleImage(prev);
+		if (!lod->images[i].data) break;
+		prev = &lod->images[i];
+	}
+
+	free(full.data);
+	return lod;
+}
+
+
+bool UploadLevelLod(LevelLod* lod, size_t* budget)
+{
+	if (!lod) return true;
+
+	for (int i = 0; i < LEVEL_LOD_COUNT; ++i)
+	{
+		if (!lod->images[i].data || lod->textures[i].id != 0) continue;
+		if (budget && *budget == 0) return false;
+
+		lod->textures[i] = LoadTextureFromImage(lod->images[i]);
+		SetTextureFilter(lod->textures[i], TEXTURE_FILTER_BILINEAR);
+
+		size_t size = (size_t)lod->images[i].width * lod->images[i].height * 4;
+		if (budget) *budget = (size < *budget) ? *budget - size : 0;
+	}
+	return true;
+}
+
+
+LevelLod* CreateLevelLod(const struct ldtk_level* level)
+{
+	LevelLod* lod = BakeLevelLod(level);
+	UploadLevelLod(lod, NULL);
+	return lod;
+}
+
+
+void DestroyLevelLod(LevelLod* lod)
+{
+	if (!lod) return;
+
+	for (int i = 0; i < LEVEL_LOD_COUNT; ++i)
+	{
+		if (lod->textures[i].id != 0) UnloadTexture(lod->textures[i]);
+		free(lod->images[i].data);
+	}
+	free(lod);
+}
+
+
+int GetLevelLodIndex(float zoom)
+{
+	// image i has 1/(2^(i+1)) texels per world pixel, use the smallest one still >= zoom
+	int index = -1;
+	for (float scale = 1.0f; scale * 0.5f >= zoom && index + 1 < LEVEL_LOD_COUNT; scale *= 0.5f)
+	{
+		index++;
+	}
+	return (index < 0) ? 0 : index;
+}
+
+
+int DrawLevelLod(DrawList* list, int layer, struct ldtk_level* level, float zoom)
+{
+	if (!level->userdata)
+	{
+		level->userdata = CreateLevelLod(level);
+		if (!level->userdata) return 0;
+	}
+
+	LevelLod* lod = level->userdata;
+	UploadLevelLod(lod, NULL);
+	int index = GetLevelLodIndex(zoom);
+	while (index > 0 && lod->textures[index].id == 0) index--;
+	if (lod->textures[index].id == 0) return 0;
+
+	Texture texture = lod->textures[index];
+	Rectangle src = { 0.0f, 0.0f, (float)texture.width, (float)texture.height };
+	Rectangle dst = { (float)level->worldX, (float)level->worldY, (float)level->pxWid, (float)level->pxHei };
+
+	// the last texel column/row may only be partially covered by the level after rounding up
+	float scale = (float)(1 << (index + 1));
+	src.width = level->pxWid / scale;
+	src.height = level->pxHei / scale;
+
+	DrawListTexture(list, layer, texture, src, dst, WHITE);
+	return 1;
+}
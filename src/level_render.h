@@ -0,0 +1,140 @@
+// Level rendering helpers for ldtk worlds.
+//
+// Static tile layers are baked into fixed size chunk images on the CPU and uploaded as
+// textures, so a frame draws one quad per chunk instead of one quad per tile. Baking only
+// touches CPU-side Images, so it can run without a window or GPU.
+//
+// Tiles hidden under opaque tiles of the layers above them can be flagged once at load time
+// and are then left out of drawing and baking.
+//
+// For zoomed out views whole levels are also baked into a chain of downsampled images,
+// drawn as a single quad per level and reused for the minimap.
+
+#ifndef LEVEL_RENDER_H
+#define LEVEL_RENDER_H
+
+#include "raylib.h"
+#include "draw_list.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+struct ldtk_level;
+struct ldtk_layer_instance;
+
+// chunk edge length in layer cells
+#define LEVEL_CHUNK_CELLS 16
+
+// CPU copy and GPU texture of a tileset image, stored in ldtk_tileset userdata
+typedef struct TileSheet
+{
+	Image image;		// always PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
+	Texture texture;
+} TileSheet;
+
+typedef struct LayerChunk
+{
+	Image image;		// only valid between baking and upload
+	Texture texture;
+	int tileCount;		// tiles baked into the chunk, empty chunks have no texture
+	bool dirty;			// tiles changed (or never baked), re-bake before next draw
+} LayerChunk;
+
+// number of downsampled level images, 1/2 down to 1/32 scale
+#define LEVEL_LOD_COUNT 5
+
+// use level images instead of tiles when the camera zoom is at or below this
+#define LEVEL_LOD_MAX_ZOOM 0.5f
+
+// downsampled images of a whole level, stored in ldtk_level userdata
+typedef struct LevelLod
+{
+	Image images[LEVEL_LOD_COUNT];		// CPU copies, images[i] is 1/(2^(i+1)) scale
+	Texture textures[LEVEL_LOD_COUNT];
+} LevelLod;
+
+// baked chunks of a single layer instance, stored in ldtk_layer_instance userdata
+typedef struct LayerChunks
+{
+	int chunksX;
+	int chunksY;
+	LayerChunk* chunks;
+} LayerChunks;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Bake the tiles of a chunk into a new RGBA8 image. Returns the number of tiles drawn,
+// out is left empty (data == NULL) when the chunk holds no tiles.
+int BakeLayerChunkImage(const struct ldtk_layer_instance* inst, int chunkX, int chunkY, Image* out);
+
+// Copy a size x size tile from one RGBA8 image into another with alpha blending.
+// flags uses the ldtk tile flip bits (1 = flip X, 2 = flip Y).
+void BlitTileImage(Image* dst, int dstX, int dstY, const Image* src, int srcX, int srcY, int size, int flags);
+
+// Create chunk storage for a layer, all chunks start dirty so they bake on first draw.
+LayerChunks* CreateLayerChunks(const struct ldtk_layer_instance* inst);
+void DestroyLayerChunks(LayerChunks* chunks);
+
+// Bake the images of all dirty chunks of a layer without uploading them, so it can run on a
+// loader thread. Returns the number of chunks baked.
+int BakeLayerChunks(struct ldtk_layer_instance* inst);
+
+// Upload chunk images baked by BakeLayerChunks, and subtract their size from budget (bytes)
+// until it runs out. NULL uploads them all. Returns true once none are left to upload.
+bool UploadLayerChunks(struct ldtk_layer_instance* inst, size_t* budget);
+
+// Mark the chunk containing layer cell (x, y) for re-baking, call after changing its tiles.
+void InvalidateLayerChunk(struct ldtk_layer_instance* inst, int x, int y);
+
+// Check whether a size x size block of an RGBA8 image is fully opaque.
+bool IsTileImageOpaque(const Image* image, int x, int y, int size);
+
+// Flag tiles of a level completely covered by opaque tiles drawn after them, in the same
+// layer or a layer above, as occluded. Tileset userdata must hold its TileSheet. Call again
+// after changing tiles. Returns the number of occluded tiles.
+int CullCoveredTiles(struct ldtk_level* level);
+
+// Get the range of layer cells [x0, x1) x [y0, y1) overlapping a world space rect, grown by
+// margin cells. Returns false if the range is empty.
+bool GetLayerCellRange(const struct ldtk_layer_instance* inst, Vector2 offset, Rectangle view, int margin, int* x0, int* y0, int* x1, int* y1);
+
+// Append the baked chunks of a layer overlapping the view rect to a draw list, baking and
+// uploading dirty ones first, and uploading those BakeLayerChunks left. Returns the number
+// of chunk quads added.
+int DrawLayerChunks(DrawList* list, int layer, struct ldtk_layer_instance* inst, Vector2 offset, Rectangle view);
+
+// Composite all layers of a level back to front into a new full scale RGBA8 image. IntGrid
+// layers without tiles are filled with their value colors.
+Image BakeLevelImage(const struct ldtk_level* level);
+
+// Average 2x2 blocks of an RGBA8 image into a new image of half the size (rounded up).
+Image DownsampleImage(const Image* image);
+
+// Bake the downsampled image chain of a level and upload it. Empty levels get no images,
+// NULL only if out of memory.
+LevelLod* CreateLevelLod(const struct ldtk_level* level);
+
+// The two halves of CreateLevelLod: baking only touches the CPU and can run on a loader thread,
+// uploading works like UploadLayerChunks.
+LevelLod* BakeLevelLod(const struct ldtk_level* level);
+bool UploadLevelLod(LevelLod* lod, size_t* budget);
+void DestroyLevelLod(LevelLod* lod);
+
+// Pick the level image with at least one texel per screen pixel at the given camera zoom.
+int GetLevelLodIndex(float zoom);
+
+// Append a level drawn from its downsampled images, creating or uploading them on first use.
+// Returns the number of quads added.
+int DrawLevelLod(DrawList* list, int layer, struct ldtk_level* level, float zoom);
+
+// Append the tiles of a layer overlapping the view rect to a draw list one by one, skipping
+// occluded ones. Returns the number of tiles added.
+int DrawLayerTiles(DrawList* list, int layer, const struct ldtk_layer_instance* inst, Vector2 offset, Rectangle view);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // LEVEL_RENDER_H
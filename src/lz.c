@@ -0,0 +1,154 @@
+#include "lz.h"
+
+#include <string.h>
+
+#define kLzMinMatch 4
+#define kLzHashBits 12
+#define kLzMaxOffset 65535
+#define kLzLastLiterals 5		// the block always ends with a few literals
+
+
+int LzCompressBound(int size)
+{
+	return size + size / 255 + 16;
+}
+
+
+static unsigned int ReadU32(const unsigned char* p)
+{
+	unsigned int value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+
+static unsigned int HashU32(unsigned int value)
+{
+	return (value * 2654435761u) >> (32 - kLzHashBits);
+}
+
+
+static unsigned char* WriteLength(unsigned char* out, int length)
+{
+	while (length >= 255)
+	{
+		*out++ = 255;
+		length -= 255;
+	}
+	*out++ = (unsigned char)length;
+	return out;
+}
+
+
+int LzCompress(const void* src, int srcSize, void* dst)
+{
+	const unsigned char* in = src;
+	unsigned char* out = dst;
+	int table[1 << kLzHashBits];
+	memset(table, 0xff, sizeof(table));
+
+	int anchor = 0;
+	int i = 0;
+	int matchLimit = srcSize - kLzLastLiterals;
+
+	while (i + kLzMinMatch <= matchLimit)
+	{
+		unsigned int seq = ReadU32(in + i);
+		unsigned int h = HashU32(seq);
+		int candidate = table[h];
+		table[h] = i;
+
+		if (candidate < 0 || i - candidate > kLzMaxOffset || ReadU32(in + candidate) != seq)
+		{
+			i++;
+			continue;
+		}
+
+		// extend the match, never into the trailing literals
+		int length = kLzMinMatch;
+		while (i + length < matchLimit && in[candidate + length] == in[i + length]) length++;
+
+		int literals = i - anchor;
+		unsigned char* token = out++;
+		*token = (unsigned char)(((literals < 15) ? literals : 15) << 4);
+		if (literals >= 15) out = WriteLength(out, literals - 15);
+		memcpy(out, in + anchor, literals);
+		out += literals;
+
+		int offset = i - candidate;
+		*out++ = (unsigned char)(offset & 0xff);
+		*out++ = (unsigned char)(offset >> 8);
+
+		int extra = length - kLzMinMatch;
+		*token |= (unsigned char)((extra < 15) ? extra : 15);
+		if (extra >= 15) out = WriteLength(out, extra - 15);
+
+		i += length;
+		anchor = i;
+	}
+
+	int literals = srcSize - anchor;
+	*out++ = (unsigned char)(((literals < 15) ? literals : 15) << 4);
+	if (literals >= 15) out = WriteLength(out, literals - 15);
+	memcpy(out, in + anchor, literals);
+	out += literals;
+
+	return (int)(out - (unsigned char*)dst);
+}
+
+
+// read a length extension, returns -1 past the end of the block
+static int ReadLength(const unsigned char** p, const unsigned char* end, int length)
+{
+	if (length != 15) return length;
+	unsigned char byte;
+	do
+	{
+		if (*p >= end) return -1;
+		byte = *(*p)++;
+		length += byte;
+	} while (byte == 255);
+	return length;
+}
+
+
+int LzDecompress(const void* src, int srcSize, void* dst, int dstCapacity)
+{
+	const unsigned char* in = src;
+	const unsigned char* end = in + srcSize;
+	unsigned char* out = dst;
+	int n = 0;
+
+	while (in < end)
+	{
+		unsigned char token = *in++;
+
+		int literals = ReadLength(&in, end, token >> 4);
+		if (literals < 0 || literals > end - in || literals > dstCapacity - n) return -1;
+		memcpy(out + n, in, literals);
+		in += literals;
+		n += literals;
+
+		// the last sequence stops after its literals
+		if (in == end) break;
+
+		if (end - in < 2) return -1;
+		int offset = in[0] | (in[1] << 8);
+		in += 2;
+
+		int length = ReadLength(&in, end, token & 15);
+		if (length < 0 || offset == 0 || offset > n) return -1;
+		length += kLzMinMatch;
+		if (length > dstCapacity - n) return -1;
+
+		// byte by byte, matches may overlap what they write
+		const unsigned char* match = out + n - offset;
+		for (int k = 0; k < length; ++k)
+		{
+			out[n + k] = match[k];
+		}
+		n += length;
+	}
+
+	return n;
+}
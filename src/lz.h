@@ -0,0 +1,32 @@
+// Fast LZ77 block compression.
+//
+// Byte oriented, in the style of LZ4: a block is a sequence of
+//   token (literal count << 4 | match length - 4), [literal count extension], literals,
+//   u16 match offset, [match length extension]
+// where a 15 in either half of the token is extended by bytes which are added on until one
+// isn't 255. The last sequence has literals only. Matches are found with a single entry hash
+// table of 4 byte prefixes, trading ratio for speed.
+
+#ifndef LZ_H
+#define LZ_H
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Largest compressed size of size bytes, incompressible data grows slightly.
+int LzCompressBound(int size);
+
+// Compress src into dst which must hold LzCompressBound(srcSize) bytes, returns the
+// compressed size.
+int LzCompress(const void* src, int srcSize, void* dst);
+
+// Decompress a whole block into dst, returns the decompressed size or -1 if the block is
+// corrupt or doesn't fit in dstCapacity.
+int LzDecompress(const void* src, int srcSize, void* dst, int dstCapacity);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // LZ_H
@@ -0,0 +1,397 @@
+#include "music_stream.h"
+#include "pack.h"
+#include "sys.h"
+
+#include "raylib.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// raylib builds stb_vorbis in for its own OGG support, these are the parts used here as
+// stb_vorbis.c declares them
+typedef struct stb_vorbis stb_vorbis;
+typedef struct stb_vorbis_info
+{
+	unsigned int sample_rate;
+	int channels;
+	unsigned int setup_memory_required;
+	unsigned int setup_temp_memory_required;
+	unsigned int temp_memory_required;
+	int max_frame_size;
+} stb_vorbis_info;
+
+stb_vorbis* stb_vorbis_open_memory(const unsigned char* data, int len, int* error, const void* alloc_buffer);
+stb_vorbis_info stb_vorbis_get_info(stb_vorbis* f);
+int stb_vorbis_get_samples_short_interleaved(stb_vorbis* f, int channels, short* buffer, int num_shorts);
+int stb_vorbis_seek_start(stb_vorbis* f);
+void stb_vorbis_close(stb_vorbis* f);
+
+typedef enum MusicFormat
+{
+	MusicFormat_Wav,
+	MusicFormat_Ogg,
+} MusicFormat;
+
+typedef struct MusicStream
+{
+	MusicFormat format;
+	int sampleRate;
+	int channels;
+	bool looping;
+
+	// the whole file, from the pack or loaded
+	PackSlice slice;
+	unsigned char* fileData;
+
+	// decoder, only touched by the decoding thread once it runs
+	stb_vorbis* vorbis;
+	const short* wavSamples;
+	int wavFrames;
+	int wavPosition;
+
+	// ring of frames, written by the decoding thread and read by the audio device. Each side
+	// only advances its own counter, the difference is what's buffered.
+	short* ring;
+	volatile int writtenFrames;
+	volatile int readFrames;
+	volatile int ended;				// the decoder reached the end without looping
+
+	// read side stats, only written by the reader which mustn't take the lock
+	volatile int underruns;
+	volatile int underrunFrames;
+	volatile int minBufferedFrames;
+
+	SysThread* thread;
+	SysMutex* lock;					// guards quit and the decoding side of stats
+	SysCondition* wake;				// signalled when the ring has room
+	bool quit;
+
+	AudioStream stream;				// when playing through raylib's audio device
+
+	MusicStreamStats stats;
+} MusicStream;
+
+static MusicStream gMusic = { 0 };
+
+
+static int AtomicLoad(volatile int* value)
+{
+	return AtomicFetchAdd(value, 0);
+}
+
+
+// Frames in the ring, the counters wrap around
+static int GetBufferedFrames(void)
+{
+	return (int)((unsigned int)AtomicLoad(&gMusic.writtenFrames) - (unsigned int)AtomicLoad(&gMusic.readFrames));
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Decoding
+
+static unsigned int ReadLE32(const unsigned char* data)
+{
+	return data[0] | (data[1] << 8) | (data[2] << 16) | ((unsigned int)data[3] << 24);
+}
+
+
+static unsigned int ReadLE16(const unsigned char* data)
+{
+	return data[0] | (data[1] << 8);
+}
+
+
+// Find the samples of a 16 bit PCM WAV file, which are decoded by copying them
+static bool OpenWav(const unsigned char* data, unsigned int size)
+{
+	if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) return false;
+
+	bool format = false;
+	for (unsigned int offset = 12; offset + 8 <= size;)
+	{
+		const unsigned char* chunk = data + offset;
+		unsigned int chunkSize = ReadLE32(chunk + 4);
+		if (chunkSize > size - offset - 8) chunkSize = size - offset - 8;
+
+		if (memcmp(chunk, "fmt ", 4) == 0 && chunkSize >= 16)
+		{
+			// PCM, 16 bit samples
+			if (ReadLE16(chunk + 8) != 1 || ReadLE16(chunk + 22) != 16) return false;
+			gMusic.channels = (int)ReadLE16(chunk + 10);
+			gMusic.sampleRate = (int)ReadLE32(chunk + 12);
+			format = true;
+		}
+		else if (memcmp(chunk, "data", 4) == 0 && format && gMusic.channels > 0)
+		{
+			// WAV files are little endian, like every platform the game runs on
+			gMusic.wavSamples = (const short*)(chunk + 8);
+			gMusic.wavFrames = (int)(chunkSize / (2 * (unsigned int)gMusic.channels));
+			return true;
+		}
+		offset += 8 + chunkSize + (chunkSize & 1);
+	}
+	return false;
+}
+
+
+// Decode up to frameCount frames into samples, returns how many. 0 at the end.
+static int DecodeMusic(short* samples, int frameCount)
+{
+	if (gMusic.format == MusicFormat_Ogg)
+	{
+		return stb_vorbis_get_samples_short_interleaved(gMusic.vorbis, gMusic.channels, samples, frameCount * gMusic.channels);
+	}
+
+	int frames = gMusic.wavFrames - gMusic.wavPosition;
+	if (frames > frameCount) frames = frameCount;
+	memcpy(samples, gMusic.wavSamples + (size_t)gMusic.wavPosition * gMusic.channels, (size_t)frames * gMusic.channels * sizeof(short));
+	gMusic.wavPosition += frames;
+	return frames;
+}
+
+
+static void RewindMusic(void)
+{
+	if (gMusic.format == MusicFormat_Ogg) stb_vorbis_seek_start(gMusic.vorbis);
+	else gMusic.wavPosition = 0;
+}
+
+
+// Decode a chunk into the ring. Returns false if it has no room for one, or the music ended.
+static bool DecodeMusicChunk(void)
+{
+	if (gMusic.ended || kMusicRingFrames - GetBufferedFrames() < kMusicDecodeFrames) return false;
+
+	// up to the end of the ring, the next chunk continues at its start
+	int start = (int)((unsigned int)gMusic.writtenFrames % kMusicRingFrames);
+	int frames = kMusicRingFrames - start;
+	if (frames > kMusicDecodeFrames) frames = kMusicDecodeFrames;
+	short* samples = gMusic.ring + (size_t)start * gMusic.channels;
+
+	double decodeStart = GetHighResTime();
+	int decoded = DecodeMusic(samples, frames);
+	if (decoded == 0 && gMusic.looping)
+	{
+		RewindMusic();
+		decoded = DecodeMusic(samples, frames);
+	}
+	double decodeTime = GetHighResTime() - decodeStart;
+
+	if (decoded == 0)
+	{
+		AtomicFetchAdd(&gMusic.ended, 1);
+		return false;
+	}
+
+	// the samples are in place before the reader sees the counter move
+	AtomicFetchAdd(&gMusic.writtenFrames, decoded);
+
+	LockSysMutex(gMusic.lock);
+	gMusic.stats.decodedFrames += decoded;
+	gMusic.stats.decodes++;
+	gMusic.stats.decodeTime += decodeTime;
+	if (decodeTime > gMusic.stats.maxDecodeTime) gMusic.stats.maxDecodeTime = decodeTime;
+	UnlockSysMutex(gMusic.lock);
+	return true;
+}
+
+
+// The reader signals without the lock, so a wake up can be missed between the ring filling
+// up and the wait: decoding then resumes on the next read, which is long before it runs dry
+static void MusicDecodingThread(void* arg)
+{
+	(void)arg;
+	LockSysMutex(gMusic.lock);
+	while (!gMusic.quit)
+	{
+		UnlockSysMutex(gMusic.lock);
+		bool decoded = DecodeMusicChunk();
+		LockSysMutex(gMusic.lock);
+		if (!decoded && !gMusic.quit) WaitSysCondition(gMusic.wake, gMusic.lock);
+	}
+	UnlockSysMutex(gMusic.lock);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Playing
+
+void ReadStreamedMusic(short* samples, int frameCount)
+{
+	int channels = gMusic.channels ? gMusic.channels : 1;
+	int buffered = gMusic.ring ? GetBufferedFrames() : 0;
+	int frames = (buffered < frameCount) ? buffered : frameCount;
+
+	int start = (int)((unsigned int)gMusic.readFrames % kMusicRingFrames);
+	int first = kMusicRingFrames - start;
+	if (first > frames) first = frames;
+	if (frames > 0)
+	{
+		memcpy(samples, gMusic.ring + (size_t)start * channels, (size_t)first * channels * sizeof(short));
+		memcpy(samples + (size_t)first * channels, gMusic.ring, (size_t)(frames - first) * channels * sizeof(short));
+	}
+	memset(samples + (size_t)frames * channels, 0, (size_t)(frameCount - frames) * channels * sizeof(short));
+
+	// done with the frames before the writer may reuse them
+	AtomicFetchAdd(&gMusic.readFrames, frames);
+	buffered -= frames;
+
+	if (frames < frameCount && !gMusic.ended)
+	{
+		AtomicFetchAdd(&gMusic.underruns, 1);
+		AtomicFetchAdd(&gMusic.underrunFrames, frameCount - frames);
+	}
+	// the reader is the only writer, so adding the difference can't lose an update
+	int minBuffered = AtomicLoad(&gMusic.minBufferedFrames);
+	if (buffered < minBuffered) AtomicFetchAdd(&gMusic.minBufferedFrames, buffered - minBuffered);
+	if (gMusic.thread && buffered <= kMusicRingFrames - kMusicDecodeFrames) SignalSysCondition(gMusic.wake);
+}
+
+
+// raylib calls this on its audio thread for each buffer it mixes, in the stream's format
+static void MusicAudioCallback(void* buffer, unsigned int frames)
+{
+	ReadStreamedMusic(buffer, (int)frames);
+}
+
+
+bool LoadStreamedMusic(const char* fileName, bool looping)
+{
+	UnloadStreamedMusic();
+	gMusic.looping = looping;
+
+	const unsigned char* data = NULL;
+	unsigned int size = 0;
+	if (LoadPackFile(fileName, &gMusic.slice))
+	{
+		data = gMusic.slice.data;
+		size = gMusic.slice.size;
+	}
+	else
+	{
+		gMusic.fileData = LoadFileData(fileName, &size);
+		data = gMusic.fileData;
+	}
+
+	bool opened = false;
+	if (data && IsFileExtension(fileName, ".ogg"))
+	{
+		gMusic.format = MusicFormat_Ogg;
+		gMusic.vorbis = stb_vorbis_open_memory(data, (int)size, NULL, NULL);
+		if (gMusic.vorbis)
+		{
+			stb_vorbis_info info = stb_vorbis_get_info(gMusic.vorbis);
+			gMusic.sampleRate = (int)info.sample_rate;
+			gMusic.channels = info.channels;
+			opened = true;
+		}
+	}
+	else if (data && IsFileExtension(fileName, ".wav"))
+	{
+		gMusic.format = MusicFormat_Wav;
+		opened = OpenWav(data, size);
+	}
+
+	gMusic.ring = opened ? malloc((size_t)kMusicRingFrames * (gMusic.channels ? gMusic.channels : 1) * sizeof(short)) : NULL;
+	gMusic.lock = CreateSysMutex();
+	gMusic.wake = CreateSysCondition();
+	if (!opened || gMusic.channels < 1 || gMusic.channels > 2 || !gMusic.ring || !gMusic.lock || !gMusic.wake)
+	{
+		TraceLog(LOG_WARNING, "MUSIC: [%s] Failed to open music", fileName);
+		UnloadStreamedMusic();
+		return false;
+	}
+
+	gMusic.stats.sampleRate = gMusic.sampleRate;
+	gMusic.stats.channels = gMusic.channels;
+	gMusic.minBufferedFrames = kMusicRingFrames;
+
+	// fill the ring before anything reads it
+	while (DecodeMusicChunk()) {}
+	gMusic.thread = StartThread(MusicDecodingThread, NULL);
+
+	if (IsAudioDeviceReady())
+	{
+		gMusic.stream = LoadAudioStream((unsigned int)gMusic.sampleRate, 16, (unsigned int)gMusic.channels);
+		SetAudioStreamCallback(gMusic.stream, MusicAudioCallback);
+	}
+
+	TraceLog(LOG_INFO, "MUSIC: [%s] Streaming, %d Hz, %d channels, decoding %s", fileName, gMusic.sampleRate, gMusic.channels,
+		gMusic.thread ? "on a thread" : "on the main thread");
+	return true;
+}
+
+
+void UnloadStreamedMusic(void)
+{
+	if (gMusic.stream.buffer) UnloadAudioStream(gMusic.stream);
+
+	if (gMusic.thread)
+	{
+		LockSysMutex(gMusic.lock);
+		gMusic.quit = true;
+		SignalSysCondition(gMusic.wake);
+		UnlockSysMutex(gMusic.lock);
+		JoinThread(gMusic.thread);
+	}
+
+	if (gMusic.vorbis) stb_vorbis_close(gMusic.vorbis);
+	DestroySysCondition(gMusic.wake);
+	DestroySysMutex(gMusic.lock);
+	free(gMusic.ring);
+	UnloadPackFile(&gMusic.slice);
+	UnloadFileData(gMusic.fileData);
+	memset(&gMusic, 0, sizeof(gMusic));
+}
+
+
+void PlayStreamedMusic(void)
+{
+	if (gMusic.stream.buffer) PlayAudioStream(gMusic.stream);
+}
+
+
+void PauseStreamedMusic(void)
+{
+	if (gMusic.stream.buffer) PauseAudioStream(gMusic.stream);
+}
+
+
+void SetStreamedMusicVolume(float volume)
+{
+	if (gMusic.stream.buffer) SetAudioStreamVolume(gMusic.stream, volume);
+}
+
+
+void UpdateStreamedMusic(void)
+{
+	if (gMusic.ring && !gMusic.thread)
+	{
+		while (DecodeMusicChunk()) {}
+	}
+}
+
+
+bool IsStreamedMusicDone(void)
+{
+	return gMusic.ring && gMusic.ended && GetBufferedFrames() == 0;
+}
+
+
+MusicStreamStats GetStreamedMusicStats(void)
+{
+	MusicStreamStats stats = { 0 };
+	if (!gMusic.ring) return stats;
+
+	LockSysMutex(gMusic.lock);
+	stats = gMusic.stats;
+	UnlockSysMutex(gMusic.lock);
+	stats.underruns = AtomicLoad(&gMusic.underruns);
+	stats.underrunFrames = AtomicLoad(&gMusic.underrunFrames);
+	stats.minBufferedFrames = AtomicLoad(&gMusic.minBufferedFrames);
+	stats.bufferedFrames = GetBufferedFrames();
+	return stats;
+}
@@ -0,0 +1,71 @@
+// Music decoded on a thread of its own.
+//
+// raylib's music streams decode in UpdateMusicStream on the main thread, so a long frame
+// delays decoding and the audio device runs dry. Here a decoding thread keeps a ring buffer
+// of samples filled ahead, and the audio device's callback copies out of it without locks;
+// the main thread does no decoding. Web builds without threads decode in
+// UpdateStreamedMusic instead.
+//
+// Without an audio device nothing plays, whoever stands in for the device reads samples
+// with ReadStreamedMusic, e.g. the headless benchmark.
+//
+// Plays one music at a time: OGG files, and WAV files of 16 bit samples. Files are read
+// from the mounted resource pack if it has them.
+
+#ifndef MUSIC_STREAM_H
+#define MUSIC_STREAM_H
+
+#include <stdbool.h>
+
+#define kMusicRingFrames 16384		// buffered ahead, about 370 ms at 44.1 kHz
+#define kMusicDecodeFrames 2048		// decoded at a time
+
+typedef struct MusicStreamStats
+{
+	int sampleRate;
+	int channels;
+
+	// read side, by the audio device
+	int underruns;					// reads the ring couldn't fill, padded with silence
+	int underrunFrames;
+	int minBufferedFrames;			// fewest left after a read, how close it came to running dry
+	int bufferedFrames;				// in the ring now
+
+	// decoding thread
+	long long decodedFrames;
+	int decodes;
+	double decodeTime;				// seconds spent decoding
+	double maxDecodeTime;			// longest single decode
+} MusicStreamStats;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Open the music and start decoding it, replacing any music loaded before. Plays through
+// raylib's audio device if it is initialized.
+bool LoadStreamedMusic(const char* fileName, bool looping);
+void UnloadStreamedMusic(void);
+
+void PlayStreamedMusic(void);
+void PauseStreamedMusic(void);
+void SetStreamedMusicVolume(float volume);
+
+// Decode on the calling thread, only when there is no decoding thread. Called every frame.
+void UpdateStreamedMusic(void);
+
+// Copy frames of interleaved samples out of the ring, silence for those it doesn't have.
+// Called by the audio device, or by a stand in for it. Never blocks.
+void ReadStreamedMusic(short* samples, int frameCount);
+
+// True once music which doesn't loop has been read to its end
+bool IsStreamedMusicDone(void);
+
+MusicStreamStats GetStreamedMusicStats(void);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // MUSIC_STREAM_H
@@ -0,0 +1,402 @@
+#include "pack.h"
+#include "ldtk.h"
+#include "lz.h"
+#include "replay.h"
+#include "sys.h"
+
+#include "raylib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kPackMagic 0x4B415052	// "RPAK"
+#define kPackVersion 1
+#define kPackAlignment 16		// of each file's data
+#define kPackMaxPath 260
+
+// Compressed files have to be copied out of the pack, so they are only kept compressed when
+// that saves at least a quarter of their size
+#define kPackMinCompression 4
+
+typedef enum PackCompression
+{
+	PackCompression_None,
+	PackCompression_Lz,
+} PackCompression;
+
+// Little endian, like every platform the game runs on, and read in place from the mapping
+typedef struct PackHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int fileCount;
+	unsigned int namesSize;
+	unsigned long long indexOffset;		// fileCount entries, sorted by hash
+	unsigned long long namesOffset;		// zero terminated paths
+} PackHeader;
+
+typedef struct PackEntry
+{
+	unsigned long long hash;			// of the path, see GetPackPath
+	unsigned long long offset;
+	unsigned int size;
+	unsigned int storedSize;			// followed by a zero byte
+	unsigned int compression;			// PackCompression
+	unsigned int nameOffset;
+} PackEntry;
+
+typedef struct Pack
+{
+	SysFileMap map;
+	const PackHeader* header;
+	const PackEntry* entries;
+	const char* names;
+} Pack;
+
+static Pack gPack = { 0 };
+
+
+// The path as it is stored: forward slashes, without leading "./"
+static bool GetPackPath(const char* fileName, char* path)
+{
+	while (fileName[0] == '.' && (fileName[1] == '/' || fileName[1] == '\\')) fileName += 2;
+
+	size_t length = strlen(fileName);
+	if (length >= kPackMaxPath) return false;
+	for (size_t i = 0; i <= length; ++i)
+	{
+		path[i] = (fileName[i] == '\\') ? '/' : fileName[i];
+	}
+	return true;
+}
+
+
+static unsigned long long HashPackPath(const char* path)
+{
+	return HashReplayData((const unsigned char*)path, (unsigned int)strlen(path));
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Building
+
+static int ComparePackEntries(const void* a, const void* b)
+{
+	const PackEntry* entryA = a;
+	const PackEntry* entryB = b;
+	if (entryA->hash != entryB->hash) return (entryA->hash < entryB->hash) ? -1 : 1;
+	return 0;
+}
+
+
+static bool WritePackPadding(FILE* file, unsigned long long* offset)
+{
+	static const unsigned char zeros[kPackAlignment] = { 0 };
+	size_t padding = (size_t)((kPackAlignment - (*offset % kPackAlignment)) % kPackAlignment);
+	*offset += padding;
+	return padding == 0 || fwrite(zeros, padding, 1, file) == 1;
+}
+
+
+bool BuildPack(const char* directory, const char* fileName, bool compress)
+{
+	FilePathList files = LoadDirectoryFilesEx(directory, NULL, true);
+	PackEntry* entries = calloc(files.count ? files.count : 1, sizeof(PackEntry));
+	char* names = malloc((size_t)files.count * kPackMaxPath + 1);
+	FILE* file = fopen(fileName, "wb");
+
+	PackHeader header = { 0 };
+	header.magic = kPackMagic;
+	header.version = kPackVersion;
+
+	bool ok = entries && names && file && fwrite(&header, sizeof(header), 1, file) == 1;
+	unsigned long long offset = sizeof(header);
+	unsigned long long looseSize = 0;
+	int compressedCount = 0;
+
+	for (unsigned int i = 0; ok && i < files.count; ++i)
+	{
+		char path[kPackMaxPath];
+		if (!GetPackPath(files.paths[i], path)) continue;
+		if (strcmp(GetFileName(path), GetFileName(fileName)) == 0) continue;
+
+		unsigned int size = 0;
+		unsigned char* data = LoadFileData(files.paths[i], &size);
+		if (!data) continue;
+
+		unsigned char* compressed = compress ? malloc((size_t)LzCompressBound((int)size)) : NULL;
+		int compressedSize = compressed ? LzCompress(data, (int)size, compressed) : 0;
+		bool useCompressed = compressed && compressedSize <= (int)(size - size / kPackMinCompression);
+
+		PackEntry* entry = &entries[header.fileCount++];
+		entry->hash = HashPackPath(path);
+		entry->size = size;
+		entry->storedSize = useCompressed ? (unsigned int)compressedSize : size;
+		entry->compression = useCompressed ? PackCompression_Lz : PackCompression_None;
+		entry->nameOffset = header.namesSize;
+		memcpy(names + header.namesSize, path, strlen(path) + 1);
+		header.namesSize += (unsigned int)strlen(path) + 1;
+
+		ok = WritePackPadding(file, &offset);
+		entry->offset = offset;
+		const unsigned char zero = 0;
+		ok = ok && (entry->storedSize == 0 || fwrite(useCompressed ? compressed : data, entry->storedSize, 1, file) == 1) &&
+			fwrite(&zero, 1, 1, file) == 1;
+		offset += entry->storedSize + 1;
+
+		looseSize += size;
+		if (useCompressed) compressedCount++;
+		free(compressed);
+		UnloadFileData(data);
+	}
+
+	if (ok)
+	{
+		qsort(entries, header.fileCount, sizeof(PackEntry), ComparePackEntries);
+
+		ok = WritePackPadding(file, &offset);
+		header.indexOffset = offset;
+		header.namesOffset = offset + (unsigned long long)header.fileCount * sizeof(PackEntry);
+		ok = ok && (header.fileCount == 0 || fwrite(entries, sizeof(PackEntry), header.fileCount, file) == header.fileCount) &&
+			(header.namesSize == 0 || fwrite(names, header.namesSize, 1, file) == 1);
+		offset = header.namesOffset + header.namesSize;
+
+		// the header goes in last, once the index is where it says
+		ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+	}
+
+	if (file) ok = (fclose(file) == 0) && ok;
+	if (!ok) remove(fileName);
+	free(entries);
+	free(names);
+	UnloadDirectoryFiles(files);
+
+	if (ok)
+	{
+		TraceLog(LOG_INFO, "PACK: [%s] Packed %u files (%d compressed), %.1f KB into %.1f KB", fileName, header.fileCount, compressedCount,
+			looseSize / 1024.0, offset / 1024.0);
+	}
+	else
+	{
+		TraceLog(LOG_WARNING, "PACK: [%s] Failed to write pack", fileName);
+	}
+	return ok;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Reading
+
+static const PackEntry* FindPackEntry(const char* fileName)
+{
+	char path[kPackMaxPath];
+	if (!gPack.header || !GetPackPath(fileName, path)) return NULL;
+	unsigned long long hash = HashPackPath(path);
+
+	// first entry with the hash, then the path decides between any which share it
+	int low = 0;
+	int high = (int)gPack.header->fileCount;
+	while (low < high)
+	{
+		int middle = (low + high) / 2;
+		if (gPack.entries[middle].hash < hash) low = middle + 1;
+		else high = middle;
+	}
+
+	for (int i = low; i < (int)gPack.header->fileCount && gPack.entries[i].hash == hash; ++i)
+	{
+		if (strcmp(gPack.names + gPack.entries[i].nameOffset, path) == 0) return &gPack.entries[i];
+	}
+	return NULL;
+}
+
+
+static bool IsPackMemory(const void* data)
+{
+	const unsigned char* bytes = data;
+	return gPack.map.data && bytes >= gPack.map.data && bytes < gPack.map.data + gPack.map.size;
+}
+
+
+bool LoadPackFile(const char* fileName, PackSlice* slice)
+{
+	memset(slice, 0, sizeof(*slice));
+	const PackEntry* entry = FindPackEntry(fileName);
+	if (!entry) return false;
+
+	const unsigned char* stored = gPack.map.data + entry->offset;
+	if (entry->compression == PackCompression_None)
+	{
+		slice->data = stored;
+		slice->size = entry->size;
+		return true;
+	}
+
+	unsigned char* data = malloc((size_t)entry->size + 1);
+	if (!data) return false;
+	if (LzDecompress(stored, (int)entry->storedSize, data, (int)entry->size) != (int)entry->size)
+	{
+		TraceLog(LOG_WARNING, "PACK: [%s] Failed to decompress", fileName);
+		free(data);
+		return false;
+	}
+	data[entry->size] = 0;
+
+	slice->data = data;
+	slice->size = entry->size;
+	slice->owned = true;
+	return true;
+}
+
+
+void UnloadPackFile(PackSlice* slice)
+{
+	if (slice->owned) free((void*)slice->data);
+	memset(slice, 0, sizeof(*slice));
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Callbacks
+
+// raylib's own loading, for files the pack doesn't have
+static unsigned char* LoadLooseFile(const char* fileName, unsigned int* size, bool text)
+{
+	*size = 0;
+	FILE* file = fopen(fileName, "rb");
+	if (!file)
+	{
+		TraceLog(LOG_WARNING, "FILEIO: [%s] Failed to open file", fileName);
+		return NULL;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long length = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	unsigned char* data = (length >= 0) ? malloc((size_t)length + 1) : NULL;
+	if (data && fread(data, 1, (size_t)length, file) == (size_t)length)
+	{
+		data[length] = 0;
+		*size = (unsigned int)length;
+	}
+	else
+	{
+		TraceLog(LOG_WARNING, "FILEIO: [%s] Failed to read file", fileName);
+		free(data);
+		data = NULL;
+	}
+	fclose(file);
+
+	if (data) TraceLog(LOG_INFO, "FILEIO: [%s] %s loaded successfully", fileName, text ? "Text file" : "File");
+	return data;
+}
+
+
+// raylib frees what these return, so files in the mapping are copied out
+static unsigned char* LoadFileDataFromPack(const char* fileName, unsigned int* bytesRead)
+{
+	PackSlice slice;
+	if (!LoadPackFile(fileName, &slice)) return LoadLooseFile(fileName, bytesRead, false);
+
+	*bytesRead = slice.size;
+	if (slice.owned) return (unsigned char*)slice.data;
+
+	unsigned char* data = malloc((size_t)slice.size + 1);
+	if (data) memcpy(data, slice.data, (size_t)slice.size + 1);
+	else *bytesRead = 0;
+	return data;
+}
+
+
+static char* LoadFileTextFromPack(const char* fileName)
+{
+	unsigned int size = 0;
+	return (char*)LoadFileDataFromPack(fileName, &size);
+}
+
+
+// ldtk only reads the text, so worlds parse straight from the mapping
+static const char* LoadWorldTextFromPack(const char* fileName)
+{
+	PackSlice slice;
+	return LoadPackFile(fileName, &slice) ? (const char*)slice.data : NULL;
+}
+
+
+static void UnloadWorldTextFromPack(const char* text)
+{
+	if (!IsPackMemory(text)) free((void*)text);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Mounting
+
+bool MountPack(const char* fileName)
+{
+	UnmountPack();
+
+	SysFileMap map;
+	if (!MapFile(fileName, &map)) return false;
+
+	// everything the index points at has to be inside the file
+	const PackHeader* header = (const PackHeader*)map.data;
+	bool valid = map.size >= sizeof(PackHeader) && header->magic == kPackMagic && header->version == kPackVersion &&
+		header->indexOffset % 8 == 0 &&
+		header->indexOffset + (unsigned long long)header->fileCount * sizeof(PackEntry) <= header->namesOffset &&
+		header->namesOffset + header->namesSize <= map.size &&
+		(header->namesSize == 0 || map.data[header->namesOffset + header->namesSize - 1] == 0);
+
+	const PackEntry* entries = valid ? (const PackEntry*)(map.data + header->indexOffset) : NULL;
+	for (unsigned int i = 0; valid && i < header->fileCount; ++i)
+	{
+		valid = entries[i].offset + entries[i].storedSize + 1 <= header->indexOffset &&
+			entries[i].nameOffset < header->namesSize &&
+			(entries[i].compression == PackCompression_Lz ||
+				(entries[i].compression == PackCompression_None && entries[i].storedSize == entries[i].size));
+	}
+
+	if (!valid)
+	{
+		TraceLog(LOG_WARNING, "PACK: [%s] Invalid pack, loading loose files", fileName);
+		UnmapFile(&map);
+		return false;
+	}
+
+	gPack.map = map;
+	gPack.header = header;
+	gPack.entries = entries;
+	gPack.names = (const char*)(map.data + header->namesOffset);
+
+	SetLoadFileDataCallback(LoadFileDataFromPack);
+	SetLoadFileTextCallback(LoadFileTextFromPack);
+	ldtk_set_file_callbacks(LoadWorldTextFromPack, UnloadWorldTextFromPack);
+
+	TraceLog(LOG_INFO, "PACK: [%s] Mounted, %u files", fileName, header->fileCount);
+	return true;
+}
+
+
+void UnmountPack(void)
+{
+	if (!gPack.header) return;
+
+	SetLoadFileDataCallback(NULL);
+	SetLoadFileTextCallback(NULL);
+	ldtk_set_file_callbacks(NULL, NULL);
+
+	UnmapFile(&gPack.map);
+	memset(&gPack, 0, sizeof(gPack));
+}
+
+
+bool IsPackMounted(void)
+{
+	return gPack.header != NULL;
+}
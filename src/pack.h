@@ -0,0 +1,54 @@
+// Resource pack: every file of a directory in one archive.
+//
+// Opening one file and mapping it replaces opening each resource on its own, which adds up on
+// slow storage and in the web build. A pack holds the files' contents and an index of path
+// hash to offset, size and compression, looked up in place in the mapping. Files are stored as
+// they are, so loading them is a pointer into the mapping, or LZ compressed for a smaller
+// download at the cost of decompressing them on every load.
+//
+// Mounting a pack routes raylib's file loading and ldtk_load_world through it, falling back
+// to loose files for paths it doesn't have. Built with:
+// raylib_game --pack <dir> <file> [--compress]
+
+#ifndef PACK_H
+#define PACK_H
+
+#include <stdbool.h>
+
+#define kResourcePackFileName "resources.pack"
+
+// A file's contents in the mounted pack, zero terminated so text parses in place
+typedef struct PackSlice
+{
+	const unsigned char* data;
+	unsigned int size;
+	bool owned;				// decompressed into memory of its own, otherwise in the mapping
+} PackSlice;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Pack every file under directory, recursively, with their paths as the game opens them:
+// the directory as given followed by the path inside it. Compressed files are only kept so
+// if that makes them a quarter smaller.
+bool BuildPack(const char* directory, const char* fileName, bool compress);
+
+// Map a pack and load files from it until unmounted. Fails, leaving files loose, if the pack
+// doesn't exist or is damaged.
+bool MountPack(const char* fileName);
+void UnmountPack(void);
+
+bool IsPackMounted(void);
+
+// Get a file from the mounted pack, pointing into the mapping unless it was compressed.
+// Returns false if no pack is mounted or it doesn't have the file.
+bool LoadPackFile(const char* fileName, PackSlice* slice);
+void UnloadPackFile(PackSlice* slice);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // PACK_H
@@ -14,6 +14,14 @@
 
 #include "raylib.h"
 #include "screens.h"    // NOTE: Declares global (extern) variables and screens functions
+#include "headless.h"
+#include "assets.h"
+#include "pack.h"
+#include "music_stream.h"
+#include "sys.h"
+
+#include <stdint.h>
+#include <string.h>
 
 #if defined(PLATFORM_WEB)
     #include <emscripten/emscripten.h>
@@ -25,8 +33,8 @@
 //----------------------------------------------------------------------------------
 GameScreen currentScreen = LOGO;
 Font font = { 0 };
-Music music = { 0 };
 Sound fxCoin = { 0 };
+float transLongestFrame = 0.0f;
 
 //----------------------------------------------------------------------------------
 // Local Variables Definition (local to this module)
@@ -41,6 +49,15 @@ static bool transFadeOut = false;
 static int transFromScreen = -1;
 static GameScreen transToScreen = UNKNOWN;
 
+// The next screen is loaded on a thread while the current one fades out, the fade then holds
+// on black while its GPU resources are uploaded a slice per frame
+static SysThread* transLoadThread = NULL;   // NULL once joined, or if loading on the main thread
+static volatile int transLoaded = 0;        // set once the CPU side of the next screen is loaded
+static double transStartTime = 0.0;
+
+// Global assets, held for the whole run
+static Asset* fxCoinAsset = NULL;
+
 //----------------------------------------------------------------------------------
 // Local Functions Declaration
 //----------------------------------------------------------------------------------
@@ -49,37 +66,54 @@ static void ChangeToScreen(int screen);     // Change to screen, no transition e
 static void TransitionToScreen(int screen); // Request transition to next screen
 static void UpdateTransition(void);         // Update transition effect
 static void DrawTransition(void);           // Draw transition effect (full-screen rectangle)
+static void LoadScreenThread(void* arg);    // Load the CPU side of a screen
+static bool UploadScreen(GameScreen screen);    // Upload a slice of a screen's GPU resources
 
 static void UpdateDrawFrame(void);          // Update and draw one frame
 
 //----------------------------------------------------------------------------------
 // Main entry point
 //----------------------------------------------------------------------------------
-int main(void)
+int main(int argc, char** argv)
 {
+    // Simulate without a window and exit, used for benchmarks and CI
+    if (IsHeadlessSimulation(argc, argv)) return RunHeadlessSimulation(argc, argv);
+
+    // Pack a directory into a resource pack and exit, e.g. --pack resources resources.pack
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "--pack") == 0)
+    {
+        bool compress = (argc == 5) && strcmp(argv[4], "--compress") == 0;
+        return BuildPack(argv[2], argv[3], compress) ? 0 : 1;
+    }
+
     // Initialization
     //---------------------------------------------------------
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
     InitWindow(screenWidth, screenHeight, "raylib game template");
 
     InitAudioDevice();      // Initialize audio device
+    MountPack(kResourcePackFileName);       // Load from the resource pack if there is one, loose files otherwise
+    InitAssetCache(kAssetCacheBudget);      // Assets shared by screens, kept loaded between them
 
     // Load global data (assets that must be available in all screens, i.e. font)
     font = LoadFont("resources/mecha.png");
-    music = LoadMusicStream("resources/ambient.ogg");
-    fxCoin = LoadSound("resources/coin.wav");
+    LoadStreamedMusic("resources/ambient.ogg", true);     // Decoded on a thread, keeps playing between screens
+    fxCoinAsset = AcquireAsset(AssetType_Sound, "resources/coin.wav");
+    if (fxCoinAsset) fxCoin = fxCoinAsset->sound;
 
-    SetMusicVolume(music, 1.0f);
-    //PlayMusicStream(music);
+    SetStreamedMusicVolume(1.0f);
+    //PlayStreamedMusic();
 
     // Setup and init first screen
     currentScreen = LOGO;
     InitLogoScreen();
 
 #if defined(PLATFORM_WEB)
-    emscripten_set_main_loop(UpdateDrawFrame, 60, 1);
+    emscripten_set_main_loop(UpdateDrawFrame, 0, 1);   // Render at the display rate, gameplay ticks at a fixed rate
 #else
-    SetTargetFPS(60);       // Set our game to run at 60 frames-per-second
+    // Render at the display refresh rate, gameplay runs its own fixed rate ticks
+    int refreshRate = GetMonitorRefreshRate(GetCurrentMonitor());
+    SetTargetFPS((refreshRate > 0) ? refreshRate : 60);
     //--------------------------------------------------------------------------------------
 
     // Skip straight to gameplay
@@ -94,6 +128,10 @@ int main(void)
 
     // De-Initialization
     //--------------------------------------------------------------------------------------
+    // Closed mid transition: the next screen may be loaded, but not initialized yet
+    if (transLoadThread) JoinThread(transLoadThread);
+    if (onTransition && !transFadeOut && transLoaded && transToScreen == GAMEPLAY) UnloadGameplayScreen();
+
     // Unload current screen data before closing
     switch (currentScreen)
     {
@@ -106,8 +144,18 @@ int main(void)
 
     // Unload global data loaded
     UnloadFont(font);
-    UnloadMusicStream(music);
-    UnloadSound(fxCoin);
+    ReleaseAsset(fxCoinAsset);
+
+    AssetCacheStats assetStats = GetAssetCacheStats();
+    TraceLog(LOG_INFO, "ASSETS: %d hits, %d misses, %d reloads, %d evictions", assetStats.hits, assetStats.misses, assetStats.reloads, assetStats.evictions);
+    FreeAssetCache();
+    MusicStreamStats musicStats = GetStreamedMusicStats();
+    TraceLog(LOG_INFO, "MUSIC: %d underruns, %.2f ms decoding per second of music, longest decode %.2f ms", musicStats.underruns,
+        (musicStats.decodedFrames > 0) ? musicStats.decodeTime * 1e3 * musicStats.sampleRate / (double)musicStats.decodedFrames : 0.0,
+        musicStats.maxDecodeTime * 1e3);
+    UnloadStreamedMusic();
+
+    UnmountPack();          // After the cache and music, which read from the pack
 
     CloseAudioDevice();     // Close audio context
 
@@ -154,12 +202,41 @@ static void TransitionToScreen(GameScreen screen)
     transFromScreen = currentScreen;
     transToScreen = screen;
     transAlpha = 0.0f;
+    transLongestFrame = 0.0f;
+    transStartTime = GetHighResTime();
+
+    // Start loading right away, unless it's the screen fading out which must be unloaded first
+    transLoaded = 0;
+    transLoadThread = NULL;
+    if (screen != currentScreen) transLoadThread = StartThread(LoadScreenThread, (void*)(intptr_t)screen);
+}
+
+// Load the CPU side of a screen, on the loader thread or the main thread
+static void LoadScreenThread(void* arg)
+{
+    switch ((GameScreen)(intptr_t)arg)
+    {
+        case GAMEPLAY: LoadGameplayScreen(); break;
+        default: break;
+    }
+
+    AtomicFetchAdd(&transLoaded, 1);
+}
+
+// Upload a slice of a loaded screen's GPU resources, returns true once all are uploaded
+static bool UploadScreen(GameScreen screen)
+{
+    switch (screen)
+    {
+        case GAMEPLAY: return UploadGameplayScreen();
+        default: return true;
+    }
 }
 
 // Update transition effect (fade-in, fade-out)
 static void UpdateTransition(void)
 {
-    if (!transFadeOut)
+    if (!transFadeOut && currentScreen != UNKNOWN)
     {
         transAlpha += 0.05f;
 
@@ -180,21 +257,40 @@ static void UpdateTransition(void)
                 default: break;
             }
 
-            // Load next screen
-            switch (transToScreen)
-            {
-                case LOGO: InitLogoScreen(); break;
-                case TITLE: InitTitleScreen(); break;
-                case GAMEPLAY: InitGameplayScreen(); break;
-                case ENDING: InitEndingScreen(); break;
-                default: break;
-            }
+            // Hold on black, nothing to draw until the next screen is loaded
+            currentScreen = UNKNOWN;
+        }
+    }
+    else if (!transFadeOut)     // Hold until the next screen is loaded
+    {
+        if (transLoadThread)
+        {
+            if (AtomicFetchAdd(&transLoaded, 0) == 0) return;
+
+            JoinThread(transLoadThread);
+            transLoadThread = NULL;
+        }
+        else if (!transLoaded) LoadScreenThread((void*)(intptr_t)transToScreen);    // No loader thread, load in one go
 
-            currentScreen = transToScreen;
+        if (!UploadScreen(transToScreen)) return;
 
-            // Activate fade out effect to next loaded screen
-            transFadeOut = true;
+        // Init next screen, only the parts left after loading
+        switch (transToScreen)
+        {
+            case LOGO: InitLogoScreen(); break;
+            case TITLE: InitTitleScreen(); break;
+            case GAMEPLAY: InitGameplayScreen(); break;
+            case ENDING: InitEndingScreen(); break;
+            default: break;
         }
+
+        currentScreen = transToScreen;
+
+        // Assets only the old screen used are unreferenced now
+        TrimAssetCache();
+
+        // Activate fade out effect to next loaded screen
+        transFadeOut = true;
     }
     else  // Transition fade out logic
     {
@@ -202,6 +298,8 @@ static void UpdateTransition(void)
 
         if (transAlpha < -0.01f)
         {
+            TraceLog(LOG_INFO, "SCREEN: Transition took %.2f s, longest frame %.2f ms", GetHighResTime() - transStartTime, transLongestFrame);
+
             transAlpha = 0.0f;
             transFadeOut = false;
             onTransition = false;
@@ -220,9 +318,13 @@ static void DrawTransition(void)
 // Update and draw game frame
 static void UpdateDrawFrame(void)
 {
+    // Frames during a transition are timed up to EndDrawing(), which waits for the target frame rate
+    bool timeFrame = onTransition;
+    double frameStart = GetHighResTime();
+
     // Update
     //----------------------------------------------------------------------------------
-    UpdateMusicStream(music);       // NOTE: Music keeps playing between screens
+    UpdateStreamedMusic();          // NOTE: Only decodes here without threads, web builds
 
     if (!onTransition)
     {
@@ -292,6 +394,12 @@ static void UpdateDrawFrame(void)
 
         //DrawFPS(10, 10);
 
+        if (timeFrame)
+        {
+            float frameTime = (float)((GetHighResTime() - frameStart) * 1000.0);
+            if (frameTime > transLongestFrame) transLongestFrame = frameTime;
+        }
+
     EndDrawing();
     //----------------------------------------------------------------------------------
 }
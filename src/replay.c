@@ -0,0 +1,301 @@
+#include "replay.h"
+
+#include "raylib.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+void InitReplay(Replay* replay, unsigned long long worldHash, int tickRate)
+{
+	memset(replay, 0, sizeof(*replay));
+	replay->worldHash = worldHash;
+	replay->tickRate = tickRate;
+}
+
+
+void FreeReplay(Replay* replay)
+{
+	free(replay->tuning);
+	free(replay->inputs);
+	memset(replay, 0, sizeof(*replay));
+}
+
+
+bool AddReplayTuning(Replay* replay, const char* name, float value)
+{
+	ReplayTuningValue* tuning = realloc(replay->tuning, (replay->tuningCount + 1) * sizeof(ReplayTuningValue));
+	if (!tuning) return false;
+	replay->tuning = tuning;
+
+	ReplayTuningValue* entry = &tuning[replay->tuningCount++];
+	memset(entry, 0, sizeof(*entry));
+	strncpy(entry->name, name, REPLAY_MAX_NAME - 1);
+	entry->value = value;
+	return true;
+}
+
+
+bool GetReplayTuning(const Replay* replay, const char* name, float* value)
+{
+	for (int i = 0; i < replay->tuningCount; ++i)
+	{
+		if (strncmp(replay->tuning[i].name, name, REPLAY_MAX_NAME - 1) == 0)
+		{
+			*value = replay->tuning[i].value;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool AddReplayFrame(Replay* replay, unsigned char inputs)
+{
+	if (replay->frameCount >= REPLAY_MAX_FRAMES) return false;
+	if (replay->frameCount == replay->frameCapacity)
+	{
+		int capacity = replay->frameCapacity ? replay->frameCapacity * 2 : 4096;
+		unsigned char* frames = realloc(replay->inputs, capacity);
+		if (!frames) return false;
+		replay->inputs = frames;
+		replay->frameCapacity = capacity;
+	}
+
+	replay->inputs[replay->frameCount++] = inputs;
+	return true;
+}
+
+
+unsigned long long HashReplayData(const unsigned char* data, unsigned int size)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	for (unsigned int i = 0; i < size; ++i)
+	{
+		hash ^= data[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Serialization
+
+typedef struct ReplayWriter
+{
+	unsigned char* data;
+	unsigned int size;
+	unsigned int capacity;
+	bool failed;
+} ReplayWriter;
+
+static void WriteBytes(ReplayWriter* w, const void* bytes, unsigned int count)
+{
+	if (w->failed) return;
+	if (w->size + count > w->capacity)
+	{
+		unsigned int capacity = w->capacity ? w->capacity * 2 : 1024;
+		while (capacity < w->size + count) capacity *= 2;
+		unsigned char* data = realloc(w->data, capacity);
+		if (!data)
+		{
+			w->failed = true;
+			return;
+		}
+		w->data = data;
+		w->capacity = capacity;
+	}
+	memcpy(w->data + w->size, bytes, count);
+	w->size += count;
+}
+
+static void WriteU32(ReplayWriter* w, unsigned int value)
+{
+	unsigned char bytes[4] = { value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, (value >> 24) & 0xff };
+	WriteBytes(w, bytes, 4);
+}
+
+static void WriteVarint(ReplayWriter* w, unsigned int value)
+{
+	unsigned char bytes[5];
+	int n = 0;
+	while (value >= 0x80)
+	{
+		bytes[n++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	bytes[n++] = (unsigned char)value;
+	WriteBytes(w, bytes, n);
+}
+
+
+typedef struct ReplayReader
+{
+	const unsigned char* data;
+	unsigned int size;
+	unsigned int pos;
+	bool failed;
+} ReplayReader;
+
+static bool ReadBytes(ReplayReader* r, void* bytes, unsigned int count)
+{
+	if (r->failed || count > r->size - r->pos)
+	{
+		r->failed = true;
+		return false;
+	}
+	memcpy(bytes, r->data + r->pos, count);
+	r->pos += count;
+	return true;
+}
+
+static unsigned int ReadU32(ReplayReader* r)
+{
+	unsigned char bytes[4] = { 0 };
+	ReadBytes(r, bytes, 4);
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+}
+
+static unsigned int ReadVarint(ReplayReader* r)
+{
+	unsigned int value = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		unsigned char byte = 0;
+		if (!ReadBytes(r, &byte, 1)) return 0;
+		value |= (unsigned int)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) return value;
+	}
+	r->failed = true;
+	return 0;
+}
+
+
+bool SaveReplay(const char* fileName, const Replay* replay)
+{
+	ReplayWriter w = { 0 };
+
+	WriteBytes(&w, "RPLY", 4);
+	WriteU32(&w, REPLAY_VERSION);
+	WriteU32(&w, (unsigned int)(replay->worldHash & 0xffffffff));
+	WriteU32(&w, (unsigned int)(replay->worldHash >> 32));
+	WriteU32(&w, replay->tickRate);
+	WriteU32(&w, replay->frameCount);
+	WriteU32(&w, replay->tuningCount);
+
+	for (int i = 0; i < replay->tuningCount; ++i)
+	{
+		const ReplayTuningValue* entry = &replay->tuning[i];
+		unsigned char length = (unsigned char)strnlen(entry->name, REPLAY_MAX_NAME - 1);
+		unsigned int bits;
+		memcpy(&bits, &entry->value, sizeof(bits));
+
+		WriteBytes(&w, &length, 1);
+		WriteBytes(&w, entry->name, length);
+		WriteU32(&w, bits);
+	}
+
+	for (int i = 0; i < replay->frameCount; )
+	{
+		int run = 1;
+		while (i + run < replay->frameCount && replay->inputs[i + run] == replay->inputs[i]) run++;
+
+		WriteBytes(&w, &replay->inputs[i], 1);
+		WriteVarint(&w, run);
+		i += run;
+	}
+
+	bool saved = !w.failed && SaveFileData(fileName, w.data, w.size);
+	free(w.data);
+	return saved;
+}
+
+
+bool LoadReplay(const char* fileName, Replay* replay)
+{
+	memset(replay, 0, sizeof(*replay));
+
+	unsigned int size = 0;
+	unsigned char* data = LoadFileData(fileName, &size);
+	if (!data) return false;
+
+	ReplayReader r = { data, size, 0, false };
+
+	char magic[4] = { 0 };
+	ReadBytes(&r, magic, 4);
+	unsigned int version = ReadU32(&r);
+	if (r.failed || memcmp(magic, "RPLY", 4) != 0 || version < 1 || version > REPLAY_VERSION)
+	{
+		TraceLog(LOG_WARNING, "REPLAY: [%s] Not a replay file or unsupported version", fileName);
+		UnloadFileData(data);
+		return false;
+	}
+
+	unsigned long long hashLo = ReadU32(&r);
+	unsigned long long hashHi = ReadU32(&r);
+	unsigned int tickRate = (version >= 2) ? ReadU32(&r) : REPLAY_V1_TICK_RATE;
+	InitReplay(replay, hashLo | (hashHi << 32), (int)tickRate);
+
+	unsigned int frameCount = ReadU32(&r);
+	unsigned int tuningCount = ReadU32(&r);
+
+	// the count comes from the file, don't let it pick the allocation size or overflow an int
+	if (frameCount > REPLAY_MAX_FRAMES) r.failed = true;
+	if (tickRate == 0 || tickRate > INT_MAX) r.failed = true;
+
+	for (unsigned int i = 0; i < tuningCount && !r.failed; ++i)
+	{
+		unsigned char length = 0;
+		char name[REPLAY_MAX_NAME] = { 0 };
+		ReadBytes(&r, &length, 1);
+		if (length >= REPLAY_MAX_NAME)
+		{
+			r.failed = true;
+			break;
+		}
+		ReadBytes(&r, name, length);
+
+		unsigned int bits = ReadU32(&r);
+		float value;
+		memcpy(&value, &bits, sizeof(value));
+		if (!r.failed && !AddReplayTuning(replay, name, value)) r.failed = true;
+	}
+
+	// size the frames up front, a run can't claim more frames than the header promised
+	if (!r.failed && frameCount > 0)
+	{
+		replay->inputs = malloc(frameCount);
+		if (!replay->inputs) r.failed = true;
+		else replay->frameCapacity = frameCount;
+	}
+
+	while (!r.failed && (unsigned int)replay->frameCount < frameCount)
+	{
+		unsigned char inputs = 0;
+		ReadBytes(&r, &inputs, 1);
+		unsigned int run = ReadVarint(&r);
+		if (r.failed || run == 0 || run > frameCount - replay->frameCount)
+		{
+			r.failed = true;
+			break;
+		}
+
+		memset(&replay->inputs[replay->frameCount], inputs, run);
+		replay->frameCount += run;
+	}
+
+	UnloadFileData(data);
+
+	if (r.failed)
+	{
+		TraceLog(LOG_WARNING, "REPLAY: [%s] File is truncated or corrupt", fileName);
+		FreeReplay(replay);
+		return false;
+	}
+
+	TraceLog(LOG_INFO, "REPLAY: [%s] Loaded %d frames", fileName, replay->frameCount);
+	return true;
+}
@@ -0,0 +1,69 @@
+// Replay files.
+//
+// A replay stores everything needed to re-simulate a play session instead of the states
+// themselves: a hash of the world file, the tick rate, the tuning values in use and the
+// player input of every frame. Inputs are small bitmasks which rarely change between frames, so they are
+// stored run-length encoded and an hour of play takes a few tens of KB.
+//
+// File layout, little endian:
+//   "RPLY", u32 version, u64 world hash, u32 tick rate, u32 frame count, u32 tuning count,
+//   tuning count x (u8 name length, name, f32 value),
+//   runs of (u8 input bits, varint frame count) until frame count is reached
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+
+#define REPLAY_VERSION 2
+#define REPLAY_V1_TICK_RATE 60		// version 1 had no tick rate, its frames are all 60 Hz
+#define REPLAY_MAX_NAME 32
+#define REPLAY_MAX_FRAMES (60 * 60 * 60 * 24)	// a day at 60 Hz, longer recordings are refused
+
+typedef struct ReplayTuningValue
+{
+	char name[REPLAY_MAX_NAME];
+	float value;
+} ReplayTuningValue;
+
+typedef struct Replay
+{
+	unsigned long long worldHash;
+	int tickRate;				// frames per second
+	int tuningCount;
+	ReplayTuningValue* tuning;
+	int frameCount;
+	unsigned char* inputs;		// input bits of each frame, meaning is up to the game
+	int frameCapacity;
+} Replay;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+void InitReplay(Replay* replay, unsigned long long worldHash, int tickRate);
+void FreeReplay(Replay* replay);
+
+// Record a tuning value, names longer than REPLAY_MAX_NAME - 1 are cut off.
+bool AddReplayTuning(Replay* replay, const char* name, float value);
+
+// Look up a recorded tuning value, returns false if the replay doesn't have it.
+bool GetReplayTuning(const Replay* replay, const char* name, float* value);
+
+// Returns false once the replay holds REPLAY_MAX_FRAMES frames or if out of memory.
+bool AddReplayFrame(Replay* replay, unsigned char inputs);
+
+// Save/load through the raylib file callbacks. Load fails on bad or truncated files and
+// leaves the replay empty.
+bool SaveReplay(const char* fileName, const Replay* replay);
+bool LoadReplay(const char* fileName, Replay* replay);
+
+// 64-bit FNV-1a hash, used to check replays are played back on the world they were recorded in
+unsigned long long HashReplayData(const unsigned char* data, unsigned int size);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // REPLAY_H
@@ -27,200 +27,396 @@
 #include "screens.h"
 #include "ldtk.h"
 #include "raymath.h"
+#include "rlgl.h"
 #include "coll.h"
-
-#define RAYLIB_ASEPRITE_IMPLEMENTATION
-#include "raylib-aseprite.h"
+#include "level_render.h"
+#include "draw_list.h"
+#include "atlas.h"
+#include "state_history.h"
+#include "replay.h"
+#include "game_sim.h"
+#include "entities.h"
+#include "assets.h"
+#include "sys.h"
 
 #define RAYGUI_IMPLEMENTATION
 #include "external/raygui.h"
 
 #include <stdio.h>
 #include <float.h>
+#include <stdlib.h>
+#include <string.h>
 
 //----------------------------------------------------------------------------------
 // Module Variables Definition (local)
 //----------------------------------------------------------------------------------
+#define kWorldFileName "resources/WorldMap_GridVania_layout.ldtk"
+static Asset* gWorldAsset = NULL;
 static struct ldtk_world* gWorld = NULL;
-static Texture gWorldTextures[16] = { 0 };
-static Aseprite gWorldSprites[16] = { 0 };
 
+// hash of the world file, replays only reproduce on the world they were recorded in
+static unsigned long long gWorldHash = 0;
 
+// entities of the world's Entities layers, moved by StepGame
+static EntityStore gEntities = { 0 };
 
-//////////////////////////////////////////////////////////////////////////
-// Collision functions
+#define kReplayFileName "replay.rpl"
+
+// all tileset images of the world packed into atlas pages, tileset userdata points at a page
+#define kAtlasPageSize 2048
 
+// pages are uploaded this many rows at a time, 512 KB per slice for a full width page
+#define kAtlasUploadRows 64
 
-// callback function to determine the grid cell contents when used for collisions
-static int ldtk_grid_lookup(void* ctx, int x, int y)
+// level images and layer chunks baked while loading are uploaded about this much at a time,
+// mostly 256 KB chunks so it is a handful of textures
+#define kImageUploadBytes (2 * 1024 * 1024)
+
+// Everything prepared from the world for drawing it: the atlas pages, and the layer chunks
+// and level images in the world's userdata. Attached to the world asset, so it is prepared
+// once and kept with the world while the cache holds it.
+typedef struct WorldRenderData
 {
-	ldtk_layer_instance* inst = ctx;
-	int i = x + inst->cWid * y;
-	return inst->int_grid[i];
-}
+	struct ldtk_world* world;
+	TileSheet* atlasPages;
+	int atlasPageCount;
+	int uploadPage;				// next page and row UploadWorldAtlasSlice uploads
+	int uploadRow;
+	int uploadLevel;			// next level UploadWorldImagesSlice uploads
+
+	// tiles skipped because opaque tiles above hide them completely
+	int occludedTileCount;
+} WorldRenderData;
 
+static WorldRenderData* gRender = NULL;
 
-// iterate the ldtk world and raycast against each collision layer to find the closest collision
-coll_trace_hit_t ldtk_trace_ray(struct ldtk_world* world, Vector2 start, Vector2 end, int depth)
+// LoadGameplayScreen ran, see InitGameplayScreen
+static bool gLoaded = false;
+
+// draw static layers from baked chunk textures instead of tile by tile
+static bool gDrawBakedLayers = true;
+
+// overview of the whole depth in the screen corner, built from the smallest level images
+static bool gShowMinimap = true;
+#define kMinimapSize 200
+
+// what DrawLevels submitted last frame
+typedef struct LevelDrawStats
 {
-	coll_ray_t ray = {
-		.start_x = start.x,
-		.start_y = start.y,
-		.end_x = end.x,
-		.end_y = end.y
-	};
+	int levels;
+	int chunks;
+	int tiles;
+	int lods;
+} LevelDrawStats;
 
-	coll_trace_hit_t result = {
-		.dist = FLT_MAX
-	};
+static LevelDrawStats gLevelDrawStats = { 0 };
+
+// world space draw commands recorded each frame, sorted and batched on flush
+static DrawList gDrawList = { 0 };
 
-	// iterate all level instances and check which ones contain the bounding box
-	int count = ldtk_get_level_count(world);
+
+
+//----------------------------------------------------------------------------------
+// Gameplay Screen Functions Definition
+//----------------------------------------------------------------------------------
+
+// Load every tileset image of the world, pack them into atlas pages and move all tile
+// source rects into atlas space, so tilesets sharing a page draw without texture switches.
+// Only the CPU side, the pages are uploaded by UploadWorldAtlasSlice.
+static void LoadWorldAtlas(WorldRenderData* render)
+{
+	struct ldtk_world* world = render->world;
+	int count = ldtk_get_tileset_count(world);
+	if (count == 0) return;
+
+	// the images are cached, released again once packed
+	Asset** imageAssets = calloc(count, sizeof(Asset*));
+	Image* images = calloc(count, sizeof(Image));
+	AtlasPlacement* placements = calloc(count, sizeof(AtlasPlacement));
+	int* source = calloc(count, sizeof(int));
+	if (!imageAssets || !images || !placements || !source) goto atlas_done;
+
+	char texturePath[260];
 	for (int i = 0; i < count; ++i)
+	{
+		struct ldtk_tileset* tileset = ldtk_get_tileset(world, i);
+		source[i] = i;
+
+		// embedded tilesets (e.g. Internal_Icons) have no image
+		if (!tileset->relPath) continue;
+
+		// tilesets sharing an image file share its atlas space too
+		for (int j = 0; j < i; ++j)
+		{
+			const char* otherPath = ldtk_get_tileset(world, j)->relPath;
+			if (otherPath && strcmp(otherPath, tileset->relPath) == 0)
+			{
+				source[i] = j;
+				break;
+			}
+		}
+		if (source[i] != i) continue;
+
+		snprintf(texturePath, sizeof(texturePath), "resources/%s", tileset->relPath);
+		imageAssets[i] = AcquireAsset(AssetType_Image, texturePath);
+		if (imageAssets[i]) images[i] = imageAssets[i]->image;
+	}
+
+	Image* pages = NULL;
+	render->atlasPageCount = PackImageAtlas(images, count, kAtlasPageSize, 1, placements, &pages);
+	render->atlasPages = calloc(render->atlasPageCount ? render->atlasPageCount : 1, sizeof(TileSheet));
+	if (!pages || !render->atlasPages)
+	{
+		free(pages);
+		render->atlasPageCount = 0;
+		goto atlas_done;
+	}
+
+	// keep the CPU copy of every page, static layers are baked from it
+	for (int p = 0; p < render->atlasPageCount; ++p)
+	{
+		render->atlasPages[p].image = pages[p];
+	}
+	free(pages);
+
+	for (int i = 0; i < count; ++i)
+	{
+		const AtlasPlacement* at = &placements[source[i]];
+		if (at->page >= 0)
+		{
+			ldtk_get_tileset(world, i)->userdata = &render->atlasPages[at->page];
+		}
+	}
+
+	for (int i = 0; i < ldtk_get_level_count(world); ++i)
 	{
 		ldtk_level* level = ldtk_get_level(world, i);
-		if (level->worldDepth != depth) continue;
 		for (int j = 0; j < level->layer_instances_count; ++j)
 		{
 			ldtk_layer_instance* inst = &level->layer_instances[j];
-			if (inst->int_grid)
+			if (!inst->tileset) continue;
+
+			const AtlasPlacement* at = &placements[source[inst->tileset - ldtk_get_tileset(world, 0)]];
+			if (at->page < 0) continue;
+
+			for (int k = 0; k < inst->autotile_count; ++k)
 			{
-				coll_grid_t grid = {
-					.offset_x = (float)level->worldX + inst->px_offset_x,
-					.offset_y = (float)level->worldY + inst->px_offset_y,
-					.width = inst->cWid,
-					.height = inst->cHei,
-					.cell_size = (float)inst->grid_size,
-					.context = inst,
-					.cb_has_hit = ldtk_grid_lookup
-				};
-
-				coll_trace_hit_t hit;
-				if (coll_ray_grid(grid, ray, &hit))
-				{
-					if (hit.dist < result.dist)
-					{
-						result = hit;
-					}
-				}
+				inst->autotiles[k].src_x += at->x;
+				inst->autotiles[k].src_y += at->y;
+			}
+			for (int k = 0; k < inst->gridtile_count; ++k)
+			{
+				inst->gridtiles[k].src_x += at->x;
+				inst->gridtiles[k].src_y += at->y;
 			}
 		}
 	}
 
-	return result;
+	TraceLog(LOG_INFO, "ATLAS: Packed %d tilesets into %d page(s)", count, render->atlasPageCount);
+
+atlas_done:
+	if (imageAssets)
+	{
+		for (int i = 0; i < count; ++i) ReleaseAsset(imageAssets[i]);
+	}
+	free(imageAssets);
+	free(images);
+	free(placements);
+	free(source);
 }
 
 
-// iterate the ldtk world and raycast against each collision layer to find the closest collision
-coll_trace_hit_t ldtk_sweep_aabb(struct ldtk_world* world, coll_aabb_t aabb, Vector2 dir, int depth)
+// Upload the next kAtlasUploadRows rows of the atlas pages. Returns true once every page is
+// on the GPU.
+static bool UploadWorldAtlasSlice(WorldRenderData* render)
 {
-	coll_trace_hit_t result = {
-		.dist = FLT_MAX
-	};
+	if (render->uploadPage >= render->atlasPageCount) return true;
 
-	// iterate all level instances and check which ones contain the bounding box
-	int count = ldtk_get_level_count(world);
-	for (int i = 0; i < count; ++i)
+	TileSheet* page = &render->atlasPages[render->uploadPage];
+	if (page->texture.id == 0)
+	{
+		// allocated empty and filled in strips, so no single frame uploads a whole page
+		page->texture.id = rlLoadTexture(NULL, page->image.width, page->image.height, page->image.format, 1);
+		page->texture.width = page->image.width;
+		page->texture.height = page->image.height;
+		page->texture.mipmaps = 1;
+		page->texture.format = page->image.format;
+	}
+
+	int rows = page->image.height - render->uploadRow;
+	if (rows > kAtlasUploadRows) rows = kAtlasUploadRows;
+
+	const unsigned char* pixels = (const unsigned char*)page->image.data + (size_t)render->uploadRow * page->image.width * 4;
+	UpdateTextureRec(page->texture, (Rectangle) { 0.0f, (float)render->uploadRow, (float)page->image.width, (float)rows }, pixels);
+
+	render->uploadRow += rows;
+	if (render->uploadRow >= page->image.height)
+	{
+		render->uploadPage++;
+		render->uploadRow = 0;
+	}
+	return render->uploadPage >= render->atlasPageCount;
+}
+
+
+// Prepare the world for drawing: pack its tilesets, cull hidden tiles and set up the layer
+// chunks. The chunks and level images of the given depth are baked here, so the first frames
+// only upload them; other depths bake lazily the first time they are drawn. Only CPU work.
+static WorldRenderData* CreateWorldRenderData(struct ldtk_world* world, int depth)
+{
+	WorldRenderData* render = calloc(1, sizeof(WorldRenderData));
+	if (!render) return NULL;
+	render->world = world;
+
+	LoadWorldAtlas(render);
+
+	for (int i = 0; i < ldtk_get_level_count(world); ++i)
 	{
 		ldtk_level* level = ldtk_get_level(world, i);
-		if (level->worldDepth != depth) continue;
+		render->occludedTileCount += CullCoveredTiles(level);
+
 		for (int j = 0; j < level->layer_instances_count; ++j)
 		{
 			ldtk_layer_instance* inst = &level->layer_instances[j];
-			if (inst->int_grid)
+			if (inst->tileset && inst->tileset->userdata)
 			{
-				coll_grid_t grid = {
-					.offset_x = (float)level->worldX + inst->px_offset_x,
-					.offset_y = (float)level->worldY + inst->px_offset_y,
-					.width = inst->cWid,
-					.height = inst->cHei,
-					.cell_size = (float)inst->grid_size,
-					.context = inst,
-					.cb_has_hit = ldtk_grid_lookup
-				};
-
-				coll_trace_hit_t hit;
-				if (coll_sweep_aabb_grid(grid, aabb, dir.x, dir.y, &hit))
-				{
-					if (hit.dist < result.dist)
-					{
-						result = hit;
-					}
-				}
+				inst->userdata = CreateLayerChunks(inst);
+				if (level->worldDepth == depth) BakeLayerChunks(inst);
 			}
 		}
-	}
 
-	return result;
+		// the minimap shows every level of the depth right away
+		if (level->worldDepth == depth) level->userdata = BakeLevelLod(level);
+	}
+	return render;
 }
 
 
+// Upload the level images and layer chunks baked by CreateWorldRenderData, about
+// kImageUploadBytes per call. Returns true once everything is uploaded.
+static bool UploadWorldImagesSlice(WorldRenderData* render)
+{
+	size_t budget = kImageUploadBytes;
+	int count = ldtk_get_level_count(render->world);
+	for (; render->uploadLevel < count; render->uploadLevel++)
+	{
+		ldtk_level* level = ldtk_get_level(render->world, render->uploadLevel);
+		if (!UploadLevelLod(level->userdata, &budget)) return false;
 
-//----------------------------------------------------------------------------------
-// Gameplay Screen Functions Definition
-//----------------------------------------------------------------------------------
+		for (int j = 0; j < level->layer_instances_count; ++j)
+		{
+			if (!UploadLayerChunks(&level->layer_instances[j], &budget)) return false;
+		}
+	}
+	return true;
+}
 
-static void DrawTile(ldtk_layer_instance* inst, ldtk_tile* tile, Vector2 offset)
+
+// Attachment destructor of the world asset, runs before the world is destroyed
+static void DestroyWorldRenderData(void* data)
 {
-	if (inst->tileset == NULL) return;
+	WorldRenderData* render = data;
+	struct ldtk_world* world = render->world;
 
-	Rectangle src = { (float)tile->src_x, (float)tile->src_y, (float)inst->grid_size, (float)inst->grid_size };
-	Rectangle dst = { (float)tile->px_x + offset.x, (float)tile->px_y + offset.y, (float)inst->grid_size, (float)inst->grid_size };
+	for (int i = 0; i < ldtk_get_level_count(world); ++i)
+	{
+		ldtk_level* level = ldtk_get_level(world, i);
+		for (int j = 0; j < level->layer_instances_count; ++j)
+		{
+			DestroyLayerChunks(level->layer_instances[j].userdata);
+			level->layer_instances[j].userdata = NULL;
+		}
 
-	if (tile->f & 1)
+		DestroyLevelLod(level->userdata);
+		level->userdata = NULL;
+	}
+
+	for (int i = 0; i < ldtk_get_tileset_count(world); ++i)
 	{
-		// flip horizontally
-		src.width *= -1;
+		ldtk_get_tileset(world, i)->userdata = NULL;
 	}
-	if (tile->f & 2)
+
+	for (int i = 0; i < render->atlasPageCount; ++i)
 	{
-		// flip vertically
-		src.height *= -1;
+		if (render->atlasPages[i].texture.id != 0) UnloadTexture(render->atlasPages[i].texture);
+		UnloadImage(render->atlasPages[i].image);
 	}
+	free(render->atlasPages);
+	free(render);
+}
+
 
-	Texture tex = *(Texture*)inst->tileset->userdata;
-	DrawTexturePro(tex, src, dst, (Vector2) { 0.0f, 0.0f }, 0.0f, WHITE);
+// raylib backend for the draw list, called once per batch of commands
+static void SubmitDrawCommands(void* context, const DrawCommand* commands, int count)
+{
+	(void)context;
+
+	for (int i = 0; i < count; ++i)
+	{
+		const DrawCommand* cmd = &commands[i];
+		switch (cmd->type)
+		{
+		case DrawCommand_Texture:
+			DrawTexturePro(cmd->texture, cmd->src, cmd->dst, (Vector2) { 0.0f, 0.0f }, 0.0f, cmd->color);
+			break;
+		case DrawCommand_Rectangle:
+			DrawRectangleRec(cmd->dst, cmd->color);
+			break;
+		case DrawCommand_RectangleLines:
+			DrawRectangleLinesEx(cmd->dst, cmd->thick, cmd->color);
+			break;
+		case DrawCommand_Line:
+			DrawLineV((Vector2) { cmd->dst.x, cmd->dst.y }, (Vector2) { cmd->dst.width, cmd->dst.height }, cmd->color);
+			break;
+		}
+	}
 }
 
 
-void DrawLevels(int showDepth)
+// Record the levels at the given depth which are visible in the world space view rect.
+// Far enough out levels are drawn from their downsampled images instead of per layer.
+void DrawLevels(DrawList* list, int showDepth, Rectangle view, float zoom)
 {
-	// draw everything for now
+	gLevelDrawStats = (LevelDrawStats) { 0 };
 	if (!gWorld) return;
 
 	int count = ldtk_get_level_count(gWorld);
 	for (int i = 0; i < count; ++i)
 	{
 		ldtk_level* level = ldtk_get_level(gWorld, i);
+		if (level->worldDepth != showDepth) continue;
+
+		Rectangle levelRect = { (float)level->worldX, (float)level->worldY, (float)level->pxWid, (float)level->pxHei };
+		if (!CheckCollisionRecs(levelRect, view)) continue;
+
+		gLevelDrawStats.levels++;
+
+		if (zoom <= LEVEL_LOD_MAX_ZOOM)
+		{
+			int lods = DrawLevelLod(list, DRAW_LAYER_WORLD, level, zoom);
+			gLevelDrawStats.lods += lods;
+			if (lods > 0) continue;
+		}
 
 		// render layers back to front
 		for (int j = level->layer_instances_count-1; j >= 0 ; --j)
 		{
 			ldtk_layer_instance* inst = &level->layer_instances[j];
-			Texture* tex = NULL;
 
-			if (level->worldDepth != showDepth)
-				continue;
-
-			if (inst->tileset)
-			{
-				tex = (Texture*)inst->tileset->userdata;
-			}
+			// levels share their layer definitions and never overlap, so the same layer of
+			// every level can go in one sort layer and batch by texture
+			int layer = DRAW_LAYER_WORLD + (level->layer_instances_count - 1 - j);
 
 			Vector2 layerOffset = { (float)level->worldX + inst->px_offset_x, (float)level->worldY + inst->px_offset_y };
 
-			for (int k = 0; k < inst->autotile_count; ++k)
+			if (gDrawBakedLayers && inst->userdata)
 			{
-				ldtk_tile* tile = &inst->autotiles[k];
-				DrawTile(inst, tile, layerOffset);
+				gLevelDrawStats.chunks += DrawLayerChunks(list, layer, inst, layerOffset, view);
 			}
-
-			for (int k = 0; k < inst->gridtile_count; ++k)
+			else
 			{
-				ldtk_tile* tile = &inst->gridtiles[k];
-				DrawTile(inst, tile, layerOffset);
+				gLevelDrawStats.tiles += DrawLayerTiles(list, layer, inst, layerOffset, view);
 			}
-
 		}
 	}
 }
@@ -231,14 +427,6 @@ void DrawLevels(int showDepth)
 // Input
 
 
-typedef struct PlayerInput
-{
-	bool bMoveLeft;
-	bool bMoveRight;
-	bool bJump;
-} PlayerInput;
-
-
 PlayerInput GetPlayerInput()
 {
 	PlayerInput input;
@@ -280,324 +468,159 @@ PlayerInput GetPlayerInput()
 
 
 //////////////////////////////////////////////////////////////////////////
-// Player stuff
-
-typedef enum EPlayerJumpState
-{
-	PJS_None,
-	PJS_JumpAscending,
-	PJS_JumpApex,
-	PJS_Falling
-} EPlayerJumpState;
-
-typedef struct Player
-{
-	// runtime vars
-	Vector2 Location;
-	Vector2 Velocity;
-	int JumpCount;
-	EPlayerJumpState JumpState;
-	int JumpStateTime;
-	int NotGroundedTime;
-	bool bIsJumping;
-
-	// was Jump pressed last frame?
-	bool bJumpPrev;
-} Player;
-
+// Main loop
 
-typedef struct GameState
+typedef enum EStepMode
 {
-	Player Player;
-	PlayerInput Input;
-} GameState;
-
-
-
-//////////////////////////////////////////////////////////////////////////
-// some play related config variables - where best to keep these? in a struct?
-
-// player width
-static int gPlayerWidth = 12;
-// player height
-static int gPlayerHeight = 20;
-// max height of jump if player holds the jump button
-static float gPlayerJumpHeight = 32.0f;
-// how many frames to reach peak height?
-static float gPlayerJumpFrames = 20;
-// alternative to JumpFrames - pick a target distance (at max speed)
-static float gPlayerJumpDistance = 180.0f;
-
-// change jump gravity this much when falling (>1 for falling faster)
-static float gPlayerFallGravityScale = 1.0f;
-
-// change jump gravity this much when player releases jump early
-static float gPlayerJumpReleaseGravityScale = 4.0f;
-
-// how many frames to pause at the top of the jump
-static int gPlayerHangTimeFrames = 3;
-
-// 0 - no accel, 1 infinite accel
-static float gPlayerAccelX = 0.8f;
-// max speed pixels/frame
-static float gPlayerMaxSpeedX = 2.0f;
+	StepMode_Play,
+	StepMode_Paused,
+	StepMode_Replay,
+} EStepMode;
 
-// max speed pixels/frame
-static float gPlayerMaxFallSpeed = 10.0f;
 
-// 2 is double jump
-static int gPlayerMaxJumpCount = 2;
+// game state tracking, compressed with a full keyframe every second
+#define kGameStateKeyframeInterval 60
+// only the last minute stays in memory, older frames spill to disk
+#define kGameStateSpillFileName "timeline.spill"
+#define kGameStateResidentSegments 60
+static StateHistory gGameStates = { 0 };
+static GameState gCurrentState = { 0 };		// decoded copy of gCurrentFrame
+static int gCurrentFrame = 0;
+static EStepMode gStepMode = StepMode_Play;
+static bool gDebugUI_Timeline = false;
 
-// how many frames of coyote time
-static int gPlayerCoyoteTime = 3;
+// fixed timestep, the game ticks at the same rate whatever the render rate is, see SetSimTickRate
+static const int gSimTickRates[] = { 30, 60, 120, 144, 240 };	// F4 cycles through them
+#define kMaxCatchUpTicks 8					// per rendered frame, longer stalls slow the game down
+static double gSimAccumulator = 0.0;		// time not simulated yet, carried to the next frame
+static float gSimAlpha = 1.0f;				// where rendering is between gPreviousState and gCurrentState
+static int gSimTicksLastFrame = 0;
+static GameState gPreviousState = { 0 };	// state of the tick before gCurrentState, for interpolation
+static PlayerInput gLatchedInput = { 0 };	// inputs seen since the last tick, so taps between ticks count
 
-// track how high the player has jumped
-static float gStat_MaxHeight = 0.0f;
+// last input edit on the timeline
+static RollbackResult gLastRollback = { 0, -1 };
+static double gLastRollbackTime = 0.0;
 
 
-void UpdatePlayer(GameState* state)
+// Reset gamestates to initial conditions
+static void InitGameState()
 {
-	const PlayerInput* input = &state->Input;
-	Player* player = &state->Player;
-
-
-	// take off vertical speed
-	const float v0 = (-2.0f * gPlayerJumpHeight * gPlayerMaxFallSpeed) / gPlayerJumpDistance;
-	// gravity
-	const float G = (2.0f * gPlayerJumpHeight * (gPlayerMaxFallSpeed * gPlayerMaxFallSpeed)) / (gPlayerJumpDistance * gPlayerJumpDistance);
-
-	// transient downward force applied to the player (differs depending on certain conditions)
-	float g = G;
-
-	Vector2 posDelta = { 0 };
-
-	//////////////////////////////////////////////////////////////////////////
-	// horizontal movement
-	float targetSpeedX = 0.0f;
-	if (input->bMoveLeft)
-	{
-		targetSpeedX = -gPlayerMaxSpeedX;
-	}
-	else if (input->bMoveRight)
+	if (gGameStates.stateSize == 0)
 	{
-		targetSpeedX = gPlayerMaxSpeedX;
+		InitStateHistory(&gGameStates, sizeof(GameState), kGameStateKeyframeInterval);
+		if (!EnableStateHistorySpill(&gGameStates, kGameStateSpillFileName, kGameStateResidentSegments))
+		{
+			TraceLog(LOG_WARNING, "TIMELINE: Can't spill to [%s], the whole timeline stays in memory", kGameStateSpillFileName);
+		}
 	}
+	TruncateStateHistory(&gGameStates, 0);
 
-	// store desired delta of player position in X axis
-	posDelta.x = gPlayerAccelX * targetSpeedX + (1.0f - gPlayerAccelX) * player->Velocity.x;
-	player->Velocity.x = posDelta.x;
-
-
-	//////////////////////////////////////////////////////////////////////////
-	// vertical movement
-
-	float halfW = gPlayerWidth / 2.0f;
-	float halfH = gPlayerHeight / 2.0f;
-	coll_aabb_t playerAABB = {
-		player->Location.x, player->Location.y - halfH,
-		halfW, halfH
-	};
+	gCurrentState = GetInitialGameState();
+	gPreviousState = gCurrentState;
 
-	// check if player is on the ground
-	coll_trace_hit_t groundTrace = ldtk_sweep_aabb(gWorld, playerAABB, (Vector2){0, 1}, 0);
-	bool bIsGrounded = groundTrace.hit_value && groundTrace.dist == 0.0f;
+	PushState(&gGameStates, &gCurrentState);
+	gCurrentFrame = 0;
+	UpdateEntities(&gEntities, GetTuningFrame(gCurrentState.Frame, GetSimTickRate()));
+}
 
-	// TODO trace box down not just a ray...
 
-	if (bIsGrounded)
+// Move the timeline to an already recorded frame
+static void SetCurrentFrame(int frame)
+{
+	GameState previous = gCurrentState;
+	if (GetState(&gGameStates, frame, &gCurrentState))
 	{
-		player->bIsJumping = false;
-		player->JumpCount = 0;
-		player->JumpState = PJS_None;
-		player->JumpStateTime = 0;
-		player->NotGroundedTime = 0;
-		player->Velocity.y = 0.0f;
+		gCurrentFrame = frame;
+		gPreviousState = previous;
+		UpdateEntities(&gEntities, GetTuningFrame(gCurrentState.Frame, GetSimTickRate()));
 	}
-	else
-	{
-		player->NotGroundedTime++;
-		if (!player->bIsJumping && player->JumpState == 0)
-		{
-			// player walked off an edge?
-			//player->JumpCount = 1;
-			player->JumpState = PJS_Falling;
-		}
+}
 
-		// after N frames clear coyote time by setting JumpCount to 1
-		if (!player->bIsJumping && player->JumpState == 3 && player->JumpCount == 0)
-		{
-			if (player->NotGroundedTime > gPlayerCoyoteTime)
-			{
-				player->JumpCount = 1;
-			}
-		}
-	}
 
-	if (input->bJump && !player->bJumpPrev && player->JumpCount < gPlayerMaxJumpCount)
+// Record a new frame after the current one, dropping any frames which followed it. Nothing
+// changes if they can't be dropped, the timeline has to stay in step with the history.
+static void RecordGameState(GameState state)
+{
+	if (!TruncateStateHistory(&gGameStates, gCurrentFrame + 1)) return;
+	if (PushState(&gGameStates, &state))
 	{
-		// start jumping
-		player->bIsJumping = true;
-		player->JumpState = PJS_JumpAscending;
-		player->JumpStateTime = 0;
-		player->JumpCount++;
-
-		// apply initial impulse
-		player->Velocity.y = v0;
-
-		if (bIsGrounded)
-		{
-			// reset max height when we start jumping again
-			gStat_MaxHeight = 0;
-		}
+		gCurrentFrame++;
+		gPreviousState = gCurrentState;
+		gCurrentState = state;
 	}
+}
 
-	switch (player->JumpState)
-	{
-		// no jump
-	case PJS_None:
-		break;
 
-		// ascending
-	case PJS_JumpAscending:
-		if (player->Velocity.y > 0.0f)
-		{
-			// reached the peak
-			player->Velocity.y = 0.0f;
-			player->JumpState = PJS_JumpApex;
-			player->JumpStateTime = 0;
-		}
 
-		// if the player releases the button on the way up, slow them down quicker
-		if (!input->bJump)
-		{
-			g = G * gPlayerJumpReleaseGravityScale;
-		}
-		break;
-
-		// hang time
-	case PJS_JumpApex:
-		player->Velocity.y = 0.0f;
-		g = 0.0f;
 
-		// wait a few frames then move to falling state
-		if (player->JumpStateTime >= gPlayerHangTimeFrames)
-		{
-			player->JumpState = PJS_Falling;
-			player->JumpStateTime = 0;
-		}
-		break;
+// Save the inputs of the recorded timeline, frame 0 is the initial state and has none
+static void SaveGameReplay(const char* fileName)
+{
+	Replay replay;
+	InitReplay(&replay, gWorldHash, GetSimTickRate());
 
-		// falling
-	case PJS_Falling:
-		if (player->Velocity.y > 0.0f)
-		{
-			g = G * gPlayerFallGravityScale;
-		}
-		break;
+	for (int i = 0; i < gTuningVarCount; ++i)
+	{
+		const TuningVar* var = &gTuningVars[i];
+		AddReplayTuning(&replay, var->name, GetTuningValue(&gPlayerTuning, var));
 	}
 
-	player->JumpStateTime += 1;
-
-	posDelta.y = player->Velocity.y;// + (g / 2.0f);
-	player->Velocity.y += g;
-
-	// clamp to max speed
-	if (player->Velocity.y > gPlayerMaxFallSpeed)
+	GameState state;
+	for (int frame = 1; frame < gGameStates.count; ++frame)
 	{
-		player->Velocity.y = gPlayerMaxFallSpeed;
+		GetState(&gGameStates, frame, &state);
+		AddReplayFrame(&replay, PackPlayerInput(state.Input));
 	}
 
-	//////////////////////////////////////////////////////////////////////////
-	// Collide desired posDelta with the world
+	if (SaveReplay(fileName, &replay))
 	{
-		// Simple raycasts in the four directions.
-		// To improve this we could cast multiple rays, or make a shape cast function.
-
-		if (fabsf(posDelta.x) > 0.0f)
-		{
-			Vector2 playerOffset = { (float)gPlayerWidth / 2.0f, -2.0f };
-			if (posDelta.x < 0.0f) playerOffset.x *= -1.0f;
-			coll_trace_hit_t hit = ldtk_sweep_aabb(gWorld, playerAABB, (Vector2) { posDelta.x, 0 }, 0);
-			if (hit.hit_value)
-			{
-				posDelta.x = copysignf(hit.dist, posDelta.x);
-			}
-		}
-
-		if (fabsf(posDelta.y) > 0.0f)
-		{
-			Vector2 playerOffset = { 0 };
-			if (posDelta.y < 0.0f) playerOffset.y = (float) -gPlayerHeight;
-			Vector2 rayStart = Vector2Add(player->Location, playerOffset);
-			Vector2 rayEnd = Vector2Add(rayStart, (Vector2) { 0.0f, posDelta.y });
-			coll_trace_hit_t hit = ldtk_trace_ray(gWorld, rayStart, rayEnd, 0);
-			if (hit.hit_value)
-			{
-				posDelta.y = copysignf(hit.dist, posDelta.y);
-			}
-		}
+		TraceLog(LOG_INFO, "REPLAY: [%s] Saved %d frames", fileName, replay.frameCount);
 	}
-
-	//////////////////////////////////////////////////////////////////////////
-	// Move player according to desired delta
-	player->Location = Vector2Add(player->Location, posDelta);
-
-
-	// store if the player had Jump pressed this frame
-	player->bJumpPrev = input->bJump;
+	FreeReplay(&replay);
 }
 
 
-//////////////////////////////////////////////////////////////////////////
-
-
-static GameState StepGame(GameState state)
+// Rebuild the timeline by re-simulating a replay from the initial state, then play it back
+static void LoadGameReplay(const char* fileName)
 {
-	// start by copying the previous gamestate
-	GameState newState = state;
-
-	// update player
-	UpdatePlayer(&newState);
+	Replay replay;
+	if (!LoadReplay(fileName, &replay)) return;
 
-	// track some random stats...
-	if (gStat_MaxHeight > newState.Player.Location.y)
+	if (replay.worldHash != gWorldHash)
 	{
-		gStat_MaxHeight = newState.Player.Location.y;
+		TraceLog(LOG_WARNING, "REPLAY: [%s] Recorded on a different world, playback will diverge", fileName);
 	}
 
-	return newState;
-}
-
-
+	for (int i = 0; i < gTuningVarCount; ++i)
+	{
+		const TuningVar* var = &gTuningVars[i];
+		float value;
+		if (!GetReplayTuning(&replay, var->name, &value)) continue;
 
-//////////////////////////////////////////////////////////////////////////
-// Main loop
+		SetTuningValue(&gPlayerTuning, var, value);
+	}
 
-typedef enum EStepMode
-{
-	StepMode_Play,
-	StepMode_Paused,
-	StepMode_Replay,
-} EStepMode;
+	// the inputs only play back the same at the rate they were recorded at
+	SetSimTickRate(replay.tickRate);
+	if (GetSimTickRate() != replay.tickRate)
+	{
+		TraceLog(LOG_WARNING, "REPLAY: [%s] Recorded at %d Hz, playing at %d Hz will diverge", fileName, replay.tickRate, GetSimTickRate());
+	}
 
+	InitGameState();
 
-// game state tracking
-static int gCurrentFrame = 0;
-#define kMaxGameStates (60 * 60 * 10)	// 60 FPS * 60s * 10 = 10mins capacity (currently ~1.4mb)
-static GameState gGameStates[kMaxGameStates] = {0};
-static int gGameStateCount = 0;
-static EStepMode gStepMode = StepMode_Play;
-static bool gDebugUI_Timeline = false;
+	for (int frame = 0; frame < replay.frameCount; ++frame)
+	{
+		GameState state = gCurrentState;
+		state.Input = UnpackPlayerInput(replay.inputs[frame]);
+		RecordGameState(StepGame(state));
+	}
 
+	FreeReplay(&replay);
 
-// Reset gamestates to initial conditions
-static void InitGameState()
-{
-	memset(gGameStates, 0, sizeof(gGameStates[0]));
-	gGameStates[0].Player.Location = (Vector2){ 8 * 16, 4 * 16 };
-
-	gGameStateCount = 1;
-	gCurrentFrame = 0;
+	SetCurrentFrame(0);
+	gStepMode = StepMode_Replay;
 }
 
 
@@ -614,7 +637,7 @@ static void DrawDebugUI()
 	if (GuiButton((Rectangle) { x, y, iw, iw }, "#129#"))
 	{
 		gStepMode = StepMode_Paused;
-		gCurrentFrame = 0;
+		SetCurrentFrame(0);
 	}
 	// step backwards
 	if (GuiButton((Rectangle) { x += iw, y, iw, iw }, "#114#"))
@@ -622,28 +645,21 @@ static void DrawDebugUI()
 		gStepMode = StepMode_Paused;
 		if (gCurrentFrame > 0)
 		{
-			gCurrentFrame--;
+			SetCurrentFrame(gCurrentFrame - 1);
 		}
 	}
 	// step forwards
 	if (GuiButton((Rectangle) { x += iw, y, iw, iw }, "#115#"))
 	{
 		gStepMode = StepMode_Paused;
-		if (gCurrentFrame < (gGameStateCount - 1))
+		if (gCurrentFrame < (gGameStates.count - 1))
 		{
-			gCurrentFrame++;
+			SetCurrentFrame(gCurrentFrame + 1);
 		}
 		else
 		{
 			// create a new gamestate!
-			GameState gameState = StepGame(gGameStates[gCurrentFrame]);
-
-			if ((gCurrentFrame + 1) < kMaxGameStates)
-			{
-				gCurrentFrame++;
-				gGameStates[gCurrentFrame] = gameState;
-				gGameStateCount = gCurrentFrame + 1;
-			}
+			RecordGameState(StepGame(gCurrentState));
 		}
 	}
 	// pause
@@ -660,13 +676,24 @@ static void DrawDebugUI()
 	if (GuiButton((Rectangle) { x += iw, y, iw, iw }, "#134#"))
 	{
 		gStepMode = StepMode_Paused;
-		gCurrentFrame = gGameStateCount - 1;
+		SetCurrentFrame(gGameStates.count - 1);
 	}
 	// resume gameplay from here
 	if (GuiButton((Rectangle) { x += iw, y, iw, iw }, "#150#"))
 	{
 		gStepMode = StepMode_Play;
 	}
+	// save the timeline inputs as a replay
+	if (GuiButton((Rectangle) { x += iw, y, iw, iw }, "#6#"))
+	{
+		gStepMode = StepMode_Paused;
+		SaveGameReplay(kReplayFileName);
+	}
+	// load a replay and play it from the start
+	if (GuiButton((Rectangle) { x += iw, y, iw, iw }, "#5#"))
+	{
+		LoadGameReplay(kReplayFileName);
+	}
 	x += iw + 16;
 
 	switch (gStepMode)
@@ -679,18 +706,45 @@ static void DrawDebugUI()
 	GuiDrawText(frameTxt, (Rectangle) { x, y, 64, 32 }, TEXT_ALIGN_LEFT, RAYWHITE);
 	x += 64;
 
-	sprintf(frameTxt, "%d / %d", gCurrentFrame, gGameStateCount - 1);
+	sprintf(frameTxt, "%d / %d", gCurrentFrame, gGameStates.count - 1);
+	GuiDrawText(frameTxt, (Rectangle) { x, y, 64, 32 }, TEXT_ALIGN_LEFT, RAYWHITE);
+	x += 64;
+
+	sprintf(frameTxt, "%.1f KB", GetStateHistoryResidentSize(&gGameStates) / 1024.0f);
 	GuiDrawText(frameTxt, (Rectangle) { x, y, 64, 32 }, TEXT_ALIGN_LEFT, RAYWHITE);
+	sprintf(frameTxt, "%.1f KB disk", GetStateHistorySpillSize(&gGameStates) / 1024.0f);
+	GuiDrawText(frameTxt, (Rectangle) { x, y + 16, 64, 32 }, TEXT_ALIGN_LEFT, RAYWHITE);
 	x += 64;
 
 	// show player inputs
-	PlayerInput* input = &gGameStates[gCurrentFrame].Input;
+	PlayerInput input = gCurrentState.Input;
 	x += 16;
-	input->bJump = GuiCheckBox((Rectangle) { x, y, 16, 16 }, "Jump", input->bJump);
+	input.bJump = GuiCheckBox((Rectangle) { x, y, 16, 16 }, "Jump", input.bJump);
 	y += 16;
-	input->bMoveLeft = GuiCheckBox((Rectangle) { x, y, 16, 16 }, "Left", input->bMoveLeft);
+	input.bMoveLeft = GuiCheckBox((Rectangle) { x, y, 16, 16 }, "Left", input.bMoveLeft);
 	x += 48;
-	input->bMoveRight = GuiCheckBox((Rectangle) { x, y, 16, 16 }, "Right", input->bMoveRight);
+	input.bMoveRight = GuiCheckBox((Rectangle) { x, y, 16, 16 }, "Right", input.bMoveRight);
+
+	// editing an input rewrites the rest of the timeline from this frame
+	if (memcmp(&input, &gCurrentState.Input, sizeof(input)) != 0)
+	{
+		double start = GetHighResTime();
+		gLastRollback = RollbackInput(&gGameStates, gCurrentFrame, input);
+		gLastRollbackTime = GetHighResTime() - start;
+		GetState(&gGameStates, gCurrentFrame, &gCurrentState);
+		gPreviousState = gCurrentState;
+		UpdateEntities(&gEntities, GetTuningFrame(gCurrentState.Frame, GetSimTickRate()));
+	}
+
+	if (gLastRollback.convergedFrame >= 0)
+	{
+		sprintf(frameTxt, "Rollback: %d frames in %.2f ms, converged at %d", gLastRollback.frames, gLastRollbackTime * 1000.0, gLastRollback.convergedFrame);
+	}
+	else
+	{
+		sprintf(frameTxt, "Rollback: %d frames in %.2f ms", gLastRollback.frames, gLastRollbackTime * 1000.0);
+	}
+	GuiDrawText(frameTxt, (Rectangle) { x + 64, y, 320, 16 }, TEXT_ALIGN_LEFT, RAYWHITE);
 
 	// timeline slider allows scrubbing thru saved states
 	{
@@ -700,11 +754,11 @@ static void DrawDebugUI()
 			GuiSetState(STATE_DISABLED);
 		}
 
-		sprintf(frameTxt, "%d", gGameStateCount - 1);
-		float v = GuiSlider((Rectangle) { 128, (float)GetScreenHeight() - 32, (float)GetScreenWidth() - 256, 16 }, "0", frameTxt, (float)gCurrentFrame, 0.0f, (float)gGameStateCount);
-		if ((int)v != gCurrentFrame && (int)v < gGameStateCount)
+		sprintf(frameTxt, "%d", gGameStates.count - 1);
+		float v = GuiSlider((Rectangle) { 128, (float)GetScreenHeight() - 32, (float)GetScreenWidth() - 256, 16 }, "0", frameTxt, (float)gCurrentFrame, 0.0f, (float)gGameStates.count);
+		if ((int)v != gCurrentFrame && (int)v < gGameStates.count)
 		{
-			gCurrentFrame = (int)v;
+			SetCurrentFrame((int)v);
 		}
 
 		GuiSetState(STATE_NORMAL);
@@ -712,17 +766,47 @@ static void DrawDebugUI()
 }
 
 
-static void DrawPlayer(GameState state)
+static void DrawPlayer(DrawList* list, GameState state)
 {
-	int pw = gPlayerWidth;
-	int ph = gPlayerHeight;
+	int pw = gPlayerTuning.Width;
+	int ph = gPlayerTuning.Height;
 	int px = (int)state.Player.Location.x - (pw / 2);
 	int py = (int)state.Player.Location.y - ph;
-	DrawRectangle(px, py, pw, ph, RAYWHITE);
+	DrawListRectangle(list, DRAW_LAYER_PLAYER, (Rectangle) { (float)px, (float)py, (float)pw, (float)ph }, RAYWHITE);
+}
+
+
+static void DrawEntities(DrawList* list, int showDepth, Rectangle view)
+{
+	for (int i = 0; i < gEntities.count; ++i)
+	{
+		if (gEntities.depth[i] != showDepth) continue;
+
+		Rectangle rect = { gEntities.x[i], gEntities.y[i], gEntities.width[i], gEntities.height[i] };
+		if (!CheckCollisionRecs(rect, view)) continue;
+
+		DrawListRectangleLines(list, DRAW_LAYER_ENTITIES, rect, 1.0f, gEntities.color[i]);
+	}
+}
+
+
+// Identifier of the first entity overlapping the player, NULL if there is none
+static const char* GetTouchedEntityName(GameState state, int depth)
+{
+	Rectangle rect = {
+		state.Player.Location.x - gPlayerTuning.Width / 2,
+		state.Player.Location.y - gPlayerTuning.Height,
+		(float)gPlayerTuning.Width,
+		(float)gPlayerTuning.Height
+	};
+
+	int index;
+	if (QueryEntities(&gEntities, rect, depth, &index, 1) == 0) return NULL;
+	return (gEntities.kind[index] >= 0) ? gEntities.kinds[gEntities.kind[index]] : "?";
 }
 
 
-static void DrawTraceResult(Vector2 start, Vector2 end)
+static void DrawTraceResult(DrawList* list, Vector2 start, Vector2 end)
 {
 	// draw a line from start to end
 	// draw a line from start to hit
@@ -730,35 +814,35 @@ static void DrawTraceResult(Vector2 start, Vector2 end)
 
 	// invoke the function with debug draw enabled
 
-	coll_aabb_t aabb = {start.x, start.y, (float)gPlayerWidth / 2.0f, (float)gPlayerHeight / 2.0f};
+	coll_aabb_t aabb = {start.x, start.y, (float)gPlayerTuning.Width / 2.0f, (float)gPlayerTuning.Height / 2.0f};
 	Vector2 delta = Vector2Subtract(end, start);
 
 	coll_trace_hit_t hit = ldtk_sweep_aabb(gWorld, aabb, delta, 0);
 	if (hit.hit_value)
 	{
 		Vector2 hitPos = { hit.hit_pos_x, hit.hit_pos_y };
-		DrawLineV(start, hitPos, YELLOW);
-		DrawLineV(hitPos, end, RED);
+		DrawListLine(list, DRAW_LAYER_DEBUG, start, hitPos, YELLOW);
+		DrawListLine(list, DRAW_LAYER_DEBUG, hitPos, end, RED);
 
-		DrawRectangleLinesEx((Rectangle) {
+		DrawListRectangleLines(list, DRAW_LAYER_DEBUG, (Rectangle) {
 			aabb.x - aabb.half_w, aabb.y - aabb.half_h, aabb.half_w * 2, aabb.half_h * 2
 		}, 1.0f, YELLOW);
 
-		DrawRectangleLinesEx((Rectangle) {
+		DrawListRectangleLines(list, DRAW_LAYER_DEBUG, (Rectangle) {
 			hitPos.x - aabb.half_w, hitPos.y - aabb.half_h, aabb.half_w * 2, aabb.half_h * 2
 		}, 1.0f, RED);
 
 		float normalDisplayLength = 12.0f;
 		Vector2 normalRay = {hit.hit_normal_x * normalDisplayLength, hit.hit_normal_y * normalDisplayLength };
-		DrawLineV(hitPos, Vector2Add(hitPos, normalRay), GREEN);
+		DrawListLine(list, DRAW_LAYER_DEBUG, hitPos, Vector2Add(hitPos, normalRay), GREEN);
 	}
 	else
 	{
-		DrawLineV(start, end, YELLOW);
-		DrawRectangleLinesEx((Rectangle) {
+		DrawListLine(list, DRAW_LAYER_DEBUG, start, end, YELLOW);
+		DrawListRectangleLines(list, DRAW_LAYER_DEBUG, (Rectangle) {
 			aabb.x - aabb.half_w, aabb.y - aabb.half_h, aabb.half_w * 2, aabb.half_h * 2
 		}, 1.0f, YELLOW);
-		DrawRectangleLinesEx((Rectangle) {
+		DrawListRectangleLines(list, DRAW_LAYER_DEBUG, (Rectangle) {
 			end.x - aabb.half_w, end.y - aabb.half_h, aabb.half_w * 2, aabb.half_h * 2
 		}, 1.0f, YELLOW);
 	}
@@ -783,45 +867,71 @@ static Vector2 gMouseRayWorldStart = {0};
 static Vector2 gMouseRayWorldEnd = { 0 };
 static coll_trace_hit_t gMouseRayHit = {0};
 
-// Gameplay Screen Initialization logic
-void InitGameplayScreen(void)
+// Gameplay Screen loading: parse the world and decode its images, touches no GPU resources
+// so it can run on a loader thread while the previous screen fades out. Coming back to the
+// screen finds the world in the asset cache, prepared and uploaded already.
+void LoadGameplayScreen(void)
 {
-	// TODO: Initialize GAMEPLAY screen variables here!
-	framesCounter = 0;
-	finishScreen = 0;
+	gWorldAsset = AcquireAsset(AssetType_World, kWorldFileName);
+	gWorld = gWorldAsset ? gWorldAsset->world : NULL;
+	gWorldHash = gWorldAsset ? gWorldAsset->hash : 0;
 
-	gWorld = ldtk_load_world("resources/WorldMap_GridVania_layout.ldtk");
-
-	if (gWorld)
+	if (gWorld && !gWorldAsset->attachment)
 	{
-		// load textures for tilesets and store pointer in tileset userdata
-		char texturePath[260];
-		int count = ldtk_get_tileset_count(gWorld);
-		if (count > 16) count = 16;
-
-		for (int i = 0; i < count; ++i)
+		WorldRenderData* render = CreateWorldRenderData(gWorld, worldDepthToShow);
+		if (render)
 		{
-			struct ldtk_tileset* tileset = ldtk_get_tileset(gWorld, i);
-			sprintf(texturePath, "resources/%s", tileset->relPath);
-
-			if (strstr(texturePath, ".aseprite"))
-			{
-				gWorldSprites[i] = LoadAseprite(texturePath);
-				gWorldTextures[i] = GetAsepriteTexture(gWorldSprites[i]);
-				tileset->userdata = &gWorldTextures[i];
-			}
-			else
+			// the pages stay on the CPU besides being uploaded
+			size_t size = 0;
+			for (int i = 0; i < render->atlasPageCount; ++i)
 			{
-				gWorldTextures[i] = LoadTexture(texturePath);
-				tileset->userdata = &gWorldTextures[i];
+				size += (size_t)render->atlasPages[i].image.width * render->atlasPages[i].image.height * 4 * 2;
 			}
+			AttachAssetData(gWorldAsset, render, size, DestroyWorldRenderData);
 		}
 
-
 		// test collisions!
 		//WorldTrace(gWorld, (Vector2){ 128, 32 }, (Vector2) { 128, 512 });
 		//WorldTrace(gWorld, (Vector2) { 40, 40 }, (Vector2) { 228, 40 });
 	}
+	gRender = gWorldAsset ? gWorldAsset->attachment : NULL;
+
+	InitEntityStore(&gEntities);
+	if (gWorld) SpawnWorldEntities(&gEntities, gWorld);
+
+	gLoaded = true;
+}
+
+
+// Gameplay Screen upload: one slice of the GPU uploads, on the main thread after
+// LoadGameplayScreen. Returns true once everything is uploaded.
+bool UploadGameplayScreen(void)
+{
+	if (!gRender) return true;
+
+	// a slice of one or the other, so no frame uploads more than a slice
+	if (gRender->uploadPage < gRender->atlasPageCount)
+	{
+		UploadWorldAtlasSlice(gRender);
+		return false;
+	}
+	return UploadWorldImagesSlice(gRender);
+}
+
+
+// Gameplay Screen Initialization logic, loads synchronously unless the screen was loaded
+// ahead of time
+void InitGameplayScreen(void)
+{
+	// TODO: Initialize GAMEPLAY screen variables here!
+	framesCounter = 0;
+	finishScreen = 0;
+
+	if (!gLoaded) LoadGameplayScreen();
+	while (!UploadGameplayScreen()) {}
+
+	SetSimWorld(gWorld);
+	SetSimEntities(&gEntities);
 
 	// setup initial gamestate
 	InitGameState();
@@ -867,6 +977,26 @@ void UpdateGameplayScreen(void)
 		gDebugUI_Timeline = !gDebugUI_Timeline;
 	}
 
+	if (IsKeyPressed(KEY_F2))
+	{
+		gDrawBakedLayers = !gDrawBakedLayers;
+	}
+
+	if (IsKeyPressed(KEY_F3))
+	{
+		gShowMinimap = !gShowMinimap;
+	}
+
+	// the timeline holds frames of a single rate, so a new rate starts a new one
+	if (IsKeyPressed(KEY_F4))
+	{
+		int count = sizeof(gSimTickRates) / sizeof(gSimTickRates[0]);
+		int next = 0;
+		while (next < count && gSimTickRates[next] <= GetSimTickRate()) next++;
+		SetSimTickRate(gSimTickRates[next % count]);
+		InitGameState();
+	}
+
 	if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT))
 	{
 		if (!gMouseRightDown)
@@ -880,33 +1010,135 @@ void UpdateGameplayScreen(void)
 	}
 	gMouseRightDown = IsMouseButtonDown(MOUSE_BUTTON_RIGHT);
 
+	// hold on to anything pressed until the next tick consumes it
+	PlayerInput input = GetPlayerInput();
 	if (gStepMode == StepMode_Play)
 	{
-		GameState gameState = gGameStates[gCurrentFrame];
-		gameState.Input = GetPlayerInput();
-		gameState = StepGame(gameState);
+		gLatchedInput.bMoveLeft |= input.bMoveLeft;
+		gLatchedInput.bMoveRight |= input.bMoveRight;
+		gLatchedInput.bJump |= input.bJump;
+	}
+	else
+	{
+		gLatchedInput = input;
+	}
+
+	// run as many fixed ticks as the frame time covers, the remainder carries over
+	const double tick = 1.0 / GetSimTickRate();
+	bool ticking = (gStepMode == StepMode_Play || gStepMode == StepMode_Replay);
+	gSimAccumulator = ticking ? gSimAccumulator + GetFrameTime() : 0.0;
+	gSimTicksLastFrame = 0;
 
-		// store this gamestate!
-		if ((gCurrentFrame + 1) < kMaxGameStates)
+	while (gSimAccumulator >= tick && gSimTicksLastFrame < kMaxCatchUpTicks)
+	{
+		if (gStepMode == StepMode_Play)
+		{
+			GameState gameState = gCurrentState;
+			gameState.Input = gLatchedInput;
+			gameState = StepGame(gameState);
+
+			// store this gamestate!
+			RecordGameState(gameState);
+			gLatchedInput = input;
+		}
+		else if (gStepMode == StepMode_Replay)
 		{
-			gCurrentFrame++;
-			gGameStates[gCurrentFrame] = gameState;
-			gGameStateCount = gCurrentFrame + 1;
+			if (gCurrentFrame < gGameStates.count - 1)
+			{
+				SetCurrentFrame(gCurrentFrame + 1);
+			}
+			else
+			{
+				// stop when we reach the end
+				gStepMode = StepMode_Paused;
+				gSimAccumulator = 0.0;
+				break;
+			}
 		}
+
+		gSimAccumulator -= tick;
+		gSimTicksLastFrame++;
 	}
 
-	if (gStepMode == StepMode_Replay)
+	// after a stall too long to catch up on, drop the backlog instead of carrying it forward
+	if (gSimAccumulator >= tick)
 	{
-		if (gCurrentFrame < gGameStateCount)
-		{
-			gCurrentFrame++;
-		}
-		else
+		gSimAccumulator = fmod(gSimAccumulator, tick);
+	}
+
+	ticking = (gStepMode == StepMode_Play || gStepMode == StepMode_Replay);
+	gSimAlpha = ticking ? (float)(gSimAccumulator / tick) : 1.0f;
+}
+
+
+// Draw all levels of a depth scaled down into a screen space rect, with the camera view and
+// player location on top
+static void DrawMinimap(int showDepth, Rectangle view, Vector2 playerLocation)
+{
+	if (!gWorld) return;
+
+	// bounds of the depth in world space
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	int count = ldtk_get_level_count(gWorld);
+	for (int i = 0; i < count; ++i)
+	{
+		ldtk_level* level = ldtk_get_level(gWorld, i);
+		if (level->worldDepth != showDepth) continue;
+
+		minX = fminf(minX, (float)level->worldX);
+		minY = fminf(minY, (float)level->worldY);
+		maxX = fmaxf(maxX, (float)(level->worldX + level->pxWid));
+		maxY = fmaxf(maxY, (float)(level->worldY + level->pxHei));
+	}
+	if (maxX <= minX || maxY <= minY) return;
+
+	float scale = kMinimapSize / fmaxf(maxX - minX, maxY - minY);
+	Rectangle frame = { GetScreenWidth() - kMinimapSize - 10.0f, GetScreenHeight() - kMinimapSize - 10.0f, kMinimapSize, kMinimapSize };
+	frame.x += (kMinimapSize - (maxX - minX) * scale) * 0.5f;
+	frame.y += (kMinimapSize - (maxY - minY) * scale) * 0.5f;
+	frame.width = (maxX - minX) * scale;
+	frame.height = (maxY - minY) * scale;
+
+	DrawRectangleRec(frame, Fade(BLACK, 0.6f));
+
+	// the start depth is baked while loading, levels of other depths are baked one per frame
+	// so showing a new depth doesn't stall on all of them at once
+	bool baked = false;
+	for (int i = 0; i < count; ++i)
+	{
+		ldtk_level* level = ldtk_get_level(gWorld, i);
+		if (level->worldDepth != showDepth) continue;
+
+		if (!level->userdata)
 		{
-			// stop when we reach the end
-			gStepMode = StepMode_Paused;
+			if (baked) continue;
+			level->userdata = CreateLevelLod(level);
+			baked = true;
 		}
+		LevelLod* lod = level->userdata;
+		if (!lod) continue;
+
+		Rectangle dst = { frame.x + (level->worldX - minX) * scale, frame.y + (level->worldY - minY) * scale, level->pxWid * scale, level->pxHei * scale };
+
+		// smallest image that still has a texel per minimap pixel
+		int index = GetLevelLodIndex(scale);
+		while (index > 0 && lod->textures[index].id == 0) index--;
+		Texture texture = lod->textures[index];
+		if (texture.id == 0) continue;
+
+		float texelScale = (float)(1 << (index + 1));
+		Rectangle src = { 0.0f, 0.0f, level->pxWid / texelScale, level->pxHei / texelScale };
+		DrawTexturePro(texture, src, dst, (Vector2) { 0.0f, 0.0f }, 0.0f, WHITE);
 	}
+
+	Rectangle viewRect = { frame.x + (view.x - minX) * scale, frame.y + (view.y - minY) * scale, view.width * scale, view.height * scale };
+	BeginScissorMode((int)frame.x, (int)frame.y, (int)ceilf(frame.width), (int)ceilf(frame.height));
+		DrawRectangleLinesEx(viewRect, 1.0f, RAYWHITE);
+	EndScissorMode();
+	DrawRectangleLinesEx(frame, 1.0f, GRAY);
+
+	Vector2 player = { frame.x + (playerLocation.x - minX) * scale, frame.y + (playerLocation.y - minY) * scale };
+	DrawCircleV(player, 2.0f, RED);
 }
 
 
@@ -915,14 +1147,31 @@ void DrawGameplayScreen(void)
 {
 	DrawRectangle(0, 0, GetScreenWidth(), GetScreenHeight(), BLACK);
 
-	BeginMode2D(currentCamera);
-		DrawLevels(worldDepthToShow);
+	// world space rect covered by the screen, used to cull level drawing
+	Vector2 viewMin = GetScreenToWorld2D((Vector2) { 0.0f, 0.0f }, currentCamera);
+	Vector2 viewMax = GetScreenToWorld2D((Vector2) { (float)GetScreenWidth(), (float)GetScreenHeight() }, currentCamera);
+	Rectangle view = { viewMin.x, viewMin.y, viewMax.x - viewMin.x, viewMax.y - viewMin.y };
 
-		DrawPlayer(gGameStates[gCurrentFrame]);
+	ResetDrawList(&gDrawList, view);
+	DrawLevels(&gDrawList, worldDepthToShow, view, currentCamera.zoom);
+	// draw the player between the last two ticks, so motion is smooth at any render rate
+	GameState renderState = gCurrentState;
+	renderState.Player.Location = Vector2Lerp(gPreviousState.Player.Location, gCurrentState.Player.Location, gSimAlpha);
 
-		DrawTraceResult(gMouseRayWorldStart, gMouseRayWorldEnd);
+	DrawEntities(&gDrawList, worldDepthToShow, view);
+	DrawPlayer(&gDrawList, renderState);
+	DrawTraceResult(&gDrawList, gMouseRayWorldStart, gMouseRayWorldEnd);
+
+	BeginMode2D(currentCamera);
+		DrawBackend backend = { SubmitDrawCommands, NULL };
+		FlushDrawList(&gDrawList, &backend);
 	EndMode2D();
 
+	if (gShowMinimap)
+	{
+		DrawMinimap(worldDepthToShow, view, renderState.Player.Location);
+	}
+
 	DrawDebugUI();
 
     Vector2 pos = { 20, 10 };
@@ -931,6 +1180,18 @@ void DrawGameplayScreen(void)
 
 	DrawFPS(GetScreenWidth() - 100, 10);
 	DrawText(TextFormat("Height: %f", -gStat_MaxHeight), GetScreenWidth() - 200, 60, 10, RAYWHITE);
+	DrawText(TextFormat("Sim: %d Hz, %d ticks this frame", GetSimTickRate(), gSimTicksLastFrame), GetScreenWidth() - 200, 45, 10, RAYWHITE);
+	DrawText(TextFormat("Levels: %d Chunks: %d Tiles: %d Lods: %d", gLevelDrawStats.levels, gLevelDrawStats.chunks, gLevelDrawStats.tiles, gLevelDrawStats.lods), GetScreenWidth() - 200, 75, 10, RAYWHITE);
+	DrawText(TextFormat("Draws: %d Batches: %d Tex switches: %d Overdraw: %.2f", gDrawList.stats.commands, gDrawList.stats.batches, gDrawList.stats.textureSwitches, gDrawList.stats.overdraw), GetScreenWidth() - 300, 90, 10, RAYWHITE);
+	DrawText(TextFormat("Occluded tiles: %d", gRender ? gRender->occludedTileCount : 0), GetScreenWidth() - 200, 105, 10, RAYWHITE);
+
+	const char* touched = GetTouchedEntityName(gCurrentState, worldDepthToShow);
+	DrawText(TextFormat("Entities: %d Touching: %s", gEntities.count, touched ? touched : "-"), GetScreenWidth() - 200, 120, 10, RAYWHITE);
+	DrawText(TextFormat("Loading: longest frame %.1f ms", transLongestFrame), GetScreenWidth() - 200, 135, 10, RAYWHITE);
+
+	AssetCacheStats assets = GetAssetCacheStats();
+	DrawText(TextFormat("Assets: %d (%.1f / %.0f MB) Hits: %d Misses: %d Evictions: %d", assets.assets, assets.size / (1024.0f * 1024.0f),
+		assets.budget / (1024.0f * 1024.0f), assets.hits, assets.misses, assets.evictions), GetScreenWidth() - 300, 150, 10, RAYWHITE);
 }
 
 
@@ -939,13 +1200,19 @@ void UnloadGameplayScreen(void)
 {
     // TODO: Unload GAMEPLAY screen variables here!
 
-	for (int i = 0; i < 16; ++i)
-	{
-		UnloadTexture(gWorldTextures[i]);
-		UnloadAseprite(gWorldSprites[i]);
-	}
+	// the world stays cached with everything prepared for it, until the cache needs the room
+	SetSimWorld(NULL);
+	SetSimEntities(NULL);
+	FreeEntityStore(&gEntities);
+
+	ReleaseAsset(gWorldAsset);
+	gWorldAsset = NULL;
+	gWorld = NULL;
+	gRender = NULL;
 
-    ldtk_destroy_world(gWorld);
+	FreeDrawList(&gDrawList);
+	FreeStateHistory(&gGameStates);
+	gLoaded = false;
 }
 
 
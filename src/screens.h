@@ -36,8 +36,8 @@ typedef enum GameScreen { UNKNOWN = -1, LOGO = 0, TITLE, OPTIONS, GAMEPLAY, ENDI
 //----------------------------------------------------------------------------------
 extern GameScreen currentScreen;
 extern Font font;
-extern Music music;
 extern Sound fxCoin;
+extern float transLongestFrame;     // longest main thread frame of the last screen transition, in ms
 
 #ifdef __cplusplus
 extern "C" {            // Prevents name mangling of functions
@@ -73,6 +73,8 @@ int FinishOptionsScreen(void);
 //----------------------------------------------------------------------------------
 // Gameplay Screen Functions Declaration
 //----------------------------------------------------------------------------------
+void LoadGameplayScreen(void);      // CPU side of InitGameplayScreen, safe to call from a loader thread
+bool UploadGameplayScreen(void);    // GPU side in slices, call until it returns true
 void InitGameplayScreen(void);
 void UpdateGameplayScreen(void);
 void DrawGameplayScreen(void);
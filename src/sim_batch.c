@@ -0,0 +1,83 @@
+#include "sim_batch.h"
+#include "sys.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+void RunSimJob(struct ldtk_world* world, SimJob* job)
+{
+	SimContext sim = { &job->tuning, world, 0.0f, NULL, GetSimTickRate() };
+	GameState state = GetInitialGameState();
+
+	SimMetrics* metrics = &job->metrics;
+	memset(metrics, 0, sizeof(*metrics));
+	metrics->landingFrame = -1;
+
+	bool bAirborne = false;
+	float takeOffY = 0.0f;
+	float minY = 0.0f;
+
+	for (int i = 0; i < job->frameCount; ++i)
+	{
+		float prevY = state.Player.Location.y;
+		state.Input = UnpackPlayerInput(job->inputs[i]);
+		state = StepSim(&sim, state);
+
+		const Player* player = &state.Player;
+
+		// only a step which starts on the ground leaves NotGroundedTime at zero, so frame i
+		// stands on the ground
+		if (bAirborne && player->NotGroundedTime == 0)
+		{
+			bAirborne = false;
+			if (takeOffY - minY > metrics->maxJumpHeight) metrics->maxJumpHeight = takeOffY - minY;
+			if (metrics->landingFrame < 0) metrics->landingFrame = i;
+		}
+
+		// jumps enter the ascending state with their first frame counted
+		if (player->JumpState == PJS_JumpAscending && player->JumpStateTime == 1)
+		{
+			metrics->jumpCount++;
+			if (!bAirborne)
+			{
+				bAirborne = true;
+				takeOffY = prevY;
+				minY = prevY;
+			}
+		}
+
+		if (bAirborne && player->Location.y < minY) minY = player->Location.y;
+	}
+
+	// still in the air at the end, count the height reached so far
+	if (bAirborne && takeOffY - minY > metrics->maxJumpHeight) metrics->maxJumpHeight = takeOffY - minY;
+
+	metrics->distance = fabsf(state.Player.Location.x - GetInitialGameState().Player.Location.x);
+	metrics->finalState = state;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Workers
+
+typedef struct SimBatch
+{
+	struct ldtk_world* world;
+	SimJob* jobs;
+} SimBatch;
+
+static void RunSimBatchJob(void* udata, int index)
+{
+	SimBatch* batch = udata;
+	RunSimJob(batch->world, &batch->jobs[index]);
+}
+
+
+void RunSimBatch(struct ldtk_world* world, SimJob* jobs, int jobCount, int threadCount)
+{
+	SimBatch batch = { world, jobs };
+	ParallelFor(jobCount, RunSimBatchJob, &batch, threadCount);
+}
@@ -0,0 +1,48 @@
+// Batch simulation for tuning sweeps.
+//
+// Runs many independent simulations, each with its own tuning and inputs, and collects
+// movement metrics from every one of them. The simulations only share the world, which they
+// read, so they are spread over worker threads which each take the next job off a shared
+// counter until none are left. Every job steps the same way whichever thread runs it, so the
+// results don't depend on the thread count.
+
+#ifndef SIM_BATCH_H
+#define SIM_BATCH_H
+
+#include "game_sim.h"
+
+typedef struct SimMetrics
+{
+	float maxJumpHeight;		// pixels above the ground the player jumped off
+	float distance;				// horizontal pixels between the start and end locations
+	int jumpCount;				// jumps started, double jumps included
+	int landingFrame;			// first frame on the ground after a jump, -1 if it never landed
+	GameState finalState;
+} SimMetrics;
+
+typedef struct SimJob
+{
+	PlayerTuning tuning;
+	const unsigned char* inputs;	// input bits of each step, see PackPlayerInput
+	int frameCount;
+	SimMetrics metrics;				// filled in by RunSimBatch
+} SimJob;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Simulate a single job from GetInitialGameState on the calling thread, at the rate from
+// SetSimTickRate.
+void RunSimJob(struct ldtk_world* world, SimJob* job);
+
+// Simulate every job on threadCount threads including the calling one, 0 for one per
+// processor. Returns once all jobs are done.
+void RunSimBatch(struct ldtk_world* world, SimJob* jobs, int jobCount, int threadCount);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // SIM_BATCH_H
@@ -0,0 +1,788 @@
+#include "state_history.h"
+#include "lz.h"
+#include "sys.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+//////////////////////////////////////////////////////////////////////////
+// Delta encoding
+//
+// A delta is a sequence of (zero run, literal run, literal bytes) where the runs are
+// unsigned LEB128 varints and the literals are previous ^ current. It ends once the runs
+// add up to the state size.
+
+static bool ReserveSegment(StateHistorySegment* segment, int bytes)
+{
+	if (segment->size + bytes <= segment->capacity) return true;
+
+	int capacity = segment->capacity ? segment->capacity * 2 : 256;
+	while (capacity < segment->size + bytes) capacity *= 2;
+
+	unsigned char* data = realloc(segment->data, capacity);
+	if (!data) return false;
+	segment->data = data;
+	segment->capacity = capacity;
+	return true;
+}
+
+
+static int WriteVarint(unsigned char* out, unsigned int value)
+{
+	int n = 0;
+	while (value >= 0x80)
+	{
+		out[n++] = (unsigned char)(value | 0x80);
+		value >>= 7;
+	}
+	out[n++] = (unsigned char)value;
+	return n;
+}
+
+
+static unsigned int ReadVarint(const unsigned char* data, int* pos)
+{
+	unsigned int value = 0;
+	int shift = 0;
+	unsigned char byte;
+	do
+	{
+		byte = data[(*pos)++];
+		value |= (unsigned int)(byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	return value;
+}
+
+
+static bool EncodeDelta(StateHistorySegment* segment, const unsigned char* prev, const unsigned char* cur, int size)
+{
+	// runs are split by at least three equal bytes, so headers can't outgrow the literals
+	if (!ReserveSegment(segment, size * 3 + 16)) return false;
+
+	unsigned char* out = segment->data + segment->size;
+	int n = 0;
+	int i = 0;
+	while (i < size)
+	{
+		int zeroStart = i;
+		while (i < size && prev[i] == cur[i]) i++;
+		int zeros = i - zeroStart;
+
+		// short equal runs inside a literal cost more as a new run than as literals
+		int litStart = i;
+		while (i < size)
+		{
+			if (prev[i] != cur[i])
+			{
+				i++;
+				continue;
+			}
+			int j = i;
+			while (j < size && j - i < 3 && prev[j] == cur[j]) j++;
+			if (j - i >= 3 || j == size) break;
+			i = j;
+		}
+		int literals = i - litStart;
+
+		n += WriteVarint(&out[n], zeros);
+		n += WriteVarint(&out[n], literals);
+		for (int k = 0; k < literals; ++k)
+		{
+			out[n++] = prev[litStart + k] ^ cur[litStart + k];
+		}
+	}
+
+	segment->size += n;
+	return true;
+}
+
+
+// apply the delta at pos to state in place, returns the position after it
+static int DecodeDelta(const unsigned char* data, int pos, unsigned char* state, int size)
+{
+	int i = 0;
+	while (i < size)
+	{
+		i += (int)ReadVarint(data, &pos);
+		int literals = (int)ReadVarint(data, &pos);
+		for (int k = 0; k < literals; ++k)
+		{
+			state[i++] ^= data[pos++];
+		}
+	}
+	return pos;
+}
+
+
+// encode frames [first, first + frameCount) of a segment from raw states
+static bool EncodeSegment(StateHistory* history, StateHistorySegment* segment, const unsigned char* states, int frameCount)
+{
+	segment->size = 0;
+	if (frameCount <= 0) return true;
+	if (!ReserveSegment(segment, history->stateSize)) return false;
+
+	memcpy(segment->data, states, history->stateSize);
+	segment->size = history->stateSize;
+
+	for (int i = 1; i < frameCount; ++i)
+	{
+		const unsigned char* prev = states + (size_t)(i - 1) * history->stateSize;
+		if (!EncodeDelta(segment, prev, prev + history->stateSize, history->stateSize)) return false;
+	}
+	return true;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Spilling
+//
+// Only the game thread touches segments. It moves the data of a segment old enough to spill
+// into a job and queues that for the spill thread, the segment then reads from the job until
+// the spill thread hands it back written. Edits make a segment resident again and drop the
+// job's result when it comes back.
+
+typedef struct StateHistorySpillJob
+{
+	struct StateHistorySpillJob* next;
+	int segment;
+	unsigned char* data;		// the encoded segment, owned by the job
+	int size;
+	long long offset;			// set by the spill thread
+	int compressedSize;			// -1 if writing failed
+} StateHistorySpillJob;
+
+typedef struct StateHistorySpill
+{
+	char* fileName;
+
+	// shared with the spill thread, under mutex
+	SysMutex* mutex;
+	SysCondition* condition;
+	StateHistorySpillJob* queue;
+	StateHistorySpillJob* queueTail;
+	StateHistorySpillJob* done;
+	bool quit;
+
+	// spill thread only
+	SysThread* thread;
+	FILE* file;
+	long long fileSize;
+
+	// game thread only
+	int residentSegments;
+	int spillCursor;			// segments before it are spilled or being spilled
+	bool failed;				// stop spilling after a write error
+	size_t spilledBytes;
+	SysFileMap map;
+	unsigned char* scratch;		// decompressed copy of scratchSegment
+	int scratchCapacity;
+	int scratchSegment;
+} StateHistorySpill;
+
+
+static void SpillThread(void* arg)
+{
+	StateHistorySpill* spill = arg;
+	unsigned char* buffer = NULL;
+	int capacity = 0;
+
+	// after a short write the file position is past fileSize, so the offsets of later writes
+	// would be wrong. Stop writing and hand every later job back to stay in memory.
+	bool writeFailed = false;
+
+	LockSysMutex(spill->mutex);
+	for (;;)
+	{
+		while (!spill->queue && !spill->quit) WaitSysCondition(spill->condition, spill->mutex);
+		if (spill->quit) break;
+
+		StateHistorySpillJob* job = spill->queue;
+		spill->queue = job->next;
+		if (!spill->queue) spill->queueTail = NULL;
+		UnlockSysMutex(spill->mutex);
+
+		job->compressedSize = -1;
+		int bound = LzCompressBound(job->size);
+		if (bound > capacity)
+		{
+			unsigned char* grown = realloc(buffer, bound);
+			if (grown)
+			{
+				buffer = grown;
+				capacity = bound;
+			}
+		}
+		if (bound <= capacity && !writeFailed)
+		{
+			int size = LzCompress(job->data, job->size, buffer);
+			if (fwrite(buffer, 1, size, spill->file) == (size_t)size && fflush(spill->file) == 0)
+			{
+				job->offset = spill->fileSize;
+				job->compressedSize = size;
+				spill->fileSize += size;
+			}
+			else writeFailed = true;
+		}
+
+		LockSysMutex(spill->mutex);
+		job->next = spill->done;
+		spill->done = job;
+	}
+	UnlockSysMutex(spill->mutex);
+
+	free(buffer);
+}
+
+
+// take back the jobs the spill thread has finished
+static void CollectSpillJobs(StateHistory* history)
+{
+	StateHistorySpill* spill = history->spill;
+
+	LockSysMutex(spill->mutex);
+	StateHistorySpillJob* job = spill->done;
+	spill->done = NULL;
+	UnlockSysMutex(spill->mutex);
+
+	while (job)
+	{
+		StateHistorySpillJob* next = job->next;
+		StateHistorySegment* segment = &history->segments[job->segment];
+
+		// otherwise the segment was edited or dropped meanwhile and this copy is stale
+		if (segment->pending == job)
+		{
+			segment->pending = NULL;
+			if (job->compressedSize >= 0)
+			{
+				segment->spillOffset = job->offset;
+				segment->spillSize = job->compressedSize;
+				spill->spilledBytes += job->compressedSize;
+			}
+			else
+			{
+				// keep it in memory
+				segment->data = job->data;
+				segment->capacity = job->size;
+				job->data = NULL;
+				spill->failed = true;
+			}
+		}
+
+		free(job->data);
+		free(job);
+		job = next;
+	}
+}
+
+
+// queue the segments which fell out of the resident window
+static void SpillSegments(StateHistory* history)
+{
+	StateHistorySpill* spill = history->spill;
+	if (!spill) return;
+
+	CollectSpillJobs(history);
+	if (spill->failed) return;
+
+	// the segment being recorded into is never complete, so never spilled
+	int limit = history->count / history->keyframeInterval - spill->residentSegments;
+	if (spill->spillCursor >= limit) return;
+
+	StateHistorySpillJob* first = NULL;
+	StateHistorySpillJob* last = NULL;
+	for (int seg = spill->spillCursor; seg < limit; ++seg)
+	{
+		StateHistorySegment* segment = &history->segments[seg];
+		if (!segment->data) continue;
+
+		StateHistorySpillJob* job = calloc(1, sizeof(StateHistorySpillJob));
+		if (!job)
+		{
+			limit = seg;
+			break;
+		}
+		job->segment = seg;
+		job->data = segment->data;
+		job->size = segment->size;
+
+		segment->data = NULL;
+		segment->capacity = 0;
+		segment->pending = job;
+
+		if (last) last->next = job;
+		else first = job;
+		last = job;
+	}
+	spill->spillCursor = limit;
+
+	if (first)
+	{
+		LockSysMutex(spill->mutex);
+		if (spill->queueTail) spill->queueTail->next = first;
+		else spill->queue = first;
+		spill->queueTail = last;
+		SignalSysCondition(spill->condition);
+		UnlockSysMutex(spill->mutex);
+	}
+}
+
+
+// encoded bytes of a segment wherever it is, NULL if a spilled segment can't be read back
+static const unsigned char* ReadSegment(StateHistory* history, int seg)
+{
+	const StateHistorySegment* segment = &history->segments[seg];
+	if (segment->data) return segment->data;
+	if (segment->pending) return segment->pending->data;
+
+	StateHistorySpill* spill = history->spill;
+	if (spill->scratchSegment == seg) return spill->scratch;
+
+	// map again once the file has grown past the mapped part
+	if (!spill->map.data || segment->spillOffset + segment->spillSize > (long long)spill->map.size)
+	{
+		UnmapFile(&spill->map);
+		if (!MapFile(spill->fileName, &spill->map)) return NULL;
+		if (segment->spillOffset + segment->spillSize > (long long)spill->map.size) return NULL;
+	}
+
+	if (segment->size > spill->scratchCapacity)
+	{
+		unsigned char* scratch = realloc(spill->scratch, segment->size);
+		if (!scratch) return NULL;
+		spill->scratch = scratch;
+		spill->scratchCapacity = segment->size;
+	}
+
+	spill->scratchSegment = -1;
+	int size = LzDecompress(spill->map.data + segment->spillOffset, segment->spillSize, spill->scratch, segment->size);
+	if (size != segment->size) return NULL;
+
+	spill->scratchSegment = seg;
+	return spill->scratch;
+}
+
+
+// bring a segment back into memory before changing it
+static bool TouchSegment(StateHistory* history, int seg)
+{
+	StateHistorySegment* segment = &history->segments[seg];
+	if (segment->data) return true;
+
+	const unsigned char* encoded = ReadSegment(history, seg);
+	unsigned char* data = encoded ? malloc(segment->size) : NULL;
+	if (!data) return false;
+	memcpy(data, encoded, segment->size);
+
+	StateHistorySpill* spill = history->spill;
+	segment->data = data;
+	segment->capacity = segment->size;
+	segment->pending = NULL;
+	spill->spilledBytes -= segment->spillSize;
+	segment->spillSize = 0;
+	if (spill->scratchSegment == seg) spill->scratchSegment = -1;
+	if (spill->spillCursor > seg) spill->spillCursor = seg;
+	return true;
+}
+
+
+static void FreeStateHistorySpill(StateHistory* history)
+{
+	StateHistorySpill* spill = history->spill;
+	if (!spill) return;
+
+	StateHistorySpillJob* queued = NULL;
+	if (spill->thread)
+	{
+		LockSysMutex(spill->mutex);
+		queued = spill->queue;
+		spill->queue = NULL;
+		spill->quit = true;
+		SignalSysCondition(spill->condition);
+		UnlockSysMutex(spill->mutex);
+		JoinThread(spill->thread);
+	}
+
+	StateHistorySpillJob* lists[2] = { queued, spill->done };
+	for (int i = 0; i < 2; ++i)
+	{
+		StateHistorySpillJob* job = lists[i];
+		while (job)
+		{
+			StateHistorySpillJob* next = job->next;
+			free(job->data);
+			free(job);
+			job = next;
+		}
+	}
+
+	UnmapFile(&spill->map);
+	if (spill->file)
+	{
+		fclose(spill->file);
+		remove(spill->fileName);
+	}
+	DestroySysCondition(spill->condition);
+	DestroySysMutex(spill->mutex);
+	free(spill->scratch);
+	free(spill->fileName);
+	free(spill);
+	history->spill = NULL;
+}
+
+
+bool EnableStateHistorySpill(StateHistory* history, const char* fileName, int residentSegments)
+{
+	if (history->spill) return true;
+
+	StateHistorySpill* spill = calloc(1, sizeof(StateHistorySpill));
+	if (!spill) return false;
+	history->spill = spill;
+
+	spill->residentSegments = (residentSegments > 0) ? residentSegments : 1;
+	spill->scratchSegment = -1;
+	spill->fileName = malloc(strlen(fileName) + 1);
+	if (spill->fileName) strcpy(spill->fileName, fileName);
+	spill->mutex = CreateSysMutex();
+	spill->condition = CreateSysCondition();
+	spill->file = spill->fileName ? fopen(spill->fileName, "wb") : NULL;
+	if (spill->mutex && spill->condition && spill->file)
+	{
+		spill->thread = StartThread(SpillThread, spill);
+	}
+
+	if (!spill->thread)
+	{
+		FreeStateHistorySpill(history);
+		return false;
+	}
+
+	SpillSegments(history);
+	return true;
+}
+
+
+size_t GetStateHistoryResidentSize(const StateHistory* history)
+{
+	size_t size = 0;
+	int segmentCount = (history->count + history->keyframeInterval - 1) / history->keyframeInterval;
+	for (int i = 0; i < segmentCount; ++i)
+	{
+		if (history->segments[i].data || history->segments[i].pending) size += history->segments[i].size;
+	}
+	return size;
+}
+
+
+size_t GetStateHistorySpillSize(const StateHistory* history)
+{
+	return history->spill ? history->spill->spilledBytes : 0;
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// History
+
+bool InitStateHistory(StateHistory* history, int stateSize, int keyframeInterval)
+{
+	memset(history, 0, sizeof(*history));
+	history->stateSize = stateSize;
+	history->keyframeInterval = (keyframeInterval > 0) ? keyframeInterval : 1;
+	history->cacheFrame = -1;
+
+	history->last = calloc(1, stateSize);
+	history->cache = calloc(1, stateSize);
+	if (!history->last || !history->cache)
+	{
+		FreeStateHistory(history);
+		return false;
+	}
+	return true;
+}
+
+
+void FreeStateHistory(StateHistory* history)
+{
+	FreeStateHistorySpill(history);
+	for (int i = 0; i < history->segmentCapacity; ++i)
+	{
+		free(history->segments[i].data);
+	}
+	free(history->segments);
+	free(history->last);
+	free(history->cache);
+	memset(history, 0, sizeof(*history));
+	history->cacheFrame = -1;
+}
+
+
+bool TruncateStateHistory(StateHistory* history, int count)
+{
+	if (count < 0) count = 0;
+	if (count >= history->count) return true;
+
+	int interval = history->keyframeInterval;
+	int segmentCount = (count + interval - 1) / interval;
+
+	// cut the last kept segment after frame count - 1, leaving `last` holding that frame
+	if (count > 0)
+	{
+		int seg = (count - 1) / interval;
+		if (history->spill && !TouchSegment(history, seg)) return false;
+
+		StateHistorySegment* segment = &history->segments[seg];
+		memcpy(history->last, segment->data, history->stateSize);
+		int pos = history->stateSize;
+		for (int f = seg * interval + 1; f < count; ++f)
+		{
+			pos = DecodeDelta(segment->data, pos, history->last, history->stateSize);
+		}
+		segment->size = pos;
+	}
+
+	for (int i = segmentCount; i < (history->count + interval - 1) / interval; ++i)
+	{
+		StateHistorySegment* segment = &history->segments[i];
+		segment->size = 0;
+		if (history->spill && !segment->data)
+		{
+			// a pending write is dropped when it comes back
+			history->spill->spilledBytes -= segment->spillSize;
+			segment->pending = NULL;
+			segment->spillSize = 0;
+			if (history->spill->scratchSegment == i) history->spill->scratchSegment = -1;
+		}
+	}
+
+	history->count = count;
+	if (history->cacheFrame >= count) history->cacheFrame = -1;
+	if (history->spill && history->spill->spillCursor > segmentCount) history->spill->spillCursor = segmentCount;
+	return true;
+}
+
+
+bool PushState(StateHistory* history, const void* state)
+{
+	int interval = history->keyframeInterval;
+	int seg = history->count / interval;
+
+	if (seg >= history->segmentCapacity)
+	{
+		int capacity = history->segmentCapacity ? history->segmentCapacity * 2 : 64;
+		StateHistorySegment* segments = realloc(history->segments, capacity * sizeof(StateHistorySegment));
+		if (!segments) return false;
+		memset(&segments[history->segmentCapacity], 0, (capacity - history->segmentCapacity) * sizeof(StateHistorySegment));
+		history->segments = segments;
+		history->segmentCapacity = capacity;
+	}
+
+	StateHistorySegment* segment = &history->segments[seg];
+	if (history->count % interval == 0)
+	{
+		if (!ReserveSegment(segment, history->stateSize)) return false;
+		memcpy(segment->data, state, history->stateSize);
+		segment->size = history->stateSize;
+	}
+	else if (!EncodeDelta(segment, history->last, state, history->stateSize))
+	{
+		return false;
+	}
+
+	memcpy(history->last, state, history->stateSize);
+	history->count++;
+
+	SpillSegments(history);
+	return true;
+}
+
+
+bool GetState(StateHistory* history, int frame, void* state)
+{
+	if (frame < 0 || frame >= history->count) return false;
+
+	if (frame == history->count - 1)
+	{
+		memcpy(state, history->last, history->stateSize);
+		return true;
+	}
+
+	int interval = history->keyframeInterval;
+	int seg = frame / interval;
+	const unsigned char* data = ReadSegment(history, seg);
+	if (!data) return false;
+
+	// continue from the cached frame when it's earlier in the same segment
+	int f;
+	int pos;
+	if (history->cacheFrame >= 0 && history->cacheFrame <= frame && history->cacheFrame / interval == seg)
+	{
+		f = history->cacheFrame;
+		pos = history->cachePos;
+	}
+	else
+	{
+		memcpy(history->cache, data, history->stateSize);
+		f = seg * interval;
+		pos = history->stateSize;
+	}
+
+	for (; f < frame; ++f)
+	{
+		pos = DecodeDelta(data, pos, history->cache, history->stateSize);
+	}
+
+	history->cacheFrame = frame;
+	history->cachePos = pos;
+	memcpy(state, history->cache, history->stateSize);
+	return true;
+}
+
+
+// frames in a segment and its first frame
+static int GetSegmentFrames(const StateHistory* history, int seg, int* first)
+{
+	*first = seg * history->keyframeInterval;
+	int frameCount = history->count - *first;
+	return (frameCount > history->keyframeInterval) ? history->keyframeInterval : frameCount;
+}
+
+
+// decode every frame of a segment into consecutive raw states
+static void DecodeSegment(const StateHistory* history, const unsigned char* data, unsigned char* states, int frameCount)
+{
+	memcpy(states, data, history->stateSize);
+	int pos = history->stateSize;
+	for (int i = 1; i < frameCount; ++i)
+	{
+		unsigned char* cur = states + (size_t)i * history->stateSize;
+		memcpy(cur, cur - history->stateSize, history->stateSize);
+		pos = DecodeDelta(data, pos, cur, history->stateSize);
+	}
+}
+
+
+bool SetState(StateHistory* history, int frame, const void* state)
+{
+	if (frame < 0 || frame >= history->count) return false;
+
+	int seg = frame / history->keyframeInterval;
+	int first;
+	int frameCount = GetSegmentFrames(history, seg, &first);
+	if (history->spill && !TouchSegment(history, seg)) return false;
+
+	// decode the whole segment, patch the frame and encode it again
+	unsigned char* states = malloc((size_t)frameCount * history->stateSize);
+	if (!states) return false;
+
+	StateHistorySegment* segment = &history->segments[seg];
+	DecodeSegment(history, segment->data, states, frameCount);
+
+	memcpy(states + (size_t)(frame - first) * history->stateSize, state, history->stateSize);
+	bool ok = EncodeSegment(history, segment, states, frameCount);
+	free(states);
+
+	if (frame == history->count - 1)
+	{
+		memcpy(history->last, state, history->stateSize);
+	}
+	history->cacheFrame = -1;
+
+	SpillSegments(history);
+	return ok;
+}
+
+
+int ResimulateStateHistory(StateHistory* history, int frame, const void* state, StateStepCallback step, void* context, int* convergedFrame)
+{
+	if (convergedFrame) *convergedFrame = -1;
+	if (frame < 0 || frame >= history->count) return 0;
+
+	int size = history->stateSize;
+	unsigned char* states = malloc((size_t)history->keyframeInterval * size);
+	unsigned char* prev = malloc(size);
+	unsigned char* next = malloc(size);
+	if (!states || !prev || !next)
+	{
+		free(states);
+		free(prev);
+		free(next);
+		return 0;
+	}
+
+	// work a segment at a time: decode it, step through its frames and encode it again
+	int resimulated = 0;
+	int converged = -1;
+	bool failed = false;
+	for (int seg = frame / history->keyframeInterval; converged < 0 && seg * history->keyframeInterval < history->count; ++seg)
+	{
+		if (history->spill && !TouchSegment(history, seg))
+		{
+			failed = true;
+			break;
+		}
+
+		int first;
+		int frameCount = GetSegmentFrames(history, seg, &first);
+		StateHistorySegment* segment = &history->segments[seg];
+		DecodeSegment(history, segment->data, states, frameCount);
+
+		for (int i = (frame > first) ? frame - first : 0; i < frameCount; ++i)
+		{
+			unsigned char* cur = states + (size_t)i * size;
+			if (first + i == frame)
+			{
+				memcpy(cur, state, size);
+			}
+			else
+			{
+				step(context, prev, cur, next);
+
+				// same state as recorded, so every later frame is unchanged too
+				if (memcmp(next, cur, size) == 0)
+				{
+					converged = first + i;
+					break;
+				}
+				memcpy(cur, next, size);
+				resimulated++;
+			}
+			memcpy(prev, cur, size);
+		}
+
+		EncodeSegment(history, segment, states, frameCount);
+
+		// long re-simulations spill as they go
+		SpillSegments(history);
+	}
+
+	// ran off the end, prev holds the new last frame
+	if (converged < 0 && !failed)
+	{
+		memcpy(history->last, prev, size);
+	}
+	history->cacheFrame = -1;
+
+	free(states);
+	free(prev);
+	free(next);
+
+	if (convergedFrame) *convergedFrame = converged;
+	return resimulated;
+}
+
+
+size_t GetStateHistorySize(const StateHistory* history)
+{
+	size_t size = 0;
+	int segmentCount = (history->count + history->keyframeInterval - 1) / history->keyframeInterval;
+	for (int i = 0; i < segmentCount; ++i)
+	{
+		size += history->segments[i].size;
+	}
+	return size;
+}
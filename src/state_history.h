@@ -0,0 +1,101 @@
+// Compressed history of fixed size game states.
+//
+// Every keyframeInterval frames a full copy of the state is stored, the frames in between
+// only store the XOR against the previous frame as varint encoded runs of changed bytes.
+// Consecutive states differ in a handful of bytes, so most frames cost a few bytes.
+//
+// Reading a frame decodes its keyframe and applies at most keyframeInterval - 1 deltas.
+// The last decoded frame is cached, so stepping forwards only applies a single delta.
+//
+// For long sessions the history can spill to disk: once a segment is older than the newest
+// residentSegments it is handed to a background thread, which LZ compresses it and appends
+// it to the spill file. Reading a spilled segment maps the file and decompresses it, editing
+// one brings it back into memory until it is old enough to spill again.
+
+#ifndef STATE_HISTORY_H
+#define STATE_HISTORY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct StateHistorySpill;
+struct StateHistorySpillJob;
+
+// a keyframe and the deltas following it
+typedef struct StateHistorySegment
+{
+	unsigned char* data;						// NULL while spilled or being spilled
+	int size;									// encoded size, also while spilled
+	int capacity;
+
+	struct StateHistorySpillJob* pending;		// set while the spill thread writes it
+	long long spillOffset;						// of the compressed segment in the spill file
+	int spillSize;								// 0 unless spilled
+} StateHistorySegment;
+
+// Produce the state following previous. recorded is the state stored for that frame before
+// re-simulating, for inputs which must be kept.
+typedef void (*StateStepCallback)(void* context, const void* previous, const void* recorded, void* next);
+
+typedef struct StateHistory
+{
+	int stateSize;
+	int keyframeInterval;
+	int count;							// number of recorded frames
+
+	StateHistorySegment* segments;		// one per keyframeInterval frames
+	int segmentCapacity;
+
+	unsigned char* last;				// copy of frame count - 1, new deltas are taken against it
+	unsigned char* cache;				// copy of frame cacheFrame
+	int cacheFrame;						// -1 when the cache is empty
+	int cachePos;						// offset of the delta after cacheFrame in its segment
+
+	struct StateHistorySpill* spill;	// NULL unless spilling to disk
+} StateHistory;
+
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+bool InitStateHistory(StateHistory* history, int stateSize, int keyframeInterval);
+void FreeStateHistory(StateHistory* history);
+
+// Drop all frames from count onwards. Returns false, keeping every frame, if the segment to
+// cut can't be read back from the spill file or out of memory.
+bool TruncateStateHistory(StateHistory* history, int count);
+
+// Append a frame. Returns false if out of memory.
+bool PushState(StateHistory* history, const void* state);
+
+// Decode a frame into state. Returns false if frame is out of range.
+bool GetState(StateHistory* history, int frame, void* state);
+
+// Overwrite an already recorded frame, re-encoding its segment. Later frames keep their
+// contents. Returns false if frame is out of range or out of memory.
+bool SetState(StateHistory* history, int frame, const void* state);
+
+// Replace a frame and re-simulate the frames after it with step, rewriting the history as it
+// goes. Stops once a step reproduces the recorded state, as every later frame then matches
+// too, and stores that frame in convergedFrame (-1 if it ran to the end). Returns the
+// number of frames re-simulated.
+int ResimulateStateHistory(StateHistory* history, int frame, const void* state, StateStepCallback step, void* context, int* convergedFrame);
+
+// Encoded bytes of all recorded frames.
+size_t GetStateHistorySize(const StateHistory* history);
+
+// Spill segments older than the newest residentSegments to fileName, which is replaced and
+// deleted again by FreeStateHistory. Returns false if the file or the spill thread can't be
+// created, the history then stays in memory.
+bool EnableStateHistorySpill(StateHistory* history, const char* fileName, int residentSegments);
+
+// Encoded bytes held in memory, and compressed bytes in the spill file.
+size_t GetStateHistoryResidentSize(const StateHistory* history);
+size_t GetStateHistorySpillSize(const StateHistory* history);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // STATE_HISTORY_H
@@ -0,0 +1,494 @@
+#include "sys.h"
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <pthread.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <time.h>
+	#include <unistd.h>
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// emscripten only has threads when built with -pthread
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+	#define SYS_NO_THREADS
+#endif
+
+
+double GetHighResTime(void)
+{
+#if defined(_WIN32)
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+
+void SleepSeconds(double seconds)
+{
+	if (seconds <= 0.0) return;
+#if defined(_WIN32)
+	Sleep((DWORD)(seconds * 1e3));
+#else
+	struct timespec ts;
+	ts.tv_sec = (time_t)seconds;
+	ts.tv_nsec = (long)((seconds - (double)ts.tv_sec) * 1e9);
+	nanosleep(&ts, NULL);
+#endif
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Threads
+
+struct SysThread
+{
+#if defined(_WIN32)
+	HANDLE handle;
+#elif !defined(SYS_NO_THREADS)
+	pthread_t handle;
+#endif
+	SysThreadFunc func;
+	void* arg;
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI ThreadMain(LPVOID param)
+{
+	SysThread* thread = param;
+	thread->func(thread->arg);
+	return 0;
+}
+#elif !defined(SYS_NO_THREADS)
+static void* ThreadMain(void* param)
+{
+	SysThread* thread = param;
+	thread->func(thread->arg);
+	return NULL;
+}
+#endif
+
+
+SysThread* StartThread(SysThreadFunc func, void* arg)
+{
+#if defined(SYS_NO_THREADS)
+	(void)func;
+	(void)arg;
+	return NULL;
+#else
+	SysThread* thread = malloc(sizeof(SysThread));
+	if (!thread) return NULL;
+	thread->func = func;
+	thread->arg = arg;
+
+#if defined(_WIN32)
+	thread->handle = CreateThread(NULL, 0, ThreadMain, thread, 0, NULL);
+	if (!thread->handle)
+#else
+	if (pthread_create(&thread->handle, NULL, ThreadMain, thread) != 0)
+#endif
+	{
+		free(thread);
+		return NULL;
+	}
+	return thread;
+#endif
+}
+
+
+void JoinThread(SysThread* thread)
+{
+	if (!thread) return;
+#if defined(_WIN32)
+	WaitForSingleObject(thread->handle, INFINITE);
+	CloseHandle(thread->handle);
+#elif !defined(SYS_NO_THREADS)
+	pthread_join(thread->handle, NULL);
+#endif
+	free(thread);
+}
+
+
+int GetProcessorCount(void)
+{
+#if defined(_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (info.dwNumberOfProcessors > 0) ? (int)info.dwNumberOfProcessors : 1;
+#elif defined(SYS_NO_THREADS)
+	return 1;
+#else
+	long count = sysconf(_SC_NPROCESSORS_ONLN);
+	return (count > 0) ? (int)count : 1;
+#endif
+}
+
+
+int AtomicFetchAdd(volatile int* target, int value)
+{
+#if defined(_WIN32)
+	return (int)InterlockedExchangeAdd((volatile LONG*)target, value);
+#else
+	return __atomic_fetch_add(target, value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Locks
+
+struct SysMutex
+{
+#if defined(_WIN32)
+	SRWLOCK lock;
+#elif !defined(SYS_NO_THREADS)
+	pthread_mutex_t lock;
+#else
+	int unused;
+#endif
+};
+
+struct SysCondition
+{
+#if defined(_WIN32)
+	CONDITION_VARIABLE condition;
+#elif !defined(SYS_NO_THREADS)
+	pthread_cond_t condition;
+#else
+	int unused;
+#endif
+};
+
+
+SysMutex* CreateSysMutex(void)
+{
+	SysMutex* mutex = calloc(1, sizeof(SysMutex));
+	if (!mutex) return NULL;
+#if defined(_WIN32)
+	InitializeSRWLock(&mutex->lock);
+#elif !defined(SYS_NO_THREADS)
+	if (pthread_mutex_init(&mutex->lock, NULL) != 0)
+	{
+		free(mutex);
+		return NULL;
+	}
+#endif
+	return mutex;
+}
+
+
+void DestroySysMutex(SysMutex* mutex)
+{
+	if (!mutex) return;
+#if !defined(_WIN32) && !defined(SYS_NO_THREADS)
+	pthread_mutex_destroy(&mutex->lock);
+#endif
+	free(mutex);
+}
+
+
+void LockSysMutex(SysMutex* mutex)
+{
+#if defined(_WIN32)
+	AcquireSRWLockExclusive(&mutex->lock);
+#elif !defined(SYS_NO_THREADS)
+	pthread_mutex_lock(&mutex->lock);
+#else
+	(void)mutex;
+#endif
+}
+
+
+void UnlockSysMutex(SysMutex* mutex)
+{
+#if defined(_WIN32)
+	ReleaseSRWLockExclusive(&mutex->lock);
+#elif !defined(SYS_NO_THREADS)
+	pthread_mutex_unlock(&mutex->lock);
+#else
+	(void)mutex;
+#endif
+}
+
+
+SysCondition* CreateSysCondition(void)
+{
+	SysCondition* condition = calloc(1, sizeof(SysCondition));
+	if (!condition) return NULL;
+#if defined(_WIN32)
+	InitializeConditionVariable(&condition->condition);
+#elif !defined(SYS_NO_THREADS)
+	if (pthread_cond_init(&condition->condition, NULL) != 0)
+	{
+		free(condition);
+		return NULL;
+	}
+#endif
+	return condition;
+}
+
+
+void DestroySysCondition(SysCondition* condition)
+{
+	if (!condition) return;
+#if !defined(_WIN32) && !defined(SYS_NO_THREADS)
+	pthread_cond_destroy(&condition->condition);
+#endif
+	free(condition);
+}
+
+
+void WaitSysCondition(SysCondition* condition, SysMutex* mutex)
+{
+#if defined(_WIN32)
+	SleepConditionVariableSRW(&condition->condition, &mutex->lock, INFINITE, 0);
+#elif !defined(SYS_NO_THREADS)
+	pthread_cond_wait(&condition->condition, &mutex->lock);
+#else
+	(void)condition;
+	(void)mutex;
+#endif
+}
+
+
+void SignalSysCondition(SysCondition* condition)
+{
+#if defined(_WIN32)
+	WakeAllConditionVariable(&condition->condition);
+#elif !defined(SYS_NO_THREADS)
+	pthread_cond_broadcast(&condition->condition);
+#else
+	(void)condition;
+#endif
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// Parallel for
+
+#define kMaxWorkerThreads 63	// besides the calling thread
+
+// static so the first ParallelFor calls can't race to create them
+#if defined(_WIN32)
+	#define SYS_MUTEX_INIT { SRWLOCK_INIT }
+	#define SYS_CONDITION_INIT { CONDITION_VARIABLE_INIT }
+#elif !defined(SYS_NO_THREADS)
+	#define SYS_MUTEX_INIT { PTHREAD_MUTEX_INITIALIZER }
+	#define SYS_CONDITION_INIT { PTHREAD_COND_INITIALIZER }
+#else
+	#define SYS_MUTEX_INIT { 0 }
+	#define SYS_CONDITION_INIT { 0 }
+#endif
+
+typedef struct WorkerPool
+{
+	SysThread* threads[kMaxWorkerThreads];		// never joined, they wait for calls until exit
+	int threadCount;
+
+	// the call being run, set while every worker is waiting
+	SysJobFunc job;
+	void* udata;
+	int count;
+	volatile int next;
+
+	bool called[kMaxWorkerThreads];		// worker is asked to help with the call
+	int busy;							// workers still helping
+} WorkerPool;
+
+static WorkerPool gWorkerPool = { 0 };
+static SysMutex gWorkerCallLock = SYS_MUTEX_INIT;		// held for a whole call, so calls take turns
+static SysMutex gWorkerLock = SYS_MUTEX_INIT;			// guards called and busy
+static SysCondition gWorkerWake = SYS_CONDITION_INIT;
+static SysCondition gWorkerDone = SYS_CONDITION_INIT;
+
+
+static void RunWorkerJobs(WorkerPool* pool)
+{
+	for (;;)
+	{
+		int index = AtomicFetchAdd(&pool->next, 1);
+		if (index >= pool->count) break;
+		pool->job(pool->udata, index);
+	}
+}
+
+
+static void WorkerMain(void* arg)
+{
+	int worker = (int)(intptr_t)arg;
+
+	LockSysMutex(&gWorkerLock);
+	for (;;)
+	{
+		while (!gWorkerPool.called[worker]) WaitSysCondition(&gWorkerWake, &gWorkerLock);
+		gWorkerPool.called[worker] = false;
+		UnlockSysMutex(&gWorkerLock);
+
+		RunWorkerJobs(&gWorkerPool);
+
+		LockSysMutex(&gWorkerLock);
+		if (--gWorkerPool.busy == 0) SignalSysCondition(&gWorkerDone);
+	}
+}
+
+
+void ParallelFor(int count, SysJobFunc job, void* udata, int threadCount)
+{
+	if (count <= 0) return;
+	if (threadCount <= 0) threadCount = GetProcessorCount();
+	if (threadCount > count) threadCount = count;
+	if (threadCount > kMaxWorkerThreads + 1) threadCount = kMaxWorkerThreads + 1;
+
+	if (threadCount == 1)
+	{
+		for (int i = 0; i < count; ++i) job(udata, i);
+		return;
+	}
+
+	LockSysMutex(&gWorkerCallLock);
+	WorkerPool* pool = &gWorkerPool;
+
+	// workers are only started once a call wants more than there are
+	while (pool->threadCount < threadCount - 1)
+	{
+		SysThread* thread = StartThread(WorkerMain, (void*)(intptr_t)pool->threadCount);
+		if (!thread) break;
+		pool->threads[pool->threadCount++] = thread;
+	}
+	int helpers = (threadCount - 1 < pool->threadCount) ? threadCount - 1 : pool->threadCount;
+
+	LockSysMutex(&gWorkerLock);
+	pool->job = job;
+	pool->udata = udata;
+	pool->count = count;
+	pool->next = 0;
+	pool->busy = helpers;
+	for (int i = 0; i < helpers; ++i) pool->called[i] = true;
+	SignalSysCondition(&gWorkerWake);
+	UnlockSysMutex(&gWorkerLock);
+
+	// the calling thread works too, so if no worker starts the calls still complete
+	RunWorkerJobs(pool);
+
+	LockSysMutex(&gWorkerLock);
+	while (pool->busy > 0) WaitSysCondition(&gWorkerDone, &gWorkerLock);
+	UnlockSysMutex(&gWorkerLock);
+
+	UnlockSysMutex(&gWorkerCallLock);
+}
+
+
+
+//////////////////////////////////////////////////////////////////////////
+// File mapping
+
+bool MapFile(const char* fileName, SysFileMap* map)
+{
+	memset(map, 0, sizeof(*map));
+
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0 || (unsigned long long)size.QuadPart > (size_t)-1)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	const void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+	if (!data)
+	{
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	map->data = data;
+	map->size = (size_t)size.QuadPart;
+	map->handle = file;
+	map->mapping = mapping;
+	return true;
+#else
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0) return false;
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	// the mapping keeps the file referenced, the descriptor isn't needed any more
+	void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) return false;
+
+	map->data = data;
+	map->size = (size_t)st.st_size;
+	return true;
+#endif
+}
+
+
+void UnmapFile(SysFileMap* map)
+{
+	if (!map->data) return;
+#if defined(_WIN32)
+	UnmapViewOfFile(map->data);
+	CloseHandle(map->mapping);
+	CloseHandle(map->handle);
+#else
+	munmap((void*)map->data, map->size);
+#endif
+	memset(map, 0, sizeof(*map));
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+// Files
+
+bool CreateSysDirectory(const char* path)
+{
+#if defined(_WIN32)
+	if (CreateDirectoryA(path, NULL)) return true;
+	DWORD attributes = GetFileAttributesA(path);
+	return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+	if (mkdir(path, 0755) == 0) return true;
+	struct stat st;
+	return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+#endif
+}
+
+
+bool ReplaceSysFile(const char* fileName, const char* newName)
+{
+#if defined(_WIN32)
+	return MoveFileExA(fileName, newName, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+	return rename(fileName, newName) == 0;
+#endif
+}
@@ -0,0 +1,87 @@
+// Platform services which raylib doesn't provide.
+//
+// Kept in its own translation unit as the platform headers clash with raylib.h.
+
+#ifndef SYS_H
+#define SYS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+// Seconds from a monotonic high resolution clock, usable without a window.
+double GetHighResTime(void);
+
+// Suspend the calling thread for about seconds, at least a scheduler tick.
+void SleepSeconds(double seconds);
+
+typedef struct SysThread SysThread;
+typedef void (*SysThreadFunc)(void* arg);
+
+// Run func(arg) on a new thread. Returns NULL if it couldn't be started, or on web builds
+// without pthreads, callers then do the work themselves.
+SysThread* StartThread(SysThreadFunc func, void* arg);
+
+// Wait for the thread to finish and free it.
+void JoinThread(SysThread* thread);
+
+// Logical processors available to the process, at least 1.
+int GetProcessorCount(void);
+
+// Add value to *target as a single atomic operation, returns the previous value.
+int AtomicFetchAdd(volatile int* target, int value);
+
+typedef struct SysMutex SysMutex;
+typedef struct SysCondition SysCondition;
+
+// Without threads these do nothing, waiting on a condition returns straight away.
+SysMutex* CreateSysMutex(void);
+void DestroySysMutex(SysMutex* mutex);
+void LockSysMutex(SysMutex* mutex);
+void UnlockSysMutex(SysMutex* mutex);
+
+SysCondition* CreateSysCondition(void);
+void DestroySysCondition(SysCondition* condition);
+// Unlock mutex while waiting for a signal, locked again on return. May wake up spuriously.
+void WaitSysCondition(SysCondition* condition, SysMutex* mutex);
+// Wake every waiting thread.
+void SignalSysCondition(SysCondition* condition);
+
+typedef void (*SysJobFunc)(void* udata, int index);
+
+// Call job(udata, i) for every i in [0, count) on up to threadCount threads including the
+// calling one, 0 for one per processor, and return once all calls have. Which thread makes
+// which call isn't fixed, so the calls must be independent. The worker threads are started
+// on first use and then wait for the next call. Calls from several threads take turns, a job
+// must not call ParallelFor itself.
+void ParallelFor(int count, SysJobFunc job, void* udata, int threadCount);
+
+// A file mapped read only into memory
+typedef struct SysFileMap
+{
+	const unsigned char* data;
+	size_t size;
+	void* handle;			// platform handles, don't touch
+	void* mapping;
+} SysFileMap;
+
+// Map the whole file as it is now, fails on empty files. Leaves map zeroed on failure. Only
+// for files nothing else writes while mapped: reading past the end of a file truncated in the
+// meantime faults. Files that may be saved over, like worlds being edited, are read instead.
+bool MapFile(const char* fileName, SysFileMap* map);
+void UnmapFile(SysFileMap* map);
+
+// Create a directory unless it exists. Returns true if it exists afterwards.
+bool CreateSysDirectory(const char* path);
+
+// Move a file over newName, replacing it in one step, so readers see either file whole.
+bool ReplaceSysFile(const char* fileName, const char* newName);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif // SYS_H